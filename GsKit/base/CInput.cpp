@@ -15,6 +15,7 @@
 #include "utils/FindFile.h"
 #include "PointDevice.h"
 #include "GsTimer.h"
+#include "GsProfiler.h"
 
 #include "fileio/CConfiguration.h"
 
@@ -66,6 +67,8 @@ void CInput::resetControls(int player)
 {
 	int i;
 
+	mBindingsDirty = true;
+
 	if(player == 0)
 	{
 		player = 1;
@@ -83,7 +86,7 @@ void CInput::resetControls(int player)
 	memset(last_immediate_keytable,false,KEYTABLE_SIZE);
 
 	for(i=0 ; i<MAX_COMMANDS ; i++)
-		InputCommand[player][i].active = false;
+		InputCommand[player-1][i].active = false;
 
 	// These are the default keyboard commands
 	i=player-1;
@@ -395,6 +398,8 @@ void CInput::setupInputCommand( stInputCommand *pInput, int action, const std::s
 	TrimSpaces(buf);
 	if(buf == "") return;
 
+	mBindingsDirty = true;
+
 	if(strCaseStartsWith(string, "Joy"))
 	{
 		std::string buf2;
@@ -475,6 +480,7 @@ void CInput::readNewEvent()
 
 
 	memset(&lokalInput, 0, sizeof(stInputCommand));
+	mBindingsDirty = true;
 	if(!m_EventList.empty())
 		m_EventList.clear();
 
@@ -614,6 +620,8 @@ void CInput::transMouseRelCoord(Vector2D<float> &Pos,
  */
 void CInput::pollEvents()
 {
+    GS_PROFILE_ZONE("pollEvents");
+
     // Semaphore
     SDL_SemWait( pollSem );
 
@@ -624,6 +632,9 @@ void CInput::pollEvents()
         return;
     }
 
+    if(mBindingsDirty)
+        rebuildBindings();
+
     Vector2D<float> Pos;
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 
@@ -854,55 +865,86 @@ void CInput::pollEvents()
     SDL_SemPost( pollSem );
 }
 
+Uint64 CInput::bindingKey(const EType type, const int which, const int index)
+{
+	return (Uint64(type) << 56) |
+		   (Uint64(Uint32(which) & 0xFFFFFF) << 32) |
+		   Uint64(Uint32(index));
+}
+
 /**
- * \brief	This will tell if any joystick axes haven been moved and if they triggered a command by doing so...
+ * \brief	Sorts every player command into the lookup table by what triggers it.
+ * 			Hats are only told apart by joystick, the direction is checked when the event comes.
  */
-void CInput::processJoystickAxis(void)
+void CInput::rebuildBindings()
 {
+	mBindings.clear();
+
 	for(int j=0 ; j<NUM_INPUTS ; j++)
 	{
 		for(int i=0 ; i<MAX_COMMANDS ; i++)
 		{
-			if(InputCommand[j][i].joyeventtype == ETYPE_JOYAXIS)
+			const stInputCommand &command = InputCommand[j][i];
+			Uint64 key;
+
+			switch(command.joyeventtype)
 			{
-				// Axis are configured for this commmand
-				if(Event.jaxis.axis == InputCommand[j][i].joyaxis && Event.jaxis.which == InputCommand[j][i].which )
-				{
-					// Deadzone
-					if((Event.jaxis.value > m_joydeadzone && InputCommand[0][i].joyvalue > 0) ||
-					   (Event.jaxis.value < -m_joydeadzone && InputCommand[0][i].joyvalue < 0))
-					{
-						InputCommand[j][i].active = true;
-						InputCommand[j][i].joymotion = Event.jaxis.value;
-					}
-					else
-						InputCommand[j][i].active = false;
-				}
+			case ETYPE_KEYBOARD:
+				key = bindingKey(ETYPE_KEYBOARD, 0, command.keysym); break;
+			case ETYPE_JOYAXIS:
+				key = bindingKey(ETYPE_JOYAXIS, command.which, command.joyaxis); break;
+			case ETYPE_JOYBUTTON:
+				key = bindingKey(ETYPE_JOYBUTTON, command.which, command.joybutton); break;
+			case ETYPE_JOYHAT:
+				key = bindingKey(ETYPE_JOYHAT, command.which, 0); break;
+			default:
+				continue;
 			}
+
+			mBindings[key].push_back({j, i});
 		}
 	}
+
+	mBindingsDirty = false;
 }
 
-void CInput::processJoystickHat()
+const std::vector<CInput::BindingRef> &CInput::boundCommands(const EType type, const int which, const int index) const
 {
-	for(int j=0 ; j<NUM_INPUTS ; j++)
+	static const std::vector<BindingRef> unbound;
+
+	const auto it = mBindings.find(bindingKey(type, which, index));
+	return (it != mBindings.end()) ? it->second : unbound;
+}
+
+/**
+ * \brief	This will tell if any joystick axes haven been moved and if they triggered a command by doing so...
+ */
+void CInput::processJoystickAxis(void)
+{
+	for(const auto &ref : boundCommands(ETYPE_JOYAXIS, Event.jaxis.which, Event.jaxis.axis))
 	{
-		for(int i=0 ; i<MAX_COMMANDS ; i++)
-		{
-			stInputCommand &command = InputCommand[j][i];
+		stInputCommand &command = InputCommand[ref.player][ref.command];
 
-			if( command.joyeventtype == ETYPE_JOYHAT &&
-				command.which == Event.jhat.which )
-			{
-				command.active = false;
-				// Check if Joystick hats are configured for this event
-				if(
-					(Event.jhat.value & command.joyhatval) )
-				{
-					command.active = true;
-				}
-			}
+		// Deadzone
+		if((Event.jaxis.value > m_joydeadzone && InputCommand[0][ref.command].joyvalue > 0) ||
+		   (Event.jaxis.value < -m_joydeadzone && InputCommand[0][ref.command].joyvalue < 0))
+		{
+			command.active = true;
+			command.joymotion = Event.jaxis.value;
 		}
+		else
+			command.active = false;
+	}
+}
+
+void CInput::processJoystickHat()
+{
+	for(const auto &ref : boundCommands(ETYPE_JOYHAT, Event.jhat.which, 0))
+	{
+		stInputCommand &command = InputCommand[ref.player][ref.command];
+
+		// Check if Joystick hats are configured for this event
+		command.active = (Event.jhat.value & command.joyhatval) ? true : false;
 	}
 }
 
@@ -914,20 +956,81 @@ void CInput::processJoystickButton(int value)
 #if defined(CAANOO) || defined(WIZ) || defined(GP2X)
 	WIZ_EmuKeyboard( Event.jbutton.button, value );
 #else
+	for(const auto &ref : boundCommands(ETYPE_JOYBUTTON, Event.jbutton.which, Event.jbutton.button))
+	{
+		InputCommand[ref.player][ref.command].active = value;
+	}
+#endif
+}
+
+// Per command one byte of flags and two of axis motion, then one byte of flags per key
+enum
+{
+    STATE_ACTIVE = 1,
+    STATE_LASTACTIVE = 2,
+    STATE_FIRSTTIME = 4
+};
+
+size_t CInput::commandStateSize()
+{
+	return NUM_INPUTS*MAX_COMMANDS*3 + KEYTABLE_SIZE;
+}
+
+void CInput::saveCommandState(std::vector<Uint8> &state) const
+{
+	state.resize(commandStateSize());
+	Uint8 *out = state.data();
+
 	for(int j=0 ; j<NUM_INPUTS ; j++)
 	{
 		for(int i=0 ; i<MAX_COMMANDS ; i++)
 		{
-			// TODO: Check all NUM_INPUTS, if they can be reduced to another variable
-			if(InputCommand[j][i].joyeventtype == ETYPE_JOYBUTTON)
-			{
-				// Joystick buttons are configured for this event !!
-				if(Event.jbutton.button == InputCommand[j][i].joybutton && Event.jbutton.which == InputCommand[j][i].which )
-					InputCommand[j][i].active = value;
-			}
+			const stInputCommand &command = InputCommand[j][i];
+			const Uint16 motion = Uint16(Sint16(command.joymotion));
+
+			*out++ = (command.active ? STATE_ACTIVE : 0) |
+					 (command.lastactive ? STATE_LASTACTIVE : 0) |
+					 (command.firsttimeactive ? STATE_FIRSTTIME : 0);
+			*out++ = Uint8(motion);
+			*out++ = Uint8(motion >> 8);
 		}
 	}
-#endif
+
+	for(unsigned int k=0 ; k<KEYTABLE_SIZE ; k++)
+	{
+		*out++ = (immediate_keytable[k] ? STATE_ACTIVE : 0) |
+				 (last_immediate_keytable[k] ? STATE_LASTACTIVE : 0) |
+				 (firsttime_immediate_keytable[k] ? STATE_FIRSTTIME : 0);
+	}
+}
+
+void CInput::loadCommandState(const std::vector<Uint8> &state)
+{
+	if(state.size() != commandStateSize())
+		return;
+
+	const Uint8 *in = state.data();
+
+	for(int j=0 ; j<NUM_INPUTS ; j++)
+	{
+		for(int i=0 ; i<MAX_COMMANDS ; i++)
+		{
+			stInputCommand &command = InputCommand[j][i];
+
+			command.active = (in[0] & STATE_ACTIVE) != 0;
+			command.lastactive = (in[0] & STATE_LASTACTIVE) != 0;
+			command.firsttimeactive = (in[0] & STATE_FIRSTTIME) != 0;
+			command.joymotion = Sint16(Uint16(in[1]) | (Uint16(in[2]) << 8));
+			in += 3;
+		}
+	}
+
+	for(unsigned int k=0 ; k<KEYTABLE_SIZE ; k++, in++)
+	{
+		immediate_keytable[k] = (*in & STATE_ACTIVE) != 0;
+		last_immediate_keytable[k] = (*in & STATE_LASTACTIVE) != 0;
+		firsttime_immediate_keytable[k] = (*in & STATE_FIRSTTIME) != 0;
+	}
 }
 
 /**
@@ -945,21 +1048,14 @@ bool CInput::processKeys(int keydown)
     bool passSDLEventVec = true;
 
 	// Input for player commands
-    for(int j=0 ; j<NUM_INPUTS ; j++)
+    for(const auto &ref : boundCommands(ETYPE_KEYBOARD, 0, Event.key.keysym.sym))
 	{
-        for(int i=0 ; i<MAX_COMMANDS ; i++)
-		{
-			if(InputCommand[j][i].keysym == Event.key.keysym.sym &&
-					InputCommand[j][i].joyeventtype == ETYPE_KEYBOARD)
-            {
-				InputCommand[j][i].active = (keydown) ? true : false;
+		InputCommand[ref.player][ref.command].active = (keydown) ? true : false;
 
-                if(i == IC_BACK)
-                {
-                    passSDLEventVec = false;
-                }
-            }
-		}
+        if(ref.command == IC_BACK)
+        {
+            passSDLEventVec = false;
+        }
 	}
 
 
@@ -11,6 +11,8 @@
 #include <SDL.h>
 #include <string>
 #include <list>
+#include <vector>
+#include <unordered_map>
 #include <base/utils/Geometry.h>
 #include <base/GsEvent.h>
 #include <base/InputEvents.h>
@@ -264,6 +266,23 @@ public:
     void flushEvents();
     void flushAll();
 
+    /**
+     * @brief commandStateSize  Number of bytes saveCommandState() produces
+     */
+    static size_t commandStateSize();
+
+    /**
+     * @brief saveCommandState  Packs what the game reads from the input after a poll,
+     *                          that is the commands of all players and the key tables, into state
+     */
+    void saveCommandState(std::vector<Uint8> &state) const;
+
+    /**
+     * @brief loadCommandState  Sets the commands and keys from a state of saveCommandState(),
+     *                          as if they had been polled. Used for replaying recorded input.
+     */
+    void loadCommandState(const std::vector<Uint8> &state);
+
 	void renderOverlay(); // for mouse wrapper gfx or other stuff
 
     void shutdown();
@@ -314,6 +333,27 @@ private:
 	int m_cmdpulse;
 	short m_joydeadzone;
 
+	/**
+	 * Commands bound to a key, joystick axis, button or hat, looked up by bindingKey().
+	 * Rebuilt once the bindings have changed, so an event only touches the commands
+	 * bound to it instead of scanning all players and commands.
+	 */
+	struct BindingRef
+	{
+		int player;
+		int command;
+	};
+
+	std::unordered_map<Uint64, std::vector<BindingRef>> mBindings;
+	bool mBindingsDirty = true;
+
+	static Uint64 bindingKey(const EType type, const int which, const int index);
+	void rebuildBindings();
+	const std::vector<BindingRef> &boundCommands(const EType type, const int which, const int index) const;
+
+	// Compares the table against the bindings themselves (tests/InputBindingTest.cpp)
+	friend struct InputBindingTest;
+
 	bool immediate_keytable[KEYTABLE_SIZE];
 	bool last_immediate_keytable[KEYTABLE_SIZE];
 	bool firsttime_immediate_keytable[KEYTABLE_SIZE];
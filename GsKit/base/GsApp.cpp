@@ -22,6 +22,10 @@
 
 #include <base/CInput.h>
 #include <base/GsArguments.h>
+#include <base/GsInputRecorder.h>
+#include <base/GsBenchmark.h>
+#include <base/GsProfiler.h>
+#include <base/GsScheduler.h>
 
 
 std::string getArgument( int argc, char *argv[], const std::string& text )
@@ -70,6 +74,13 @@ mSink(this)
 
 void GsApp::cleanup()
 {
+    const std::string traceFile = gArgs.getValue("profiletrace");
+    if(!traceFile.empty() && gProfiler.exportChromeTrace(traceFile))
+    {
+        gLogging.ftextOut("Profiler trace written to \"%s\"<br>", traceFile.c_str());
+    }
+
+    gInputRecorder.stop();
     gInput.shutdown();
 }
 
@@ -99,6 +110,28 @@ bool GsApp::init(int argc, char *argv[])
     // Pass all the arguments
     gArgs.passArgs(argc, argv);
 
+    // "replay=<file>" plays a session recorded with "record=<file>" back
+    const std::string replayFile = gArgs.getValue("replay");
+    const std::string recordFile = gArgs.getValue("record");
+
+    if(!replayFile.empty())
+    {
+        gInputRecorder.startReplay(replayFile);
+    }
+    else if(!recordFile.empty())
+    {
+        gInputRecorder.startRecording(recordFile);
+    }
+
+    // "profile=1" records the profiler zones, "profile=overlay" also graphs them on screen
+    const std::string profile = gArgs.getValue("profile");
+
+    if(!profile.empty() || !gArgs.getValue("profiletrace").empty())
+    {
+        gProfiler.setEnabled(true);
+        gProfiler.showOverlay(profile == "overlay");
+    }
+
 	// Setup the Hardware using the settings we have loaded
 	gLogging.textOut(FONTCOLORS::GREEN,"Loading hardware settings...<br>");
     if(!loadDrivers())
@@ -184,8 +217,13 @@ bool GsApp::loadDrivers()
 // This function is run every time, the Timer says so, through.
 void GsApp::ponder(const float deltaT)
 {
+    GS_PROFILE_ZONE("ponder");
+
     pollEvents();
 
+    // Records the polled commands, or replaces them while replaying
+    gInputRecorder.beginTick();
+
     // Process the game control object if no effects are being processed
     if(mpCurEngine)
     {
@@ -196,6 +234,8 @@ void GsApp::ponder(const float deltaT)
     gEffectController.run(deltaT);
 
     gMenuController.ponder(deltaT);
+
+    gInputRecorder.endTick();
 }
 
 void GsApp::render()
@@ -208,6 +248,42 @@ void GsApp::render()
     gMenuController.render();
 
     gInput.render();    
+
+    gProfiler.renderOverlay();
+}
+
+
+
+void GsApp::renderFrame()
+{
+    {
+        GS_PROFILE_ZONE("render");
+
+        // Now we render the whole GameControl Object to the blit surface
+        render();
+    }
+
+    {
+        GS_PROFILE_ZONE("effects");
+
+        // Apply graphical effects if any.
+        gEffectController.render();
+    }
+
+    {
+        GS_PROFILE_ZONE("collectSurfaces");
+
+        // Pass all the surfaces to one. Some special surfaces are used and are collected here
+        gVideoDriver.collectSurfaces();
+    }
+
+    {
+        GS_PROFILE_ZONE("updateDisplay");
+
+        // Now you really render the screen
+        // When enabled, it also applies Filters
+        gVideoDriver.updateDisplay();
+    }
 }
 
 
@@ -234,11 +310,15 @@ void GsApp::runMainCycle()
 
     mpCurEngine->start();
 
-    float acc = 0.0f;
-    float start = 0.0f;
-    float elapsed = 0.0f;
-    float total_elapsed = 0.0f;
-    float curr = 0.0f;
+    if(gBenchmark.active())
+    {
+        runBenchmark();
+        cleanup();
+        return;
+    }
+
+    GsScheduler scheduler;
+    Uint64 total_elapsed = 0;
     int counter = 0;
 
     while(1)
@@ -247,123 +327,85 @@ void GsApp::runMainCycle()
 
         const  bool vsyncEnabled = gVideoDriver.isVsync();
 
-        curr = timerTicks();
+        scheduler.setTickRate(gTimer.LPS());
+        scheduler.setFrameRate(gTimer.targetFPS());
 
         if(gTimer.resetLogicSignal())
-            start = curr;
+            scheduler.reset();
 
+        const int ticks = scheduler.beginFrame();
+        total_elapsed += scheduler.lastFrameNs();
 
-        if(vsyncEnabled)
+        // Perform the game cycle
+        for(int i=0 ; i<ticks ; i++)
         {
-            start = timerTicks();
-
-            // Game cycle
-            {
-                // Poll Inputs
-                gInput.pollEvents();
-
-                // Process App Events
-                gEventManager.processSinks();
+            GS_PROFILE_ZONE("logic");
 
-                // Ponder Game Control
-                ponder(logicLatency);
-            }
+            // Poll Inputs
+            gInput.pollEvents();
 
-            // Now we render the whole GameControl Object to the blit surface
-            render();
+            // Process App Events
+            gEventManager.processSinks();
 
-            // Apply graphical effects if any.
-            gEffectController.render();
-
-            // Pass all the surfaces to one. Some special surfaces are used and are collected here
-            gVideoDriver.collectSurfaces();
-
-            // Now you really render the screen
-            // When enabled, it also applies Filters
-            gVideoDriver.updateDisplay();
-
-            elapsed = timerTicks() - start;
-            total_elapsed += elapsed;
-
-            if( mustShutdown() )
-                break;
+            // Ponder Game Control
+            ponder(logicLatency);
         }
-        else
-        {
 
-            const float renderLatency = gTimer.RenderLatency();
+        renderFrame();
 
-            elapsed = curr - start;
+        if( mustShutdown() )
+            break;
 
-            start = timerTicks();
+        // With vsync the presentation already waited for the display.
+        // If no frame limit is set, the system renders as much as possible
+        scheduler.endFrame(vsyncEnabled);
 
-            acc += elapsed;
+        gProfiler.endFrame();
 
-            // Perform the game cycle
-            while( acc > logicLatency )
-            {
-                // Poll Inputs
-                gInput.pollEvents();
-
-                // Process App Events
-                gEventManager.processSinks();
-
-                // Ponder Game Control
-                ponder(logicLatency);
-
-                acc -= logicLatency;
-            }
-
-            // Now we render the whole GameControl Object to the blit surface
-            render();
+        // This will refresh the fps display, so it stays readable and calculates an average value.
+        counter++;
+        if(counter >= 100)
+        {
+            counter = 0;
+            gTimer.setTimeforLastLoop(float(total_elapsed/100) / 1000000.0f);
+            total_elapsed = 0;
+        }
+    }
 
-            // Apply graphical effects if any.
-            gEffectController.render();
+    cleanup();
+}
 
-            // Pass all the surfaces to one. Some special surfaces are used and are collected here
-            gVideoDriver.collectSurfaces();
 
-            // Now you really render the screen
-            // When enabled, it also applies Filters
-            gVideoDriver.updateDisplay();
+void GsApp::runBenchmark()
+{
+    while( !gBenchmark.finished() )
+    {
+        const float logicLatency = gTimer.LogicLatency();
 
+        // Launcher and level loading only run up to the gameplay, they are not timed
+        const bool warmingUp = gBenchmark.warmUp();
 
-            elapsed = timerTicks() - start;
-            total_elapsed += elapsed;
+        if(!warmingUp)
+            gBenchmark.driveBot();
 
-            if( mustShutdown() )
-                break;
+        {
+            GS_PROFILE_ZONE("logic");
 
-            // If renderLatency is zero or less, delays won't happens.
-            // This means the system renders as much as possible
-            // with violating the the LPS
-            auto fWaitTime = -elapsed;
+            gInput.pollEvents();
+            gEventManager.processSinks();
+            ponder(logicLatency);
+        }
 
-            if(renderLatency > 0.0)
-            {
-                fWaitTime = renderLatency+fWaitTime;
-            }
+        if( mustShutdown() )
+            break;
 
-            // wait time remaining in current loop
-            if( fWaitTime > 0.0 )
-            {
-                const auto waitTime = static_cast<Uint32>(fWaitTime);
-                timerDelay( waitTime );
-                total_elapsed += static_cast<float>(waitTime);
-            }
+        renderFrame();
 
-        }
+        gProfiler.endFrame();
 
-        // This will refresh the fps display, so it stays readable and calculates an average value.
-        counter++;
-        if(counter >= 100)
-        {
-            counter = 0;
-            gTimer.setTimeforLastLoop(total_elapsed/100.0f);
-            total_elapsed = 0.0f;
-        }
+        if(!warmingUp)
+            gBenchmark.countTick();
     }
 
-    cleanup();
+    gBenchmark.report();
 }
-
@@ -49,12 +49,22 @@ public:
     void runMainCycle();
 	void cleanup();
 
+    /**
+     * @brief runBenchmark  Main cycle of the benchmark mode, ticks as fast as possible
+     */
+    void runBenchmark();
+
     void pollEvents();
 
     void ponder(const float deltaT);
 
     void render();
 
+    /**
+     * @brief renderFrame   Renders everything, applies the effects and filters and shows the result
+     */
+    void renderFrame();
+
     bool mustShutdown(){ return (mpCurEngine==nullptr); }
 
     void pumpEvent(const CEvent *evPtr);
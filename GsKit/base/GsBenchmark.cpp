@@ -0,0 +1,238 @@
+/*
+ * GsBenchmark.cpp
+ */
+
+#include "GsBenchmark.h"
+
+#include <base/GsInputRecorder.h>
+#include <base/GsProfiler.h>
+#include <base/utils/FindFile.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+// The bot turns around every that many ticks and jumps in the given rhythm
+const unsigned long BOT_TURN_TICKS = 560;
+const unsigned long BOT_JUMP_PERIOD = 60;
+const unsigned long BOT_JUMP_HOLD = 25;
+
+// If the gameplay isn't up after a minute of ticks, the rest is timed anyway
+const unsigned long MAX_WARMUP_TICKS = 60*70;
+
+// What the report sums up into its sections.
+// Sections overlap where zones nest, "collision" is part of "logic".
+struct Section
+{
+    const char *name;
+    const char *zones[3];
+    bool perTick;   // false for threads which don't run in step with the ticks
+};
+
+const Section SECTIONS[] =
+{
+    { "logic",      { "logic" },                                true },
+    { "collision",  { "collision" },                            true },
+    { "render",     { "render", "effects", "collectSurfaces" }, true },
+    { "scale",      { "updateDisplay" },                        true },
+    // Synthesized on the audio thread, which the dummy driver paces in real time
+    { "audio",      { "OPLUpdate" },                            false }
+};
+
+bool inStepWithTicks(const char *zone)
+{
+    for(const Section &section : SECTIONS)
+    {
+        for(const char *sectionZone : section.zones)
+        {
+            if(sectionZone && strcmp(sectionZone, zone) == 0)
+                return section.perTick;
+        }
+    }
+
+    return true;
+}
+
+
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+void pushKey(const SDL_Keycode key, const bool down)
+#else
+void pushKey(const SDLKey key, const bool down)
+#endif
+{
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+
+    event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.state = down ? SDL_PRESSED : SDL_RELEASED;
+    event.key.keysym.sym = key;
+
+    SDL_PushEvent(&event);
+}
+
+}
+
+
+void GsBenchmark::init(int argc, char *argv[])
+{
+    for(int i=1 ; i<argc ; i++)
+    {
+        const std::string arg = argv[i];
+
+        if(arg.find("benchmark=") == 0)
+            mTicksToRun = strtoul(arg.c_str()+10, nullptr, 10);
+        else if(arg.find("benchmarkout=") == 0)
+            mOutputFile = arg.substr(13);
+        else if(arg.find("replay=") == 0)
+            mReplaying = true;
+    }
+
+    if(!active())
+        return;
+
+    // No window, no sound device. Everything else runs as usual.
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+#else
+    SDL_putenv(const_cast<char*>("SDL_VIDEODRIVER=dummy"));
+    SDL_putenv(const_cast<char*>("SDL_AUDIODRIVER=dummy"));
+#endif
+}
+
+
+bool GsBenchmark::warmUp()
+{
+    if(mTiming)
+        return false;
+
+    if(!mGameplay && mWarmUpTicks < MAX_WARMUP_TICKS)
+    {
+        mWarmUpTicks++;
+        return true;
+    }
+
+    if(!mGameplay)
+        fputs("Benchmark: gameplay did not start, timing the ticks anyway\n", stderr);
+
+    gProfiler.setEnabled(true);
+    gProfiler.keepTotals(true);
+    mStartCounter = GsProfiler::counter();
+    mTiming = true;
+    return false;
+}
+
+
+void GsBenchmark::driveBot()
+{
+    if(gInputRecorder.replaying())
+        return;
+
+    const unsigned long tick = mTicksDone;
+
+    if(tick % BOT_TURN_TICKS == 0)
+    {
+        const bool right = (tick / BOT_TURN_TICKS) % 2 == 0;
+        pushKey(right ? SDLK_LEFT : SDLK_RIGHT, false);
+        pushKey(right ? SDLK_RIGHT : SDLK_LEFT, true);
+    }
+
+    if(tick % BOT_JUMP_PERIOD == 0)
+        pushKey(SDLK_LCTRL, true);
+    else if(tick % BOT_JUMP_PERIOD == BOT_JUMP_HOLD)
+        pushKey(SDLK_LCTRL, false);
+}
+
+
+std::string GsBenchmark::timeFields(const double totalMs, const double wallMs, const bool perTick) const
+{
+    std::ostringstream fields;
+    fields.precision(3);
+    fields << std::fixed << "\"total_ms\": " << totalMs << ", ";
+
+    // Per tick would only tell how many ticks fit into the time the sound played
+    if(perTick)
+        fields << "\"per_tick_us\": " << (mTicksDone > 0 ? totalMs*1000.0/mTicksDone : 0.0);
+    else
+        fields << "\"share_of_wall\": " << (wallMs > 0.0 ? totalMs/wallMs : 0.0);
+
+    return fields.str();
+}
+
+
+void GsBenchmark::report()
+{
+    const double freq = double(GsProfiler::frequency());
+    const double wallMs = double(GsProfiler::counter() - mStartCounter) * 1000.0 / freq;
+
+    std::ostringstream json;
+    json.precision(3);
+    json << std::fixed;
+
+    json << "{\n";
+    json << "  \"warmup_ticks\": " << mWarmUpTicks << ",\n";
+    json << "  \"gameplay\": " << (mGameplay ? "true" : "false") << ",\n";
+    json << "  \"ticks\": " << mTicksDone << ",\n";
+    json << "  \"wall_ms\": " << wallMs << ",\n";
+    json << "  \"ticks_per_second\": " << (wallMs > 0.0 ? mTicksDone*1000.0/wallMs : 0.0) << ",\n";
+
+    if(mReplaying)
+        json << "  \"replay_diverging_tick\": " << gInputRecorder.firstDivergingTick() << ",\n";
+
+    const std::vector<GsProfileTotal> totals = gProfiler.totals();
+    const size_t numSections = sizeof(SECTIONS)/sizeof(SECTIONS[0]);
+
+    json << "  \"sections\": {\n";
+
+    for(size_t i=0 ; i<numSections ; i++)
+    {
+        const Section &section = SECTIONS[i];
+        Uint64 counts = 0;
+
+        for(const GsProfileTotal &total : totals)
+        {
+            for(const char *zone : section.zones)
+            {
+                if(zone && strcmp(zone, total.name) == 0)
+                    counts += total.counts;
+            }
+        }
+
+        json << "    \"" << section.name << "\": { "
+             << timeFields(double(counts) * 1000.0 / freq, wallMs, section.perTick)
+             << " }" << (i+1 < numSections ? "," : "") << "\n";
+    }
+
+    json << "  },\n";
+    json << "  \"zones\": {\n";
+
+    // Zones nest, "logic" contains "ponder", for example
+    for(size_t i=0 ; i<totals.size() ; i++)
+    {
+        json << "    \"" << totals[i].name << "\": { "
+             << "\"calls\": " << totals[i].calls << ", "
+             << timeFields(double(totals[i].counts) * 1000.0 / freq, wallMs, inStepWithTicks(totals[i].name))
+             << " }" << (i+1 < totals.size() ? "," : "") << "\n";
+    }
+
+    json << "  }\n";
+    json << "}\n";
+
+    const std::string result = json.str();
+    fputs(result.c_str(), stdout);
+    fflush(stdout);
+
+    if(!mOutputFile.empty())
+    {
+        std::ofstream file;
+        if(OpenGameFileW(file, mOutputFile))
+            file << result;
+    }
+}
+
@@ -0,0 +1,92 @@
+/*
+ * GsBenchmark.h
+ *
+ *  Headless benchmark mode. Started with "benchmark=<ticks>" on the command line,
+ *  it runs without window or sound device (SDL's dummy drivers), performs the
+ *  logic ticks back to back without waiting for the timer, and prints where
+ *  the time went as JSON when done. "benchmarkout=<file>" writes it to a file as well.
+ *
+ *  The sections sum up profiler zones: logic (polling and pondering), collision
+ *  (part of the logic), render (engine, effects, collecting the surfaces), scale
+ *  (updating the display) and audio (OPL synthesis). The audio runs on its own
+ *  thread at the pace of the sound, so it is given as share of the wall time
+ *  instead of per tick. The totals of all zones follow. Only ticks of running
+ *  gameplay count, the launcher and the level loading before are warm-up.
+ *
+ *  Input comes from "replay=<file>" if given, otherwise a simple bot walks
+ *  and jumps around with the default keys of player one. A replay also reports
+ *  the first tick where it diverged from the recording, -1 if it didn't.
+ */
+
+#ifndef GSBENCHMARK_H
+#define GSBENCHMARK_H
+
+#include <base/Singleton.h>
+#include <SDL.h>
+
+#include <string>
+
+#define gBenchmark  GsBenchmark::get()
+
+class GsBenchmark : public GsSingleton<GsBenchmark>
+{
+public:
+
+    /**
+     * @brief init  Looks for the benchmark arguments. This has to happen before SDL
+     *              is initialized, as it selects the dummy drivers.
+     */
+    void init(int argc, char *argv[]);
+
+    bool active() const
+    {   return mTicksToRun > 0;   }
+
+    bool finished() const
+    {   return mTicksDone >= mTicksToRun;   }
+
+    /**
+     * @brief gameplayRunning   Called by the engine on every tick the player is in control
+     */
+    void gameplayRunning()
+    {   mGameplay = true;   }
+
+    /**
+     * @brief warmUp    Counts a tick before the gameplay runs. Once it does, or took too long
+     *                  to come up, the zone totals are cleared and the clock starts.
+     * @return true while still warming up
+     */
+    bool warmUp();
+
+    /**
+     * @brief driveBot  Feeds the bot's key presses for the next tick, unless a replay does the input
+     */
+    void driveBot();
+
+    void countTick()
+    {   mTicksDone++;   }
+
+    /**
+     * @brief report    Prints the JSON with the results
+     */
+    void report();
+
+private:
+
+    /**
+     * @brief timeFields    Time of a section or zone in total and per tick, or as share of
+     *                      the wall time for those which don't run in step with the ticks
+     */
+    std::string timeFields(const double totalMs, const double wallMs, const bool perTick) const;
+
+    unsigned long mTicksToRun = 0;
+    unsigned long mTicksDone = 0;
+    unsigned long mWarmUpTicks = 0;
+    bool mGameplay = false;
+    bool mTiming = false;
+    bool mReplaying = false;
+    std::string mOutputFile;
+
+    Uint64 mStartCounter = 0;
+};
+
+#endif // GSBENCHMARK_H
@@ -2,13 +2,117 @@
 #define __GSEVENT_H_
 
 #include "base/Singleton.h"
+#include "base/GsProfiler.h"
 #include <ctime>
 #include <vector>
 #include <deque>
 #include <list>
 #include <memory>
+#include <functional>
+#include <typeindex>
+#include <unordered_map>
+#include <atomic>
+#include <new>
 
-struct CEvent { virtual ~CEvent() {} };
+struct CEvent
+{
+    virtual ~CEvent() {}
+
+    // Id of the type of this event, see CEventContainer::eventTypeId(). 0 while not known yet.
+    size_t mEventTypeId = 0;
+};
+
+
+/**
+ * @brief The GsEventPool keeps freed event memory for reuse, sorted in size classes.
+ *        Most events are a few dozen bytes and live for a frame, so this saves
+ *        going to the heap for every single one. Blocks bigger than the largest class
+ *        are taken from the heap as usual. The pool has no lock, only the templated
+ *        CEventContainer::add<T>() takes events from it and that one is for the main
+ *        thread only. Loader threads like GalaxyDataLoad use add(new ...), which goes to the heap.
+ */
+class GsEventPool
+{
+public:
+
+    static void *allocate(const size_t size)
+    {
+        const size_t sizeClass = (size+GRANULARITY-1)/GRANULARITY;
+
+        if(sizeClass >= NUM_CLASSES)
+            return ::operator new(size);
+
+        std::vector<void*> &freeList = freeLists()[sizeClass];
+
+        if(freeList.empty())
+        {
+            // Take a whole chunk at once and cut it into blocks
+            const size_t blockSize = sizeClass*GRANULARITY;
+            char *chunk = static_cast<char*>(::operator new(blockSize*BLOCKS_PER_CHUNK));
+
+            for(size_t i=0 ; i<BLOCKS_PER_CHUNK ; i++)
+                freeList.push_back(chunk + i*blockSize);
+        }
+
+        void *block = freeList.back();
+        freeList.pop_back();
+        return block;
+    }
+
+    static void deallocate(void *block, const size_t size)
+    {
+        const size_t sizeClass = (size+GRANULARITY-1)/GRANULARITY;
+
+        if(sizeClass >= NUM_CLASSES)
+        {
+            ::operator delete(block);
+            return;
+        }
+
+        freeLists()[sizeClass].push_back(block);
+    }
+
+private:
+
+    static const size_t GRANULARITY = 16;
+    static const size_t NUM_CLASSES = 17;  // Up to 256 bytes
+    static const size_t BLOCKS_PER_CHUNK = 64;
+
+    // The chunks are kept until the end, the free lists only ever point into them.
+    // The lists are never destroyed either, events may still be freed during static destruction.
+    static std::vector<void*> *freeLists()
+    {
+        static std::vector<void*> *lists = new std::vector<void*>[NUM_CLASSES];
+        return lists;
+    }
+};
+
+/**
+ * @brief Allocator handing out GsEventPool memory, used with std::allocate_shared()
+ *        so the event and its shared_ptr control block come from the pool together.
+ */
+template <class T>
+struct GsEventAllocator
+{
+    typedef T value_type;
+
+    GsEventAllocator() {}
+
+    template <class U>
+    GsEventAllocator(const GsEventAllocator<U>&) {}
+
+    T *allocate(const size_t n)
+    {   return static_cast<T*>(GsEventPool::allocate(n*sizeof(T)));  }
+
+    void deallocate(T *p, const size_t n)
+    {   GsEventPool::deallocate(p, n*sizeof(T));  }
+
+    template <class U>
+    bool operator==(const GsEventAllocator<U>&) const { return true; }
+
+    template <class U>
+    bool operator!=(const GsEventAllocator<U>&) const { return false; }
+};
 
 struct InvokeFunctorEvent : CEvent
 {
@@ -17,7 +121,9 @@ struct InvokeFunctorEvent : CEvent
 
 
 /**
- * @brief The GsEventSink derived objects are those which receive the added event to the container
+ * @brief The GsEventSink derived objects are those which receive the added event to the container.
+ *        They get offered every event and pick theirs with dynamic_cast. For new code
+ *        CEventContainer::subscribe() is cheaper, it only calls for events of one type.
  */
 class GsEventSink
 {
@@ -29,12 +135,90 @@ class CEventContainer : public GsSingleton<CEventContainer>
 {
 public:
 
+    typedef size_t Subscription;
+
     CEventContainer() :
         pausetime(0),
         timepoint(0),
         mFlush(false)
     {}
 
+    /**
+     * @brief subscribe Calls handler for every event of exactly type T, in the order the events were added.
+     *                  Handlers of one type are called in the order they subscribed,
+     *                  all of them before the sinks registered with regSink() see the event.
+     *                  Handlers subscribed within a handler start with the next events.
+     *                  An unsubscribed handler isn't called anymore from that moment on,
+     *                  even by the running dispatch. It may unsubscribe itself, as it is only
+     *                  flagged there and removed once the dispatch is over.
+     * @return          Id to pass to unsubscribe()
+     */
+    template <class T>
+    Subscription subscribe(const std::function<void(const T&)> &handler)
+    {
+        Handler entry;
+        entry.id = ++mLastSubscription;
+        entry.call = [handler](const CEvent &ev)
+        {
+            handler(static_cast<const T&>(ev));
+        };
+
+        const size_t typeId = eventTypeId<T>();
+
+        // Only needed for events which were added without their type, see processSinks()
+        mTypeIds[std::type_index(typeid(T))] = typeId;
+
+        if(mDispatching)
+        {
+            mPendingHandlers.push_back( std::make_pair(typeId, entry) );
+        }
+        else
+        {
+            if(typeId >= mHandlers.size())
+                mHandlers.resize(typeId+1);
+
+            mHandlers[typeId].push_back(entry);
+        }
+
+        return entry.id;
+    }
+
+    /**
+     * @brief eventTypeId   Small number standing for the event type T, handed out on its first use.
+     *                      The handlers are kept in a vector indexed by it, so dispatching
+     *                      an event added with add<T>() needs no hashing of its type_info.
+     */
+    template <class T>
+    static size_t eventTypeId()
+    {
+        static const size_t id = ++lastEventTypeId();
+        return id;
+    }
+
+    void unsubscribe(const Subscription id)
+    {
+        // Only flagged, the handler might be the one running right now
+        for(auto &channel : mHandlers)
+        {
+            for(auto &entry : channel)
+            {
+                if(entry.id == id)
+                    entry.removed = true;
+            }
+        }
+
+        for(auto &pending : mPendingHandlers)
+        {
+            if(pending.second.id == id)
+                pending.second.removed = true;
+        }
+
+        mHandlersDirty = true;
+
+        if(!mDispatching)
+            updateHandlers();
+    }
+
     size_t size() { return m_EventList.size(); }
     bool empty() { return m_EventList.empty(); }
     void clear() { m_EventList.clear(); }
@@ -57,22 +241,65 @@ public:
 
     void processSinks()
     {
+        GS_PROFILE_ZONE("processSinks");
+
         // First check if there are pendingEvents to be processed
         if(m_EventList.empty())
             return;
 
-        // Make a copy of that list, because the original
+        // Take the events out of that list, because the original
         // could change, while pumping happens
         for(auto &ev : m_EventList)
         {
-            mPumpEventPtrs.push_back(ev);
+            mPumpEventPtrs.push_back(std::move(ev));
         }
 
         // We don't need anything from this list anymore
         m_EventList.clear();
 
+        // Subscribers only get the events of their type
+        if(!mTypeIds.empty())
+        {
+            mDispatching = true;
+
+            for( auto &event : mPumpEventPtrs )
+            {
+                // Events given to add() as pointers don't know their type id yet.
+                // It is looked up once, types nobody subscribed to have no id here.
+                if(event->mEventTypeId == 0)
+                {
+                    const auto known = mTypeIds.find(std::type_index(typeid(*event)));
+
+                    if(known != mTypeIds.end())
+                        event->mEventTypeId = known->second;
+                }
+
+                const size_t typeId = event->mEventTypeId;
+
+                if(typeId != 0 && typeId < mHandlers.size())
+                {
+                    const std::vector<Handler> &handlers = mHandlers[typeId];
+
+                    for( size_t i=0 ; i<handlers.size() && !mFlush ; i++ )
+                    {
+                        if(!handlers[i].removed)
+                            handlers[i].call(*event);
+                    }
+                }
+
+                if(mFlush)
+                    break;
+            }
+
+            mDispatching = false;
+            updateHandlers();
+        }
+
         for( GsEventSink* sink : mSinkPtrList )
         {
+            if(mFlush)
+                break;
+
             for( auto &event : mPumpEventPtrs )
             {
                 sink->pumpEvent( event.get() );
@@ -101,12 +328,14 @@ public:
         m_EventList.push_back(ev);
     }
 
-    // template version
-    template <class _T>
-    void add()
+    // template version, the event is taken from the pool
+    template <class _T, class... Args>
+    void add(Args&&... args)
     {
-        _T *ev = new _T;
-        m_EventList.push_back(std::shared_ptr<CEvent>(ev));
+        std::shared_ptr<_T> ev = std::allocate_shared<_T>(GsEventAllocator<_T>(),
+                                                          std::forward<Args>(args)...);
+        ev->mEventTypeId = eventTypeId<_T>();
+        m_EventList.push_back(std::move(ev));
     }
 
 
@@ -141,8 +370,67 @@ public:
     void pop_Event() { m_EventList.pop_front(); }
 
 private:
+
+    struct Handler
+    {
+        Subscription id;
+        std::function<void(const CEvent&)> call;
+        bool removed = false;
+    };
+
+    // Adds the handlers subscribed while dispatching and drops the unsubscribed ones
+    void updateHandlers()
+    {
+        for(auto &pending : mPendingHandlers)
+        {
+            if(pending.second.removed)
+                continue;
+
+            if(pending.first >= mHandlers.size())
+                mHandlers.resize(pending.first+1);
+
+            mHandlers[pending.first].push_back(pending.second);
+        }
+
+        mPendingHandlers.clear();
+
+        if(!mHandlersDirty)
+            return;
+
+        for(auto &handlers : mHandlers)
+        {
+            std::vector<Handler> kept;
+
+            for(auto &entry : handlers)
+            {
+                if(!entry.removed)
+                    kept.push_back(entry);
+            }
+
+            handlers.swap(kept);
+        }
+
+        mHandlersDirty = false;
+    }
+
+    // Counter behind eventTypeId(). Atomic, so ids stay unique even if two types get theirs on different threads.
+    static std::atomic<size_t> &lastEventTypeId()
+    {
+        static std::atomic<size_t> last(0);
+        return last;
+    }
+
     std::list< GsEventSink* > mSinkPtrList;
 
+    // Indexed by eventTypeId()
+    std::vector< std::vector<Handler> > mHandlers;
+    std::vector< std::pair<size_t, Handler> > mPendingHandlers;
+    // Type ids of the subscribed types, for the events added without one
+    std::unordered_map< std::type_index, size_t > mTypeIds;
+    Subscription mLastSubscription = 0;
+    bool mDispatching = false;
+    bool mHandlersDirty = false;
+
     std::deque< std::shared_ptr<CEvent> > m_EventList;
     std::vector< std::shared_ptr<CEvent> > mPumpEventPtrs;
 
@@ -0,0 +1,418 @@
+/*
+ * GsInputRecorder.cpp
+ *
+ *  Layout, all numbers little endian:
+ *
+ *  "CGIR"
+ *  Uint32  version
+ *  Uint32  random seed
+ *  Uint32  size of the input state
+ *  Uint32  number of header values, each one as key and value string
+ *
+ *  Records, starting with their type byte:
+ *  TICK    Uint16 number of changed bytes, each as Uint16 offset and Uint8 value
+ *  MARK    key and value string
+ *  HASH    Uint64 hash of the world after the tick
+ *
+ *  Every tick is a TICK record followed by its MARK records and its HASH.
+ *
+ *  Strings are stored as Uint16 length followed by the characters.
+ */
+
+#include "GsInputRecorder.h"
+
+#include <base/CInput.h>
+#include <base/GsLogging.h>
+#include <base/utils/FindFile.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+
+const char RECORD_MAGIC[4] = { 'C', 'G', 'I', 'R' };
+const Uint32 RECORD_VERSION = 1;
+
+enum RecordType
+{
+    REC_TICK = 1,
+    REC_MARK = 2,
+    REC_HASH = 3
+};
+
+
+void putUint(std::ostream &stream, Uint64 value, const int bytes)
+{
+    for(int i=0 ; i<bytes ; i++)
+    {
+        stream.put(char(value & 0xFF));
+        value >>= 8;
+    }
+}
+
+void putString(std::ostream &stream, const std::string &str)
+{
+    const Uint16 len = Uint16(std::min<size_t>(str.size(), 0xFFFF));
+    putUint(stream, len, 2);
+    stream.write(str.data(), len);
+}
+
+template <typename T>
+bool getUint(std::istream &stream, T &value)
+{
+    Uint8 bytes[sizeof(T)];
+    if(!stream.read(reinterpret_cast<char*>(bytes), sizeof(T)))
+        return false;
+
+    Uint64 result = 0;
+    for(int i=sizeof(T)-1 ; i>=0 ; i--)
+    {
+        result = (result << 8) | bytes[i];
+    }
+
+    value = T(result);
+    return true;
+}
+
+bool getString(std::istream &stream, std::string &str)
+{
+    Uint16 len;
+    if(!getUint(stream, len))
+        return false;
+
+    str.resize(len);
+    return len == 0 || bool(stream.read(&str[0], len));
+}
+
+}
+
+
+bool GsInputRecorder::startRecording(const std::string &filename)
+{
+    stop();
+
+    if( !OpenGameFileW(mOutFile, filename, std::ios_base::out | std::ios_base::binary) )
+    {
+        gLogging.ftextOut(FONTCOLORS::RED, "Could not create the input recording \"%s\".<br>", filename.c_str());
+        return false;
+    }
+
+    mFilename = filename;
+    mMode = RECORD;
+    mHeaderWritten = false;
+    mHeader.clear();
+
+    mSeed = Uint32(std::time(nullptr)) ^ SDL_GetTicks();
+    std::srand(mSeed);
+
+    mState.clear();
+    mLastState.assign(CInput::commandStateSize(), 0);
+    mTick = 0;
+    mTickMarks.clear();
+
+    gLogging.ftextOut("Recording the input into \"%s\"<br>", filename.c_str());
+    return true;
+}
+
+
+bool GsInputRecorder::startReplay(const std::string &filename)
+{
+    stop();
+
+    if( !OpenGameFileR(mInFile, filename, std::ios_base::in | std::ios_base::binary) )
+    {
+        gLogging.ftextOut(FONTCOLORS::RED, "Could not open the input recording \"%s\".<br>", filename.c_str());
+        return false;
+    }
+
+    char magic[sizeof(RECORD_MAGIC)];
+    Uint32 version, stateSize, numValues;
+
+    bool ok = mInFile.read(magic, sizeof(magic)) &&
+              memcmp(magic, RECORD_MAGIC, sizeof(magic)) == 0 &&
+              getUint(mInFile, version) && version == RECORD_VERSION &&
+              getUint(mInFile, mSeed) &&
+              getUint(mInFile, stateSize) && stateSize == CInput::commandStateSize() &&
+              getUint(mInFile, numValues);
+
+    mHeader.clear();
+
+    for(Uint32 i=0 ; ok && i<numValues ; i++)
+    {
+        std::string key, value;
+        ok = getString(mInFile, key) && getString(mInFile, value);
+        mHeader[key] = value;
+    }
+
+    if(!ok)
+    {
+        gLogging.ftextOut(FONTCOLORS::RED, "\"%s\" is not an input recording this version can replay.<br>", filename.c_str());
+        mInFile.close();
+        mHeader.clear();
+        return false;
+    }
+
+    mFilename = filename;
+    mMode = REPLAY;
+
+    std::srand(mSeed);
+
+    mState.assign(stateSize, 0);
+    mTick = 0;
+    mHashesChecked = 0;
+    mFirstDivergence = -1;
+    mTickMarks.clear();
+
+    gLogging.ftextOut("Replaying the input from \"%s\"<br>", filename.c_str());
+    return true;
+}
+
+
+void GsInputRecorder::stop()
+{
+    if(mMode == RECORD)
+    {
+        if(!mHeaderWritten)
+            writeHeader();
+
+        mOutFile.close();
+        gLogging.ftextOut("Recorded %lu ticks into \"%s\"<br>", mTick, mFilename.c_str());
+    }
+    else if(mMode == REPLAY)
+    {
+        mInFile.close();
+
+        if(mFirstDivergence < 0)
+        {
+            gLogging.ftextOut(FONTCOLORS::GREEN, "Replay of \"%s\" matched for %lu ticks, %lu state hashes checked.<br>",
+                              mFilename.c_str(), mTick, mHashesChecked);
+        }
+        else
+        {
+            gLogging.ftextOut(FONTCOLORS::RED, "Replay of \"%s\" diverged first at tick %ld.<br>",
+                              mFilename.c_str(), mFirstDivergence);
+        }
+    }
+
+    mMode = IDLE;
+}
+
+
+void GsInputRecorder::setHeaderValue(const std::string &key, const std::string &value)
+{
+    if(mHeaderWritten)
+    {
+        gLogging.ftextOut(FONTCOLORS::RED, "Header value \"%s\" set too late for the input recording.<br>", key.c_str());
+        return;
+    }
+
+    mHeader[key] = value;
+}
+
+
+std::string GsInputRecorder::getHeaderValue(const std::string &key) const
+{
+    const auto it = mHeader.find(key);
+    return (it != mHeader.end()) ? it->second : std::string();
+}
+
+
+void GsInputRecorder::setStateHasher(const std::function<Uint64()> &hasher)
+{
+    mStateHasher = hasher;
+}
+
+
+void GsInputRecorder::mark(const std::string &key, const std::string &value)
+{
+    // Kept until the end of the tick, so one made while the events are processed,
+    // before the tick began, goes with that tick and not with the one before
+    if(mMode != IDLE)
+        mTickMarks.push_back(std::make_pair(key, value));
+}
+
+
+void GsInputRecorder::beginTick()
+{
+    if(mMode == RECORD)
+    {
+        if(!mHeaderWritten)
+            writeHeader();
+
+        gInput.saveCommandState(mState);
+
+        std::vector<Uint16> changed;
+        for(size_t i=0 ; i<mState.size() ; i++)
+        {
+            if(mState[i] != mLastState[i])
+                changed.push_back(Uint16(i));
+        }
+
+        mOutFile.put(char(REC_TICK));
+        putUint(mOutFile, changed.size(), 2);
+
+        for(const Uint16 offset : changed)
+        {
+            putUint(mOutFile, offset, 2);
+            mOutFile.put(char(mState[offset]));
+        }
+
+        mLastState.swap(mState);
+        mTick++;
+    }
+    else if(mMode == REPLAY)
+    {
+        if(mInFile.peek() == std::char_traits<char>::eof())
+        {
+            stop();
+            return;
+        }
+
+        Uint8 type = 0;
+        Uint16 numChanged = 0;
+
+        bool ok = getUint(mInFile, type) && type == REC_TICK &&
+                  getUint(mInFile, numChanged);
+
+        for(Uint16 i=0 ; ok && i<numChanged ; i++)
+        {
+            Uint16 offset;
+            Uint8 value;
+            ok = getUint(mInFile, offset) && getUint(mInFile, value) &&
+                 offset < mState.size();
+
+            if(ok)
+                mState[offset] = value;
+        }
+
+        if(!ok)
+        {
+            diverged("the recording is damaged");
+            stop();
+            return;
+        }
+
+        gInput.loadCommandState(mState);
+        mTick++;
+    }
+}
+
+
+void GsInputRecorder::endTick()
+{
+    if(mMode == RECORD)
+    {
+        for(const auto &tickMark : mTickMarks)
+        {
+            mOutFile.put(char(REC_MARK));
+            putString(mOutFile, tickMark.first);
+            putString(mOutFile, tickMark.second);
+        }
+
+        mTickMarks.clear();
+
+        if(mStateHasher)
+        {
+            mOutFile.put(char(REC_HASH));
+            putUint(mOutFile, mStateHasher(), 8);
+        }
+    }
+    else if(mMode == REPLAY)
+    {
+        size_t markIdx = 0;
+
+        // Everything up to the next tick belongs to this one
+        while(mInFile.peek() != std::char_traits<char>::eof() &&
+              mInFile.peek() != REC_TICK)
+        {
+            Uint8 type = 0;
+            getUint(mInFile, type);
+
+            if(type == REC_MARK)
+            {
+                std::string key, value;
+                getString(mInFile, key);
+                getString(mInFile, value);
+
+                if( markIdx >= mTickMarks.size() ||
+                    mTickMarks[markIdx] != std::make_pair(key, value) )
+                {
+                    diverged("expected " + key + "=" + value);
+                }
+
+                markIdx++;
+            }
+            else if(type == REC_HASH)
+            {
+                Uint64 hash = 0;
+                getUint(mInFile, hash);
+
+                if(mStateHasher)
+                {
+                    mHashesChecked++;
+
+                    if(mStateHasher() != hash)
+                        diverged("the world state differs");
+                }
+            }
+            else
+            {
+                diverged("the recording is damaged");
+                stop();
+                return;
+            }
+        }
+
+        if(markIdx < mTickMarks.size())
+        {
+            diverged("unexpected " + mTickMarks[markIdx].first + "=" + mTickMarks[markIdx].second);
+        }
+
+        mTickMarks.clear();
+    }
+}
+
+
+Uint64 GsInputRecorder::hashBytes(const void *data, const size_t size, const Uint64 seed)
+{
+    const Uint8 *bytes = static_cast<const Uint8*>(data);
+    Uint64 hash = seed;
+
+    for(size_t i=0 ; i<size ; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+
+void GsInputRecorder::writeHeader()
+{
+    mOutFile.write(RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    putUint(mOutFile, RECORD_VERSION, 4);
+    putUint(mOutFile, mSeed, 4);
+    putUint(mOutFile, CInput::commandStateSize(), 4);
+    putUint(mOutFile, mHeader.size(), 4);
+
+    for(const auto &value : mHeader)
+    {
+        putString(mOutFile, value.first);
+        putString(mOutFile, value.second);
+    }
+
+    mHeaderWritten = true;
+}
+
+
+void GsInputRecorder::diverged(const std::string &reason)
+{
+    if(mFirstDivergence >= 0)
+        return;
+
+    mFirstDivergence = long(mTick);
+    gLogging.ftextOut(FONTCOLORS::RED, "Replay diverges at tick %lu: %s<br>", mTick, reason.c_str());
+}
@@ -0,0 +1,134 @@
+/*
+ * GsInputRecorder.h
+ *
+ *  Records what the player commands were on every logic tick, so a session
+ *  can be played back exactly, e.g. to reproduce a desync or to measure the
+ *  same run again after a change.
+ *
+ *  The file starts with a header holding the random seed and whatever values
+ *  the game put there (options and the like). It is followed by one record
+ *  per logic tick with the bytes of the input state that changed since the
+ *  tick before. If the game sets a state hasher, a hash of the world is stored
+ *  after every tick. Markers the game sets (episode, level...) are stored
+ *  in between. While replaying both are compared, and the first tick where
+ *  they differ is reported.
+ */
+
+#ifndef GSINPUTRECORDER_H
+#define GSINPUTRECORDER_H
+
+#include <base/Singleton.h>
+#include <SDL.h>
+
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#define gInputRecorder  GsInputRecorder::get()
+
+class GsInputRecorder : public GsSingleton<GsInputRecorder>
+{
+public:
+
+    /**
+     * @brief startRecording    Starts a new recording into filename.
+     *                          The header is written with the first tick, until then setHeaderValue() may be used.
+     */
+    bool startRecording(const std::string &filename);
+
+    /**
+     * @brief startReplay   Reads the header of a recording and seeds the random generator
+     *                      with it. From the next tick on input comes from the file.
+     */
+    bool startReplay(const std::string &filename);
+
+    /**
+     * @brief stop  Ends recording or replaying and tells how it went in the log
+     */
+    void stop();
+
+    bool recording() const
+    {   return mMode == RECORD;   }
+
+    bool replaying() const
+    {   return mMode == REPLAY;   }
+
+    void setHeaderValue(const std::string &key, const std::string &value);
+
+    /**
+     * @brief getHeaderValue    Values of the recording being replayed, or set for the one being recorded
+     */
+    std::string getHeaderValue(const std::string &key) const;
+
+    /**
+     * @brief setStateHasher    Function that hashes the game world, called after every tick.
+     *                          Pass an empty one when the world goes away.
+     */
+    void setStateHasher(const std::function<Uint64()> &hasher);
+
+    /**
+     * @brief mark  Notes something happening in the current tick, like a level being started.
+     *              Recorded as it is, while replaying it has to come at the same tick.
+     *              Marks set between two ticks, e.g. by events processed before the next one,
+     *              belong to the next tick.
+     */
+    void mark(const std::string &key, const std::string &value);
+
+    /**
+     * @brief beginTick     Call after the input was polled. Records the command state
+     *                      or replaces it by the recorded one.
+     */
+    void beginTick();
+
+    /**
+     * @brief endTick   Call after the logic of the tick. Hashes the world state.
+     */
+    void endTick();
+
+    /**
+     * @brief firstDivergingTick    -1 as long as the replay matches the recording
+     */
+    long firstDivergingTick() const
+    {   return mFirstDivergence;   }
+
+    /**
+     * @brief hashBytes FNV-1a, meant for building state hashes
+     */
+    static Uint64 hashBytes(const void *data, const size_t size, const Uint64 seed = 0xCBF29CE484222325ULL);
+
+private:
+
+    enum Mode
+    {
+        IDLE, RECORD, REPLAY
+    };
+
+    void writeHeader();
+    void diverged(const std::string &reason);
+
+    Mode mMode = IDLE;
+    bool mHeaderWritten = false;
+
+    std::ofstream mOutFile;
+    std::ifstream mInFile;
+    std::string mFilename;
+
+    Uint32 mSeed = 0;
+    std::map<std::string, std::string> mHeader;
+
+    std::function<Uint64()> mStateHasher;
+
+    // Markers the game set in the current tick, written or compared when it ends
+    std::vector< std::pair<std::string, std::string> > mTickMarks;
+
+    std::vector<Uint8> mState;
+    std::vector<Uint8> mLastState;
+
+    unsigned long mTick = 0;
+    unsigned long mHashesChecked = 0;
+    long mFirstDivergence = -1;
+};
+
+#endif // GSINPUTRECORDER_H
@@ -12,9 +12,124 @@
 #include "GsLogging.h"
 #include "utils/FindFile.h"
 #include "utils/Debug.h"
+#include "utils/ThreadPool.h"
 
+#include <SDL.h>
+#include <cstdint>
+#include <vector>
 
-CLogFile::CLogFile() {}
+
+/**
+ * Bounded queue of finished records. Any thread may push, only the writer pops.
+ * Every slot carries a sequence number telling whether it is free or filled for the
+ * current round, so pushing threads only have to agree on a position with one
+ * compare-exchange and never wait for each other.
+ */
+struct CLogFile::LogQueue
+{
+    static const size_t CAPACITY = 1024; // Must be a power of two
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        std::string text;
+    };
+
+    LogQueue() :
+    enqueuePos(0),
+    dequeuePos(0),
+    quit(false)
+    {
+        for(size_t i=0 ; i<CAPACITY ; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+
+        wakeMutex = SDL_CreateMutex();
+        wake = SDL_CreateCond();
+    }
+
+    ~LogQueue()
+    {
+        SDL_DestroyCond(wake);
+        SDL_DestroyMutex(wakeMutex);
+    }
+
+    // Takes over text if there was room for it
+    bool push(std::string &text)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot *slot;
+
+        while(1)
+        {
+            slot = &slots[pos & (CAPACITY-1)];
+            const size_t seq = slot->sequence.load(std::memory_order_acquire);
+            // Taken as signed, so the comparison survives the wraparound of the positions
+            const intptr_t diff = intptr_t(seq - pos);
+
+            if(diff == 0)
+            {
+                if(enqueuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+            {
+                return false; // Full
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->text.swap(text);
+        slot->sequence.store(pos+1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(std::string &text)
+    {
+        Slot &slot = slots[dequeuePos & (CAPACITY-1)];
+        const size_t seq = slot.sequence.load(std::memory_order_acquire);
+
+        if(intptr_t(seq - (dequeuePos+1)) < 0)
+            return false; // Empty or the record is still being put in
+
+        text.swap(slot.text);
+        slot.text.clear();
+        slot.sequence.store(dequeuePos+CAPACITY, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+    Slot slots[CAPACITY];
+    std::atomic<size_t> enqueuePos;
+    size_t dequeuePos;
+
+    bool quit; // Guarded by wakeMutex
+    // Also held while writing straight to the file once the writer is stopped
+    SDL_mutex *wakeMutex;
+    SDL_cond *wake;
+};
+
+
+struct LogWriterAction : public Action
+{
+    LogWriterAction(CLogFile &log) : mLog(log) {}
+
+    int handle()
+    {
+        mLog.runWriter();
+        return 0;
+    }
+
+    CLogFile &mLog;
+};
+
+
+CLogFile::CLogFile() :
+mWriterRunning(false),
+mPushing(0)
+{}
 
 bool CLogFile::CreateLogfile(const std::string &logFName,
                              const std::string &appName,
@@ -85,9 +200,112 @@ bool CLogFile::CreateLogfile(const std::string &logFName,
     // Reopen it in append mode for further writing.
     OpenGameFileW(mLogStream, logFName, std::ios_base::app);
 
+    startWriter();
+
     return true;
 }
 
+
+void CLogFile::startWriter()
+{
+    if(mpWriter || !threadPool)
+        return;
+
+    if(!mpQueue)
+        mpQueue.reset(new LogQueue);
+
+    mpQueue->quit = false;
+    mWriterRunning = true;
+    mpWriter = threadPool->start(new LogWriterAction(*this), "Log writer");
+
+    if(!mpWriter)
+        mWriterRunning = false;
+}
+
+
+void CLogFile::stopWriter()
+{
+    if(!mpWriter)
+        return;
+
+    SDL_mutexP(mpQueue->wakeMutex);
+    mpQueue->quit = true;
+    SDL_mutexV(mpQueue->wakeMutex);
+    SDL_CondSignal(mpQueue->wake);
+
+    threadPool->wait(mpWriter, nullptr);
+    mpWriter = nullptr;
+
+    // Records from now on are written right away, under the same lock as the last drain.
+    // Those still being put into the queue are waited for, so that drain gets them.
+    SDL_mutexP(mpQueue->wakeMutex);
+    mWriterRunning = false;
+
+    while(mPushing > 0)
+        SDL_Delay(0);
+
+    drainQueue();
+    mLogStream.flush();
+    SDL_mutexV(mpQueue->wakeMutex);
+}
+
+
+void CLogFile::runWriter()
+{
+    while(1)
+    {
+        drainQueue();
+
+        SDL_mutexP(mpQueue->wakeMutex);
+
+        if(mpQueue->quit)
+        {
+            SDL_mutexV(mpQueue->wakeMutex);
+            break;
+        }
+
+        // Batching a few records costs less than waking up for every single one
+        SDL_CondWaitTimeout(mpQueue->wake, mpQueue->wakeMutex, 20);
+        SDL_mutexV(mpQueue->wakeMutex);
+    }
+
+    drainQueue();
+}
+
+
+void CLogFile::drainQueue()
+{
+    std::string record;
+    std::string batch;
+
+    while(mpQueue->pop(record))
+    {
+        const std::string output = removeHTML(record);
+        if( output.length() > 0 ) {
+            notes << output << endl;
+        }
+
+        batch += record;
+    }
+
+    if(!batch.empty())
+    {
+        mLogStream << batch;
+        mLogStream.flush();
+    }
+}
+
+
+void CLogFile::writeRecord(const std::string &text)
+{
+    const std::string output = removeHTML(text);
+    if( output.length() > 0 ) {
+        notes << output << endl;
+    }
+
+    mLogStream << text;
+}
+
 // Function for writing the topic
 void CLogFile::WriteTopic(const char *Topic, int Size)
 {    
@@ -140,49 +358,102 @@ void CLogFile::textOut(FONTCOLORS Color, bool List, const std::string& Text)
 }
 
 
+// Drops everything between '<' and '>' in one pass.
+// A '<' which is never closed is kept with the rest of the text.
 std::string CLogFile::removeHTML(const std::string& input)
 {
-    std::string::size_type left, right;
     std::string output;
-	
-    output = input;
-    do {
-        left  = output.find_first_of('<', 0);
-        right = output.find_first_of('>', 0);
-		
-        if( left == std::string::npos || right == std::string::npos )
-            break;
-		
-        output = output.erase( left, right-left+1 );
-    } while( 1 );
-	
+    output.reserve(input.size());
+
+    std::string::size_type tagStart = std::string::npos;
+
+    for( std::string::size_type i=0 ; i<input.size() ; i++ )
+    {
+        const char c = input[i];
+
+        if( tagStart == std::string::npos )
+        {
+            if( c == '<' )
+                tagStart = i;
+            else
+                output += c;
+        }
+        else if( c == '>' )
+        {
+            tagStart = std::string::npos;
+        }
+    }
+
+    if( tagStart != std::string::npos )
+        output.append(input, tagStart, std::string::npos);
+
     return output;
 }
 
 void CLogFile::textOut(const std::string& text)
 {    
-    std::string output;
-	
-    output = removeHTML(text);
-    if( output.length() > 0 ) {
-        notes << output << endl;
+    if(mWriterRunning)
+    {
+        // Counted before the flag is checked again, see stopWriter()
+        mPushing++;
+        std::string record(text);
+
+        while(mWriterRunning)
+        {
+            if(mpQueue->push(record))
+            {
+                mPushing--;
+                return;
+            }
+
+            // Queue is full, let the writer catch up
+            SDL_CondSignal(mpQueue->wake);
+            SDL_Delay(1);
+        }
+
+        mPushing--;
     }
 
-    mLogStream << text;
+    if(!mpQueue)
+    {
+        writeRecord(text);
+        return;
+    }
+
+    SDL_mutexP(mpQueue->wakeMutex);
+    writeRecord(text);
+    SDL_mutexV(mpQueue->wakeMutex);
 }
 
 const int MAX_BUFFER = 1024;
 
-void CLogFile::ftextOut(const char *Text, ...)
+// Formats into a stack buffer, only really long messages go to the heap
+static std::string formatText(const char *Text, va_list pArgList)
 {
 	char buffer[MAX_BUFFER];
 
-    memset(buffer, 0, MAX_BUFFER);
+	va_list argsCopy;
+	va_copy(argsCopy, pArgList);
+	const int len = vsnprintf(buffer, MAX_BUFFER, Text, argsCopy);
+	va_end(argsCopy);
+
+	if(len < 0)
+		return std::string();
+
+	if(len < MAX_BUFFER)
+		return std::string(buffer, len);
 
+	std::vector<char> longBuffer(len+1);
+	vsnprintf(longBuffer.data(), longBuffer.size(), Text, pArgList);
+	return std::string(longBuffer.data(), len);
+}
+
+void CLogFile::ftextOut(const char *Text, ...)
+{
 	va_list pArgList;
 	
 	va_start(pArgList, Text);
-	vsprintf(buffer, Text, pArgList);
+	const std::string buffer = formatText(Text, pArgList);
 	va_end(pArgList);
 	
 	textOut(buffer);
@@ -190,11 +461,10 @@ void CLogFile::ftextOut(const char *Text, ...)
 
 void CLogFile::fltextOut(FONTCOLORS Color, bool List, const char *Text, ...)
 {
-	char buffer[MAX_BUFFER];
 	va_list pArgList;
 	
 	va_start(pArgList, Text);
-	vsprintf(buffer, Text, pArgList);
+	const std::string buffer = formatText(Text, pArgList);
 	va_end(pArgList);
 	
 	textOut(Color, List, buffer);
@@ -205,12 +475,11 @@ void CLogFile::fltextOut(FONTCOLORS Color, bool List, const char *Text, ...)
 
 void CLogFile::ftextOut(FONTCOLORS Color, const char *Text, ...)
 {
-	char buffer[MAX_BUFFER];
 	va_list pArgList;
 	va_start(pArgList, Text);
-	vsprintf(buffer, Text, pArgList);
-	textOut(Color, buffer);
+	const std::string buffer = formatText(Text, pArgList);
 	va_end(pArgList);
+	textOut(Color, buffer);
 }
 
 CLogFile & CLogFile::operator << (const char *txt)
@@ -255,6 +524,10 @@ void CLogFile::FunctionResult (const char *Name,bool Result)
 
 CLogFile::~CLogFile()
 {
+	// Normally stopped already, the pool may not be waited on after it was uninitialized
+	if(threadPool)
+		stopWriter();
+
 	// Logfile End
 	textOut ("<br><br>End of logfile</font></body></html>");
 }
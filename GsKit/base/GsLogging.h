@@ -11,12 +11,16 @@
 #include <base/Singleton.h>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <atomic>
 
 const std::string APP_NAME = "Commander Genius";
 
 // Singleton macro
 #define  gLogging (CLogFile::get())
 
+struct ThreadPoolItem;
+
 
 enum class FONTCOLORS
 {
@@ -59,9 +63,36 @@ public:
     CLogFile & operator << (const std::string &str);
     CLogFile & operator << (const int val);
 
+    /**
+     * @brief startWriter   From now on the records are queued and written by a thread of the pool.
+     *                      Logging is safe from any thread then. CreateLogfile() starts it.
+     */
+    void startWriter();
+
+    /**
+     * @brief stopWriter    Writes everything still queued and ends the writer thread.
+     *                      Must be called before the thread pool is uninitialized,
+     *                      afterwards everything is written right away again.
+     */
+    void stopWriter();
+
 private:
 
+    friend struct LogWriterAction;
+
+    struct LogQueue;
+
+    void writeRecord(const std::string &text);
+    void drainQueue();
+    void runWriter();
+
     std::ofstream mLogStream;
+
+    std::unique_ptr<LogQueue> mpQueue;
+    ThreadPoolItem *mpWriter = nullptr;
+    std::atomic<bool> mWriterRunning;
+    // Threads busy putting a record into the queue
+    std::atomic<unsigned int> mPushing;
 	
     std::string removeHTML(const std::string& input);
 };
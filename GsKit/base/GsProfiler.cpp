@@ -0,0 +1,349 @@
+/*
+ * GsProfiler.cpp
+ */
+
+#include "GsProfiler.h"
+
+#include <base/GsTimer.h>
+#include <base/video/CVideoDriver.h>
+#include <base/utils/FindFile.h>
+#include <graphics/GsSurface.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+
+// More zones than that would make the overlay unreadable anyway
+const size_t MAX_GRAPH_LINES = 8;
+
+const int GRAPH_HEIGHT = 60;
+
+const Uint8 GRAPH_COLORS[MAX_GRAPH_LINES][3] =
+{
+    { 0x40, 0xC0, 0x40 }, { 0x40, 0x80, 0xFF }, { 0xFF, 0xC0, 0x40 }, { 0xFF, 0x40, 0x40 },
+    { 0xC0, 0x40, 0xFF }, { 0x40, 0xFF, 0xFF }, { 0xFF, 0x80, 0xC0 }, { 0xA0, 0xA0, 0xA0 }
+};
+
+// Zones nested deeper are not checked for a parent of the same name
+const int MAX_ZONE_NAMES = 64;
+
+thread_local int zoneDepth = 0;
+thread_local const char *zoneNames[MAX_ZONE_NAMES];
+
+}
+
+
+std::atomic<bool> GsProfiler::sEnabled(false);
+std::atomic<bool> GsProfiler::sKeepTotals(false);
+thread_local GsProfiler::ThreadRing *GsProfiler::sThreadRing = nullptr;
+
+
+GsProfiler::GsProfiler()
+{
+    mpRingsMutex = SDL_CreateMutex();
+    mpTotalsMutex = SDL_CreateMutex();
+}
+
+
+GsProfiler::ThreadRing &GsProfiler::threadRing()
+{
+    if(!sThreadRing)
+    {
+        SDL_mutexP(mpRingsMutex);
+
+        mRings.emplace_back(new ThreadRing);
+        mRings.back()->thread = int(mRings.size());
+        sThreadRing = mRings.back().get();
+
+        SDL_mutexV(mpRingsMutex);
+    }
+
+    return *sThreadRing;
+}
+
+
+GsProfileSample GsProfiler::RingSlot::load() const
+{
+    return GsProfileSample{ name.load(std::memory_order_relaxed),
+                            start.load(std::memory_order_relaxed),
+                            end.load(std::memory_order_relaxed),
+                            depth.load(std::memory_order_relaxed) };
+}
+
+
+void GsProfiler::record(const char *name, const Uint64 start, const Uint64 end, const int depth)
+{
+    ThreadRing &ring = threadRing();
+    const Uint64 seq = ring.written.load(std::memory_order_relaxed);
+
+    // A collector which sees any of the new fields also sees writing at seq+1,
+    // and so knows the slot's previous sample is being overwritten
+    ring.writing.store(seq+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    RingSlot &slot = ring.samples[seq & (RING_SIZE-1)];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.depth.store(depth, std::memory_order_relaxed);
+
+    ring.written.store(seq+1, std::memory_order_release);
+}
+
+
+void GsProfiler::keepTotals(const bool keep)
+{
+    SDL_mutexP(mpTotalsMutex);
+    mTotals.clear();
+    sKeepTotals = keep;
+    SDL_mutexV(mpTotalsMutex);
+}
+
+
+void GsProfiler::addTotal(const char *name, const Uint64 counts)
+{
+    SDL_mutexP(mpTotalsMutex);
+
+    if(keepingTotals())
+    {
+        auto it = std::find_if(mTotals.begin(), mTotals.end(),
+                               [name](const GsProfileTotal &total)
+                               { return strcmp(total.name, name) == 0; });
+
+        if(it == mTotals.end())
+        {
+            mTotals.push_back(GsProfileTotal{name, 0, 0});
+            it = mTotals.end()-1;
+        }
+
+        it->counts += counts;
+        it->calls++;
+    }
+
+    SDL_mutexV(mpTotalsMutex);
+}
+
+
+std::vector<GsProfileTotal> GsProfiler::totals()
+{
+    SDL_mutexP(mpTotalsMutex);
+    const std::vector<GsProfileTotal> result = mTotals;
+    SDL_mutexV(mpTotalsMutex);
+
+    return result;
+}
+
+
+void GsProfiler::endFrame()
+{
+    if(!isEnabled())
+        return;
+
+    ThreadRing &ring = threadRing();
+    const Uint64 written = ring.written.load(std::memory_order_relaxed);
+    const Uint64 oldest = (written > RING_SIZE) ? written-RING_SIZE : 0;
+
+    const double msPerCount = 1000.0 / double(frequency());
+    std::vector<float> frameMs(MAX_GRAPH_LINES, 0.0f);
+
+    for(Uint64 seq = std::max(mFrameStart, oldest) ; seq < written ; seq++)
+    {
+        const GsProfileSample sample = ring.samples[seq & (RING_SIZE-1)].load();
+
+        if(sample.depth != 0)
+            continue;
+
+        size_t line = 0;
+        while( line < mGraph.size() && strcmp(mGraph[line].name, sample.name) != 0 )
+            line++;
+
+        if(line == mGraph.size())
+        {
+            if(mGraph.size() >= MAX_GRAPH_LINES)
+                continue;
+
+            GraphLine newLine;
+            newLine.name = sample.name;
+            std::fill(newLine.ms, newLine.ms+HISTORY_SIZE, 0.0f);
+            mGraph.push_back(newLine);
+        }
+
+        frameMs[line] += float(double(sample.end - sample.start) * msPerCount);
+    }
+
+    for(size_t line=0 ; line<mGraph.size() ; line++)
+    {
+        mGraph[line].ms[mHistoryPos] = frameMs[line];
+    }
+
+    mHistoryPos = (mHistoryPos+1) % HISTORY_SIZE;
+    mFrameStart = written;
+}
+
+
+void GsProfiler::renderOverlay()
+{
+    if(!mShowOverlay || !isEnabled())
+        return;
+
+    SDL_Surface *blitSfc = gVideoDriver.getBlitSurface();
+    if(!blitSfc || blitSfc->h < GRAPH_HEIGHT+8 || blitSfc->w < int(HISTORY_SIZE)+8)
+        return;
+
+    GsWeakSurface blit(blitSfc);
+
+    const int left = 4;
+    const int bottom = blitSfc->h - 4;
+
+    // One logic tick takes half of the graph's height
+    const float tickMs = gTimer.LogicLatency();
+    const float pixelsPerMs = (tickMs > 0.0f) ? float(GRAPH_HEIGHT/2)/tickMs : 1.0f;
+
+    blit.fillRGB(GsRect<Uint16>(left, bottom-GRAPH_HEIGHT, Uint16(HISTORY_SIZE), GRAPH_HEIGHT), 0, 0, 0);
+
+    for(size_t i=0 ; i<HISTORY_SIZE ; i++)
+    {
+        // Oldest frame on the left
+        const size_t frame = (mHistoryPos+i) % HISTORY_SIZE;
+        int top = bottom;
+
+        for(size_t line=0 ; line<mGraph.size() ; line++)
+        {
+            const int height = std::min(int(mGraph[line].ms[frame]*pixelsPerMs+0.5f), top-(bottom-GRAPH_HEIGHT));
+
+            if(height <= 0)
+                continue;
+
+            top -= height;
+
+            const Uint8 *color = GRAPH_COLORS[line];
+            blit.fillRGB(GsRect<Uint16>(left+i, top, 1, height), color[0], color[1], color[2]);
+        }
+    }
+
+    blit.fillRGB(GsRect<Uint16>(left, bottom-GRAPH_HEIGHT/2, Uint16(HISTORY_SIZE), 1), 0xFF, 0xFF, 0xFF);
+}
+
+
+void GsProfiler::collectSamples(std::vector<GsProfileSample> &samples,
+                                std::vector<int> &threads)
+{
+    samples.clear();
+    threads.clear();
+
+    SDL_mutexP(mpRingsMutex);
+
+    for(const auto &ring : mRings)
+    {
+        const Uint64 before = ring->written.load(std::memory_order_acquire);
+        const Uint64 oldest = (before > RING_SIZE) ? before-RING_SIZE : 0;
+        const size_t first = samples.size();
+
+        for(Uint64 seq=oldest ; seq<before ; seq++)
+        {
+            samples.push_back(ring->samples[seq & (RING_SIZE-1)].load());
+        }
+
+        // The thread may have gone on writing meanwhile. What it began to overwrite is dropped.
+        // The fence keeps the copies above from being read after writing is.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const Uint64 begun = ring->writing.load(std::memory_order_relaxed);
+        const Uint64 firstIntact = (begun > RING_SIZE) ? begun-RING_SIZE : 0;
+        const size_t skip = size_t(std::min(before, std::max(firstIntact, oldest)) - oldest);
+
+        samples.erase(samples.begin()+first, samples.begin()+first+skip);
+        threads.resize(samples.size(), ring->thread);
+    }
+
+    SDL_mutexV(mpRingsMutex);
+}
+
+
+bool GsProfiler::exportChromeTrace(const std::string &filename)
+{
+    std::vector<GsProfileSample> samples;
+    std::vector<int> threads;
+    collectSamples(samples, threads);
+
+    std::ofstream file;
+    if(!OpenGameFileW(file, filename))
+        return false;
+
+    Uint64 base = ~Uint64(0);
+    for(const auto &sample : samples)
+    {
+        base = std::min(base, sample.start);
+    }
+
+    const double usPerCount = 1000000.0 / double(frequency());
+
+    file << "{\"traceEvents\":[\n";
+
+    for(size_t i=0 ; i<samples.size() ; i++)
+    {
+        const GsProfileSample &sample = samples[i];
+
+        file << "{\"name\":\"" << sample.name << "\",\"ph\":\"X\""
+             << ",\"ts\":" << double(sample.start-base)*usPerCount
+             << ",\"dur\":" << double(sample.end-sample.start)*usPerCount
+             << ",\"pid\":1,\"tid\":" << threads[i] << "}"
+             << (i+1 < samples.size() ? ",\n" : "\n");
+    }
+
+    file << "]}\n";
+
+    return bool(file);
+}
+
+
+Uint64 GsProfiler::counter()
+{
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    return SDL_GetPerformanceCounter();
+#else
+    return SDL_GetTicks();
+#endif
+}
+
+
+Uint64 GsProfiler::frequency()
+{
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    return SDL_GetPerformanceFrequency();
+#else
+    return 1000;
+#endif
+}
+
+
+void GsProfileZone::begin(const char *name)
+{
+    mName = name;
+
+    if(GsProfiler::keepingTotals())
+    {
+        const int parents = std::min(zoneDepth, MAX_ZONE_NAMES);
+        for(int i=0 ; i<parents && !mNested ; i++)
+            mNested = (strcmp(zoneNames[i], name) == 0);
+    }
+
+    if(zoneDepth < MAX_ZONE_NAMES)
+        zoneNames[zoneDepth] = name;
+
+    zoneDepth++;
+    mStart = GsProfiler::counter();
+}
+
+
+void GsProfileZone::end()
+{
+    const Uint64 end = GsProfiler::counter();
+    zoneDepth--;
+    gProfiler.record(mName, mStart, end, zoneDepth);
+
+    if(!mNested && GsProfiler::keepingTotals())
+        gProfiler.addTotal(mName, end-mStart);
+}
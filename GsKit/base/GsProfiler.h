@@ -0,0 +1,207 @@
+/*
+ * GsProfiler.h
+ *
+ *  Lightweight profiler for finding where the time of a frame goes.
+ *
+ *  A GsProfileZone measures its scope with the performance counter. Every thread
+ *  writes its samples into a ring of its own, so recording needs no locking.
+ *  When the profiler is disabled, a zone only tests one flag.
+ *
+ *  Started with "profile=1" on the command line, "profile=overlay" also draws
+ *  a rolling graph of the outermost zones of the main thread on top of the game.
+ *  "profiletrace=<file>" writes the samples still held in the rings as Chrome
+ *  trace JSON (chrome://tracing) at shutdown.
+ *
+ *  The benchmark also keeps the totals of every zone. A zone nested in one of
+ *  the same name, e.g. in a recursive function, is counted only once.
+ */
+
+#ifndef GSPROFILER_H
+#define GSPROFILER_H
+
+#include <base/Singleton.h>
+#include <SDL.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define gProfiler   GsProfiler::get()
+
+#define GS_PROFILE_CONCAT2(a, b)  a##b
+#define GS_PROFILE_CONCAT(a, b)   GS_PROFILE_CONCAT2(a, b)
+
+/**
+ * Measures the rest of the enclosing scope. name must be a string literal or
+ * otherwise stay valid, only the pointer is stored.
+ */
+#define GS_PROFILE_ZONE(name)   GsProfileZone GS_PROFILE_CONCAT(gsProfileZone, __LINE__)(name)
+
+struct GsProfileSample
+{
+    const char *name;
+    Uint64 start;
+    Uint64 end;
+    int depth;
+};
+
+struct GsProfileTotal
+{
+    const char *name;
+    Uint64 counts;
+    Uint64 calls;
+};
+
+class GsProfiler : public GsSingleton<GsProfiler>
+{
+public:
+
+    // Samples kept per thread, must be a power of two
+    static const size_t RING_SIZE = 8192;
+
+    // Frames shown in the overlay graph
+    static const size_t HISTORY_SIZE = 128;
+
+    GsProfiler();
+
+    static bool isEnabled()
+    {   return sEnabled.load(std::memory_order_relaxed);   }
+
+    void setEnabled(const bool enabled)
+    {   sEnabled = enabled;   }
+
+    void showOverlay(const bool show)
+    {   mShowOverlay = show;   }
+
+    /**
+     * @brief record    Stores a finished zone in the ring of the calling thread
+     */
+    void record(const char *name, const Uint64 start, const Uint64 end, const int depth);
+
+    static bool keepingTotals()
+    {   return sKeepTotals.load(std::memory_order_relaxed);   }
+
+    /**
+     * @brief keepTotals    Starts summing up the zones from zero, or stops it
+     */
+    void keepTotals(const bool keep);
+
+    /**
+     * @brief addTotal  Accounts a finished zone to the totals. May be called from any thread.
+     */
+    void addTotal(const char *name, const Uint64 counts);
+
+    /**
+     * @brief totals    The zones summed up so far, in the order they first finished
+     */
+    std::vector<GsProfileTotal> totals();
+
+    /**
+     * @brief endFrame  Called by the main thread after every frame.
+     *                  Sums up the outermost zones of that frame for the overlay.
+     */
+    void endFrame();
+
+    /**
+     * @brief renderOverlay Draws the frame history as stacked bars, one colour per zone,
+     *                      with a line at the duration of one logic tick.
+     */
+    void renderOverlay();
+
+    /**
+     * @brief collectSamples    Copies the samples of all threads which are still complete in their rings.
+     *                          The threads may go on recording meanwhile, what they overwrite is left out.
+     * @param threads           receives the thread number of every sample
+     */
+    void collectSamples(std::vector<GsProfileSample> &samples,
+                        std::vector<int> &threads);
+
+    /**
+     * @brief exportChromeTrace Writes the samples in Chrome's trace event format
+     */
+    bool exportChromeTrace(const std::string &filename);
+
+    static Uint64 counter();
+    static Uint64 frequency();
+
+private:
+
+    /**
+     * A sample in the ring. Other threads may copy it while its thread overwrites it,
+     * so the fields are atomics. Relaxed, as written tells if the copy is any good.
+     */
+    struct RingSlot
+    {
+        std::atomic<const char*> name;
+        std::atomic<Uint64> start;
+        std::atomic<Uint64> end;
+        std::atomic<int> depth;
+
+        GsProfileSample load() const;
+    };
+
+    struct ThreadRing
+    {
+        int thread = 0;
+        std::vector<RingSlot> samples;
+        std::atomic<Uint64> writing;    // Samples begun
+        std::atomic<Uint64> written;    // Samples complete
+
+        ThreadRing() : samples(RING_SIZE), writing(0), written(0) {}
+    };
+
+    struct GraphLine
+    {
+        const char *name;
+        float ms[HISTORY_SIZE];
+    };
+
+    ThreadRing &threadRing();
+
+    static std::atomic<bool> sEnabled;
+    static std::atomic<bool> sKeepTotals;
+    static thread_local ThreadRing *sThreadRing;
+
+    SDL_mutex *mpRingsMutex = nullptr;
+    std::vector< std::unique_ptr<ThreadRing> > mRings;
+
+    SDL_mutex *mpTotalsMutex = nullptr;
+    std::vector<GsProfileTotal> mTotals;
+
+    Uint64 mFrameStart = 0;
+
+    bool mShowOverlay = false;
+    std::vector<GraphLine> mGraph;
+    size_t mHistoryPos = 0;
+};
+
+
+class GsProfileZone
+{
+public:
+
+    // Inline, so a disabled profiler costs no more than the flag test
+    GsProfileZone(const char *name)
+    {
+        if(GsProfiler::isEnabled())
+            begin(name);
+    }
+
+    ~GsProfileZone()
+    {
+        if(mName)
+            end();
+    }
+
+private:
+
+    void begin(const char *name);
+    void end();
+
+    const char *mName = nullptr;
+    Uint64 mStart = 0;
+    bool mNested = false;
+};
+
+#endif // GSPROFILER_H
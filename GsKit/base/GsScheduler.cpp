@@ -0,0 +1,191 @@
+/*
+ * GsScheduler.cpp
+ */
+
+#include "GsScheduler.h"
+
+#include <base/GsTimer.h>
+#include <base/GsProfiler.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const Uint64 NS_PER_SEC = 1000000000;
+const Uint64 NS_PER_MS = 1000000;
+
+// Rates are taken with three decimals, 1e9 ns times that
+const Uint64 RATE_SCALE = 1000;
+
+// More than that is not taken from one frame, so the scaled times cannot overflow
+const Uint64 MAX_ELAPSED_NS = NS_PER_SEC;
+
+Uint64 gcd(Uint64 a, Uint64 b)
+{
+    while(b != 0)
+    {
+        const Uint64 r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+}
+
+
+GsScheduler::GsScheduler() :
+GsScheduler(GsProfiler::counter, GsProfiler::frequency(),
+            [](const Uint32 ms) { timerDelay(ms); })
+{}
+
+
+GsScheduler::GsScheduler(const Clock &clock, const Uint64 frequency, const Sleeper &sleeper) :
+mClock(clock),
+mFrequency(frequency),
+mSleeper(sleeper),
+mBase(clock())
+{}
+
+
+GsScheduler::Period GsScheduler::periodOf(const float perSecond)
+{
+    Period period;
+
+    const Uint64 rate = (perSecond > 0.0f) ? Uint64(std::llround(double(perSecond)*RATE_SCALE)) : 0;
+    if(rate == 0)
+        return period;
+
+    const Uint64 divisor = gcd(NS_PER_SEC*RATE_SCALE, rate);
+    period.num = NS_PER_SEC*RATE_SCALE / divisor;
+    period.den = rate / divisor;
+
+    return period;
+}
+
+
+void GsScheduler::setTickRate(const float lps)
+{
+    if(lps == mTickRate)
+        return;
+
+    const Period newPeriod = periodOf(lps);
+
+    // Keep what is accumulated, up to the nanosecond
+    mAcc = (mTickPeriod.num != 0) ? (mAcc / mTickPeriod.den) * newPeriod.den : 0;
+
+    mTickRate = lps;
+    mTickPeriod = newPeriod;
+}
+
+
+void GsScheduler::setFrameRate(const float fps)
+{
+    if(fps == mFrameRate)
+        return;
+
+    // The next deadline stays, if it is too far off endFrame() catches up
+    mFrameRate = fps;
+    mFramePeriod = periodOf(fps);
+    mNextFrameRem = 0;
+}
+
+
+void GsScheduler::reset()
+{
+    mLastNs = now();
+    mAcc = 0;
+    mNextFrame = mLastNs;
+    mNextFrameRem = 0;
+}
+
+
+int GsScheduler::beginFrame()
+{
+    const Uint64 nowNs = now();
+
+    mLastFrameNs = nowNs - mLastNs;
+    mLastNs = nowNs;
+
+    if(mTickPeriod.num == 0)
+        return 0;
+
+    mAcc += std::min(mLastFrameNs, MAX_ELAPSED_NS) * mTickPeriod.den;
+
+    Uint64 ticks = mAcc / mTickPeriod.num;
+    mAcc -= ticks * mTickPeriod.num;
+
+    // The logic can't keep up. Catching up would only make the next frame later again.
+    if(ticks > Uint64(MAX_TICKS_PER_FRAME))
+    {
+        mDroppedTicks += ticks - MAX_TICKS_PER_FRAME;
+        ticks = MAX_TICKS_PER_FRAME;
+    }
+
+    return int(ticks);
+}
+
+
+void GsScheduler::endFrame(const bool vsync)
+{
+    // Presentation waits for the display already, or no limit is wanted
+    if(vsync || mFramePeriod.num == 0)
+        return;
+
+    const Uint64 periodNs = mFramePeriod.num / mFramePeriod.den;
+
+    mNextFrame += periodNs;
+    mNextFrameRem += mFramePeriod.num % mFramePeriod.den;
+    if(mNextFrameRem >= mFramePeriod.den)
+    {
+        mNextFrameRem -= mFramePeriod.den;
+        mNextFrame++;
+    }
+
+    const Uint64 nowNs = now();
+
+    if(nowNs >= mNextFrame)
+    {
+        // A bit late is made up by the next frames, otherwise go on from here
+        if(nowNs - mNextFrame > periodNs)
+        {
+            mNextFrame = nowNs;
+            mNextFrameRem = 0;
+        }
+        return;
+    }
+
+    waitUntil(mNextFrame);
+}
+
+
+Uint64 GsScheduler::now() const
+{
+    const Uint64 counts = mClock() - mBase;
+
+    // Split up, so large counts don't overflow
+    return (counts / mFrequency) * NS_PER_SEC +
+           (counts % mFrequency) * NS_PER_SEC / mFrequency;
+}
+
+
+void GsScheduler::waitUntil(const Uint64 deadline)
+{
+    while(1)
+    {
+        const Uint64 nowNs = now();
+        if(nowNs >= deadline)
+            return;
+
+        const Uint64 remaining = deadline - nowNs;
+
+        // A delay of zero gives up the rest of the time slice, so the spin
+        // doesn't keep a core busy and other threads still get their turn
+        if(remaining > SPIN_MARGIN_NS + NS_PER_MS)
+            mSleeper( Uint32((remaining - SPIN_MARGIN_NS) / NS_PER_MS) );
+        else
+            mSleeper(0);
+    }
+}
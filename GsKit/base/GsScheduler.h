@@ -0,0 +1,122 @@
+/*
+ * GsScheduler.h
+ *
+ *  Fixed timestep scheduler of the main cycle.
+ *
+ *  Time is kept in integer nanoseconds, measured from one base on, so no error
+ *  adds up from frame to frame. Logic ticks and frames have rational periods,
+ *  1e9/LPS ns are not rounded, which makes the number of ticks after any time
+ *  exactly what the LPS say, e.g. 70 LPS run 70 ticks per second.
+ *
+ *  Waiting for the next frame sleeps while it is far away and spins for the
+ *  last bit, as the sleep of most systems overshoots by a millisecond or more.
+ *  The spin yields with a sleep of zero on every round.
+ *  With vsync or without frame limit, the presentation paces the cycle
+ *  and nothing is waited for.
+ */
+
+#ifndef GSSCHEDULER_H
+#define GSSCHEDULER_H
+
+#include <SDL.h>
+
+#include <functional>
+
+class GsScheduler
+{
+public:
+
+    typedef std::function<Uint64()> Clock;
+    typedef std::function<void(const Uint32 ms)> Sleeper;
+
+    // If the logic falls behind more than that, the rest of the ticks is dropped
+    static const int MAX_TICKS_PER_FRAME = 8;
+
+    // The last part of the wait which is spun instead of slept
+    static const Uint64 SPIN_MARGIN_NS = 2000000;
+
+    /**
+     * @brief GsScheduler   Uses the performance counter and timerDelay
+     */
+    GsScheduler();
+
+    /**
+     * @brief GsScheduler   Uses any other clock, which counts frequency times per second
+     */
+    GsScheduler(const Clock &clock, const Uint64 frequency, const Sleeper &sleeper);
+
+    /**
+     * @brief setTickRate   Sets the logic ticks per second. Ticks which are due already stay due.
+     */
+    void setTickRate(const float lps);
+
+    /**
+     * @brief setFrameRate  Sets the frames per second, zero or less for no limit
+     */
+    void setFrameRate(const float fps);
+
+    /**
+     * @brief reset Starts counting from now on, without any ticks due
+     */
+    void reset();
+
+    /**
+     * @brief beginFrame    Takes the time passed since the last call
+     * @return number of logic ticks to perform in this frame
+     */
+    int beginFrame();
+
+    /**
+     * @brief endFrame  Waits until the next frame is due, unless vsync paces the frames
+     */
+    void endFrame(const bool vsync);
+
+    /**
+     * @brief now   Nanoseconds since the scheduler has been created
+     */
+    Uint64 now() const;
+
+    // Time between the beginning of the last two frames
+    Uint64 lastFrameNs() const
+    {   return mLastFrameNs;    }
+
+    // Ticks dropped, because the logic could not keep up
+    Uint64 droppedTicks() const
+    {   return mDroppedTicks;    }
+
+private:
+
+    struct Period
+    {
+        // num/den nanoseconds
+        Uint64 num = 0;
+        Uint64 den = 1;
+    };
+
+    static Period periodOf(const float perSecond);
+
+    void waitUntil(const Uint64 deadline);
+
+    Clock mClock;
+    Uint64 mFrequency;
+    Sleeper mSleeper;
+    Uint64 mBase;
+
+    float mTickRate = 0.0f;
+    Period mTickPeriod;
+
+    // Unused time in 1/den ns of the tick period
+    Uint64 mAcc = 0;
+    Uint64 mLastNs = 0;
+    Uint64 mLastFrameNs = 0;
+    Uint64 mDroppedTicks = 0;
+
+    float mFrameRate = 0.0f;
+    Period mFramePeriod;
+
+    // Next frame is due at mNextFrame + mNextFrameRem/den ns
+    Uint64 mNextFrame = 0;
+    Uint64 mNextFrameRem = 0;
+};
+
+#endif // GSSCHEDULER_H
@@ -13,6 +13,8 @@
 CTimer::CTimer() :
 mRenderLatency(1000.0f/DEFAULT_FPS),
 mLogicLatency(1000.0f/DEFAULT_LPS_VORTICON),
+mFPS(DEFAULT_FPS),
+mLPS(DEFAULT_LPS_VORTICON),
 m_LastSecTime(0),
 resetLogic(false)
 {
@@ -27,11 +29,13 @@ resetLogic(false)
 
 void CTimer::setFPS( const float fps )
 {
+    mFPS = fps;
     mRenderLatency = (fps <= 0.0) ? 0.0 : (1000.0f / static_cast<float>(fps));
 }
 
 void CTimer::setLPS( const float lps )
 {
+    mLPS = lps;
     mLogicLatency = 1000.0f / static_cast<float>(lps);
 }
 
@@ -58,6 +58,11 @@ public:
 
     float FPS() { return 1000.0f/mRenderLatency; }
     
+    float LPS() { return mLPS; }
+
+    // Frame limit as set, zero or less for none
+    float targetFPS() { return mFPS; }
+
     float LogicLatency() { return mLogicLatency; }
 
     float RenderLatency() { return mRenderLatency; }
@@ -93,6 +98,9 @@ private:
     
     float mRenderLatency;
     float mLogicLatency;
+
+    float mFPS;
+    float mLPS;
     
     float mtotalElapsed;
   
@@ -8,6 +8,8 @@
  */
 
 #include <SDL_thread.h>
+#include <SDL_cpuinfo.h>
+#include <vector>
 #include "ThreadPool.h"
 #include "Debug.h"
 #include <base/GsLogging.h>
@@ -238,6 +240,13 @@ bool ThreadPool::waitAll() {
 	return true;
 }
 
+size_t ThreadPool::idleThreads() {
+	SDL_mutexP(mutex);
+	const size_t idle = availableThreads.size();
+	SDL_mutexV(mutex);
+	return idle;
+}
+
 /*void ThreadPool::dumpState(CmdLineIntf& cli) const {
 	ScopedLock lock(mutex);
 	for(std::set<ThreadPoolItem*>::const_iterator i = usedThreads.begin(); i != usedThreads.end(); ++i) {
@@ -276,3 +285,94 @@ void UnInitThreadPool() {
 }
 
 
+
+
+static unsigned int parallelWorkers = 0;
+
+unsigned int getParallelWorkers()
+{
+	if(parallelWorkers == 0)
+	{
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+		const int cpus = SDL_GetCPUCount();
+		parallelWorkers = (cpus > 0) ? (unsigned int)(cpus) : 1;
+#else
+		parallelWorkers = 1;
+#endif
+	}
+
+	return parallelWorkers;
+}
+
+void setParallelWorkers(const unsigned int workers)
+{
+	parallelWorkers = (workers > 0) ? workers : 1;
+}
+
+void parallelFor(const size_t count,
+                 const std::function<void(size_t)> &func,
+                 const std::string &name)
+{
+	struct RangeAction : Action
+	{
+		const std::function<void(size_t)> &func;
+		size_t begin, end;
+
+		RangeAction(const std::function<void(size_t)> &_func, const size_t _begin, const size_t _end) :
+		func(_func), begin(_begin), end(_end) {}
+
+		int handle()
+		{
+			for(size_t i=begin ; i<end ; i++)
+				func(i);
+			return 0;
+		}
+	};
+
+	size_t workers = getParallelWorkers();
+	if(workers > count)
+		workers = count;
+
+	// Some pool threads are held for good (music producer, log writer).
+	// Only take the idle ones plus the calling thread, so the pool doesn't grow.
+	if(threadPool)
+	{
+		const size_t idle = threadPool->idleThreads();
+		if(workers > idle+1)
+			workers = idle+1;
+	}
+
+	if(!threadPool || workers <= 1)
+	{
+		RangeAction(func, 0, count).handle();
+		return;
+	}
+
+	std::vector<ThreadPoolItem*> items;
+	items.reserve(workers-1);
+
+	for(size_t w=1 ; w<workers ; w++)
+	{
+		const size_t begin = (count*w)/workers;
+		const size_t end = (count*(w+1))/workers;
+
+		RangeAction *action = new RangeAction(func, begin, end);
+		ThreadPoolItem *item = threadPool->start(action, name);
+
+		// No thread for this share, it is done right here then
+		if(item)
+		{
+			items.push_back(item);
+		}
+		else
+		{
+			action->handle();
+			delete action;
+		}
+	}
+
+	RangeAction(func, 0, count/workers).handle();
+
+	for(auto *item : items)
+		threadPool->wait(item);
+}
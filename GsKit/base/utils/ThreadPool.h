@@ -12,6 +12,7 @@
 
 #include <set>
 #include <string>
+#include <functional>
 
 struct SDL_mutex;
 struct SDL_cond;
@@ -61,6 +62,8 @@ public:
 	bool finalizeIfReady(ThreadPoolItem* thread, int* status = NULL);
 	bool wait(ThreadPoolItem* thread, int* status = NULL);
 	bool waitAll();
+	// Threads waiting for work right now. Starting more than that makes the pool grow.
+	size_t idleThreads();
 	void dumpState(CmdLineIntf& cli) const;
 };
 
@@ -69,6 +72,19 @@ extern ThreadPool* threadPool;
 void InitThreadPool(unsigned int size = 5);
 void UnInitThreadPool();
 
+// Number of workers parallelFor() splits its range into. Defaults to the number of CPUs.
+// Setting 1 makes parallelFor() run everything on the calling thread.
+unsigned int getParallelWorkers();
+void setParallelWorkers(const unsigned int workers);
+
+// Calls func(i) for every i in [0, count). The range is split in contiguous shares,
+// one per worker, where the calling thread handles the first share itself.
+// No more workers than idle threads of the pool are used.
+// Returns when all shares are done. func must only touch data belonging to index i.
+void parallelFor(const size_t count,
+                 const std::function<void(size_t)> &func,
+                 const std::string &name = "parallel worker");
+
 
 
 template<typename _T>
@@ -8,6 +8,7 @@
 #include <base/GsTimer.h>
 #include "CVideoEngine.h"
 #include <base/GsLogging.h>
+#include <base/GsProfiler.h>
 #include <SDL_syswm.h>
 #include <base/video/scaler/scalebit.h>
 #include <SDL_version.h>
@@ -356,6 +357,8 @@ void CVideoEngine::drawHorizBorders()
 
 void CVideoEngine::scaleAndFilter()
 {
+    GS_PROFILE_ZONE("scaleAndFilter");
+
     const auto scaleXFilter = m_VidConfig.m_ScaleXFilter;
 
     // If ScaleX is enabled scaleup to screensurface
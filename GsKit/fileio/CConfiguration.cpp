@@ -8,33 +8,173 @@
 #include "CConfiguration.h"
 
 #include <base/utils/FindFile.h>
-#include <fstream>
+#include <base/utils/ThreadPool.h>
+#include <SDL_mutex.h>
+#include <cstdio>
+#include <map>
+
+namespace
+{
+
+/**
+ * Holds the serialized configurations which still have to go to disk.
+ * Only one writer thread runs at a time and it always writes the latest version of a file.
+ */
+struct PendingCfgWrites
+{
+	struct Entry
+	{
+		std::string fullPath;
+		std::string contents;
+		unsigned int generation = 0;
+	};
+
+	SDL_mutex *mutex = SDL_CreateMutex();
+	std::map<std::string, Entry> entries;
+	bool writerRunning = false;
+};
+
+PendingCfgWrites &pendingCfgWrites()
+{
+	static PendingCfgWrites pending;
+	return pending;
+}
+
+bool writeCfgAtomically(const std::string &fullPath, const std::string &contents)
+{
+	const std::string tmpPath = fullPath + ".tmp";
+
+	FILE *fp = fopen(Utf8ToSystemNative(tmpPath).c_str(), "wb");
+	if(!fp)
+		return false;
+
+	const bool written = (fwrite(contents.data(), 1, contents.size(), fp) == contents.size());
+	const bool closed = (fclose(fp) == 0);
+
+	if(!written || !closed)
+	{
+		remove(Utf8ToSystemNative(tmpPath).c_str());
+		return false;
+	}
+
+#ifdef WIN32
+	// rename does not replace existing files there
+	remove(Utf8ToSystemNative(fullPath).c_str());
+#endif
+
+	return rename(Utf8ToSystemNative(tmpPath).c_str(),
+				  Utf8ToSystemNative(fullPath).c_str()) == 0;
+}
+
+struct CfgWriter : Action
+{
+	int handle()
+	{
+		PendingCfgWrites &pending = pendingCfgWrites();
+
+		while(true)
+		{
+			PendingCfgWrites::Entry entry;
+			std::string key;
+
+			SDL_mutexP(pending.mutex);
+			if(pending.entries.empty())
+			{
+				pending.writerRunning = false;
+				SDL_mutexV(pending.mutex);
+				return 0;
+			}
+			key = pending.entries.begin()->first;
+			entry = pending.entries.begin()->second;
+			SDL_mutexV(pending.mutex);
+
+			if(!writeCfgAtomically(entry.fullPath, entry.contents))
+			{
+				errors << "Could not write the configuration to " << entry.fullPath << endl;
+			}
+
+			// Only drop it, if nobody saved a newer version meanwhile
+			SDL_mutexP(pending.mutex);
+			auto it = pending.entries.find(key);
+			if(it != pending.entries.end() && it->second.generation == entry.generation)
+			{
+				pending.entries.erase(it);
+			}
+			SDL_mutexV(pending.mutex);
+		}
+	}
+};
+
+}
 
 CConfiguration::CConfiguration(const std::string& filename) :
 IniReader(filename)
 {}
 
+bool CConfiguration::LoadContents(std::string& buffer)
+{
+	PendingCfgWrites &pending = pendingCfgWrites();
+
+	SDL_mutexP(pending.mutex);
+	auto it = pending.entries.find(m_filename);
+	if(it != pending.entries.end())
+	{
+		buffer = it->second.contents;
+		SDL_mutexV(pending.mutex);
+		return true;
+	}
+	SDL_mutexV(pending.mutex);
+
+	return IniReader::LoadContents(buffer);
+}
+
 bool CConfiguration::saveCfgFile()
 {
-	std::ofstream file;
-	if(!OpenGameFileW(file, m_filename))
+	const std::string fullPath = GetWriteFullFileName(m_filename, true);
+	if(fullPath.empty())
 		return false;
 
+	std::string contents;
+
 	SectionMap::iterator sect = m_sections.begin();
 	for(; sect != m_sections.end() ; sect++)
 	{
-		file << "[" + sect->first + "]";
-		file << std::endl;
+		contents += "[" + sect->first + "]\n";
 
 		Section &current = sect->second;
 		Section::iterator keyword = current.begin();
 		for(; keyword != current.end() ; keyword++)
 		{
-			file << (keyword->first + " = " + keyword->second + "\n");
+			contents += keyword->first + " = " + keyword->second + "\n";
 		}
-		file << std::endl;
+		contents += "\n";
 	}
-	file.close();
+
+	PendingCfgWrites &pending = pendingCfgWrites();
+
+	SDL_mutexP(pending.mutex);
+
+	PendingCfgWrites::Entry &entry = pending.entries[m_filename];
+	entry.fullPath = fullPath;
+	entry.contents.swap(contents);
+	entry.generation++;
+
+	bool startWriter = !pending.writerRunning;
+	if(startWriter && threadPool)
+	{
+		pending.writerRunning = true;
+		threadPool->start(new CfgWriter, "Configuration writer", true);
+		startWriter = false;
+	}
+
+	SDL_mutexV(pending.mutex);
+
+	// No thread pool around (early startup or shutdown), write it right away
+	if(startWriter)
+	{
+		CfgWriter().handle();
+	}
+
 	return true;
 }
 
@@ -18,6 +18,8 @@ class CConfiguration : public IniReader
 public:
 	CConfiguration(const std::string& filename);
 
+	// Serializes the settings on the calling thread and hands the actual
+	// write (temp file plus rename) over to a background thread.
 	bool saveCfgFile();
 
 	bool OnNewSection (const std::string& section);
@@ -26,6 +28,11 @@ public:
 	void WriteString(const std::string& section, const std::string& key, const std::string& string);
 	void SetKeyword(const std::string& section, const std::string& keyword, const bool value);
 	void WriteInt(const std::string &section, const std::string &keyword, const int value);
+
+protected:
+	// Takes pending writes of the same file into account, so a parse right after
+	// saveCfgFile() never sees the old contents
+	bool LoadContents(std::string& buffer);
 };
 
 #endif /* CCONFIGURATION_H_ */
@@ -13,6 +13,9 @@
 #include "IniReader.h"
 #include <base/utils/FindFile.h>
 #include <base/utils/Debug.h>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 
 
 IniReader::KeywordList IniReader::DefaultKeywords;
@@ -27,13 +30,42 @@ IniReader::IniReader(const std::string& filename, KeywordList& keywords) : m_fil
 
 IniReader::~IniReader() {}
 
-bool IniReader::Parse()
+bool IniReader::LoadContents(std::string& buffer)
 {
-	FILE* f = OpenGameFile(m_filename, "r");
+	FILE* f = OpenGameFile(m_filename, "rb");
 	if(f == NULL)
 		return false;
 
-	bool res = true;
+	// Slurp the whole file, so the parser never has to go back to the stdio layer
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if(size > 0)
+	{
+		buffer.resize(size_t(size));
+		buffer.resize(fread(&buffer[0], 1, buffer.size(), f));
+	}
+	else
+	{
+		buffer.clear();
+	}
+
+	fclose(f);
+	return true;
+}
+
+bool IniReader::Parse()
+{
+	std::string buffer;
+	if(!LoadContents(buffer))
+		return false;
+
+	return ParseBuffer(buffer);
+}
+
+bool IniReader::ParseBuffer(const std::string& buffer)
+{
 	enum ParseState {
 		S_DEFAULT, S_IGNORERESTLINE, S_PROPNAME, S_PROPVALUE, S_SECTION };
 	ParseState state = S_DEFAULT;
@@ -41,9 +73,25 @@ bool IniReader::Parse()
 	std::string section;
 	std::string value;
 
-	while(!feof(f) && !ferror(f)) {
-		unsigned char c = 0;
-		if(fread(&c, 1, 1, f) == 0) break;
+	const char *cur = buffer.data();
+	const char *end = cur + buffer.size();
+
+	// Length of the run starting at p which holds no character the current state has to look at.
+	// Those runs are appended in one go instead of char by char.
+	auto plainRun = [end](const char *p, const char *stops) -> size_t
+	{
+		const char *q = p;
+		while(q < end)
+		{
+			const unsigned char c = (unsigned char)(*q);
+			if(c == '\r' || isspace(c) || strchr(stops, c)) break;
+			q++;
+		}
+		return size_t(q - p);
+	};
+
+	while(cur < end) {
+		const unsigned char c = (unsigned char)(*cur++);
 
 		if(c == '\r') continue; // ignore this
 
@@ -52,15 +100,20 @@ bool IniReader::Parse()
 			if(c >= 128) break; // just ignore unicode-stuff when we are in this state (UTF8 bytes at beginning are also handled by this)
 			else if(isspace(c)) break; // ignore spaces and newlines
 			else if(c == '#') { state = S_IGNORERESTLINE; /* this is a comment */ break; }
-			else if(c == '[') { state = S_SECTION; section = ""; break; }
+			else if(c == '[') { state = S_SECTION; section.clear(); break; }
 			else if(c == '=') {
 				warnings << "WARNING: \"=\" is not allowed as the first character in a line of " << m_filename << endl;
 				break; /* ignore */ }
-			else { state = S_PROPNAME; propname = c; break; }
+			else {
+				state = S_PROPNAME;
+				const size_t len = plainRun(cur, "=");
+				propname.assign(cur-1, len+1);
+				cur += len;
+				break; }
 
 		case S_SECTION:
 			if(c == ']') {
-				if( ! OnNewSection(section) )  { res = false; goto parseCleanup; }
+				if( ! OnNewSection(section) )  return false;
 				state = S_DEFAULT; NewSection(section); break; }
 			else if(c == '\n') {
 				warnings << "WARNING: section-name \"" << section << "\" of " << m_filename << " is not closed correctly" << endl;
@@ -68,51 +121,56 @@ bool IniReader::Parse()
 			else if(isspace(c)) {
 				warnings << "WARNING: section-name \"" << section << "\" of " << m_filename << " contains a space" << endl;
 				break; /* ignore */ }
-			else { section += c; break; }
+			else {
+				const size_t len = plainRun(cur, "]");
+				section.append(cur-1, len+1);
+				cur += len;
+				break; }
 
 		case S_PROPNAME:
 			if(c == '\n') {
 				warnings << "WARNING: property \"" << propname << "\" of " << m_filename << " incomplete" << endl;
 				state = S_DEFAULT; break; }
 			else if(isspace(c)) break; // just ignore spaces
-			else if(c == '=') { state = S_PROPVALUE; value = ""; break; }
-			else { propname += c; break; }
+			else if(c == '=') { state = S_PROPVALUE; value.clear(); break; }
+			else {
+				const size_t len = plainRun(cur, "=");
+				propname.append(cur-1, len+1);
+				cur += len;
+				break; }
 
 		case S_PROPVALUE:
 			if(c == '\n' || c == '#') {
-				if( ! OnEntry(section, propname, value) ) { res = false; goto parseCleanup; }
+				if( ! OnEntry(section, propname, value) ) return false;
 				NewEntryInSection(propname, value);
 				if(c == '#') state = S_IGNORERESTLINE; else state = S_DEFAULT;
 				break; }
-			else if(isspace(c) && value == "") break; // ignore heading spaces
-			else { value += c; break; }
+			else if(isspace(c) && value.empty()) break; // ignore heading spaces
+			else {
+				// Everything up to the end of line or a comment belongs to the value, spaces included
+				const char *q = cur;
+				while(q < end && *q != '\n' && *q != '#' && *q != '\r') q++;
+				value.append((const char*)(cur-1), size_t(q - cur) + 1);
+				cur = q;
+				break; }
 
 		case S_IGNORERESTLINE:
-			if(c == '\n') state = S_DEFAULT;
+		{
+			const void *nl = memchr(cur-1, '\n', size_t(end - cur) + 1);
+			cur = nl ? (const char*)(nl) + 1 : end;
+			state = S_DEFAULT;
 			break; // ignore everything
 		}
+		}
 	}
 
 	// In case the endline is missing at the end of file, finish the parsing of the last line
 	if (state == S_PROPVALUE)  {
-		if( ! OnEntry(section, propname, value) ) { res = false; goto parseCleanup; }
+		if( ! OnEntry(section, propname, value) ) return false;
 		NewEntryInSection(propname, value);
 	}
 
-	// DEBUG: dump the file
-	/*notes << "Dump of " << m_filename << endl;
-	for (SectionMap::iterator it = m_sections.begin(); it != m_sections.end(); ++it)  {
-		notes << "[" << it->first << "]" << endl;
-		for (Section::iterator k = it->second.begin(); k != it->second.end(); ++k)
-			notes << k->first << "=" << k->second << endl;
-		notes << endl;
-	}
-	notes << endl;*/
-
-parseCleanup:
-	fclose(f);
-
-	return res;
+	return true;
 }
 
 void IniReader::NewSection(const std::string& name)
@@ -130,19 +188,28 @@ void IniReader::NewEntryInSection(const std::string& name, const std::string& va
 	(*m_curSection)[name] = value;
 }
 
-bool IniReader::GetString(const std::string& section, const std::string& key, std::string& string) const
+const std::string* IniReader::FindValue(const std::string& section, const std::string& key) const
 {
 	// Get the section
 	SectionMap::const_iterator sect = m_sections.find(section);
 	if (sect == m_sections.end())
-		return false;
+		return nullptr;
 
 	// Get the key=value pair
 	Section::const_iterator item = sect->second.find(key);
 	if (item == sect->second.end())
+		return nullptr;
+
+	return &item->second;
+}
+
+bool IniReader::GetString(const std::string& section, const std::string& key, std::string& string) const
+{
+	const std::string *found = FindValue(section, key);
+	if (!found)
 		return false;
 
-	string = item->second;
+	string = *found;
 	return true;
 }
 
@@ -156,28 +223,31 @@ bool IniReader::ReadString(const std::string& section, const std::string& key, s
 
 bool IniReader::ReadInteger(const std::string& section, const std::string& key, int *value, int defaultv) const
 {
-	std::string string;
-
 	*value = defaultv;
 
-	if(!GetString(section, key, string))
+	const std::string *string = FindValue(section, key);
+	if(!string)
 		return false;
 
-	*value = from_string<int>(string);
+	// strtol instead of a stringstream, so no allocation happens per read.
+	// Like the stream it yields 0 for garbage and clamps values out of range.
+	const long v = strtol(string->c_str(), nullptr, 10);
+	if(v > INT_MAX)       *value = INT_MAX;
+	else if(v < INT_MIN)  *value = INT_MIN;
+	else                  *value = int(v);
 
 	return true;
 }
 
 bool IniReader::ReadFloat(const std::string &section, const std::string &key, float *value, float defaultv) const
 {
-	std::string string;
-
 	*value = defaultv;
 
-	if(!GetString(section, key, string))
+	const std::string *string = FindValue(section, key);
+	if(!string)
 		return false;
 
-	*value = (float)atof(string);
+	*value = strtof(string->c_str(), nullptr);
 
 	return true;
 }
@@ -214,22 +284,21 @@ bool IniReader::ReadIntArray(const std::string &section, const std::string &key,
 
 bool IniReader::ReadKeyword(const std::string &section, const std::string &key, int *value, int defaultv) const
 {
-	std::string string;
-
 	*value = defaultv;
 
-	if(!GetString(section, key, string))
+	const std::string *string = FindValue(section, key);
+	if(!string)
 		return false;
 
 	// Try and find a keyword with matching keys
-	KeywordList::const_iterator f = m_keywords.find(string);
+	KeywordList::const_iterator f = m_keywords.find(*string);
 	if(f != m_keywords.end()) {
 		//notes << filename << ":" << section << "." << key << ": " << f->first << "(" << string << ") = " << f->second << endl;
 		*value = f->second;
 		return true;
 	}
 
-	warnings << m_filename << ":" << section << "." << key << ": '" << string << "' is an unknown keyword" << endl;
+	warnings << m_filename << ":" << section << "." << key << ": '" << *string << "' is an unknown keyword" << endl;
 
 	return false;
 }
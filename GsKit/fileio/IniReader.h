@@ -31,6 +31,9 @@ public:
 	// if you break via the callbacks, this is also an error
 	bool Parse();
 
+	// Same as Parse() but works on a buffer which already holds the file contents
+	bool ParseBuffer(const std::string& buffer);
+
 	// if the return value is false, the parsing will break
 	virtual bool OnNewSection (const std::string& section) { return true; }
 	virtual bool OnEntry (const std::string& section, const std::string& propname, const std::string& value) { return true; }
@@ -95,6 +98,9 @@ public:
 
 	static KeywordList DefaultKeywords;
 protected:
+	// Reads the whole file into buffer with one bulk read. Returns false if it cannot be opened.
+	virtual bool LoadContents(std::string& buffer);
+
 	std::string m_filename;
 	KeywordList& m_keywords;
 
@@ -104,9 +110,11 @@ public:
 	SectionMap m_sections;
 
 private:
-	Section *m_curSection;
+	Section *m_curSection = nullptr;
 
 private:
+	// Returns a pointer to the stored value, so the typed readers do not need to copy it
+	const std::string* FindValue(const std::string& section, const std::string& key) const;
 	bool GetString(const std::string& section, const std::string& key, std::string& string) const;
 	void NewSection(const std::string& name);
 	void NewEntryInSection(const std::string& name, const std::string& value);
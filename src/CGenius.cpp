@@ -31,6 +31,7 @@
 
 #include "../version.h"
 #include "engine/core/CSettings.h"
+#include "engine/core/CBehaviorEngine.h"
 #include "base/video/CVideoDriver.h"
 
 
@@ -41,10 +42,13 @@
 #include <base/utils/FindFile.h>
 #include <base/GsApp.h>
 #include <base/GsLogging.h>
+#include <base/GsInputRecorder.h>
+#include <base/GsBenchmark.h>
 
 #include "engine/CGameLauncher.h"
 
 #include "sdl/audio/Audio.h"
+#include "sdl/audio/music/CIMFPlayer.h"
 
 
 
@@ -94,6 +98,9 @@ int main(int argc, char *argv[])
 
 	SetBinaryDir( GetAbsolutePath(binary_dir) );
 
+    // Must know before SDL starts, the benchmark runs on dummy drivers
+    gBenchmark.init(argc, argv);
+
 	InitThreadPool();
     InitSearchPaths(gSettings.getConfigFileName());
 
@@ -134,6 +141,21 @@ int main(int argc, char *argv[])
     ////////////////////////////////////////////////////
     if( gApp.init( argc, argv ) )
 	{
+        // A replay has to run with the game options it was recorded with
+        for(auto &option : gBehaviorEngine.mOptions)
+        {
+            const std::string key = "option." + option.second.name;
+
+            if(gInputRecorder.recording())
+            {
+                gInputRecorder.setHeaderValue(key, itoa(option.second.value));
+            }
+            else if(gInputRecorder.replaying() && !gInputRecorder.getHeaderValue(key).empty())
+            {
+                option.second.value = atoi(gInputRecorder.getHeaderValue(key));
+            }
+        }
+
         ////////////////////////////////
         // Set GameLauncher as Engine //
         ////////////////////////////////
@@ -147,6 +169,12 @@ int main(int argc, char *argv[])
 
     gSettings.saveDispCfg();
 
+    // The IMF producer runs until stopped, so it has to end before the pool waits for its threads
+    suspendIMFProducer();
+
+    // Same for the log writer. Whatever gets logged after this is written right away.
+    gLogging.stopWriter();
+
 	UnInitThreadPool();
 	return 0;
 }
@@ -11,6 +11,7 @@
 #include <base/GsLogging.h>
 #include <base/video/CVideoDriver.h>
 #include <base/GsTimer.h>
+#include <base/GsProfiler.h>
 #include "graphics/GsGraphics.h"
 #include <iostream>
 #include <fstream>
@@ -902,6 +903,8 @@ void CMap::drawAnimatedTile(SDL_Surface *dst, Uint16 mx, Uint16 my, Uint16 tile)
 
 void CMap::animateAllTiles()
 {
+    GS_PROFILE_ZONE("animateAllTiles");
+
     if(!m_animation_enabled)
         return;
 
@@ -138,6 +138,14 @@ public:
 		return mPlanes[plane].getMapDataAt(x>>CSF, y>>CSF);
 	}
 
+    /**
+     * @brief getPlaneTimers    Animation timers of the tiles in that plane
+     */
+    std::vector<int> &getPlaneTimers(const int plane)
+    {
+        return mPlanes[plane].getTimers();
+    }
+
     Uint16 getPlaneDataAt(int plane, Vector2D<Uint32> pos) const
 	{
 		return mPlanes[plane].getMapDataAt(pos.x>>CSF, pos.y>>CSF);
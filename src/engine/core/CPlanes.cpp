@@ -56,6 +56,25 @@ void CPlanes::setOffsets(unsigned long p1, unsigned long p2, unsigned long p3,
 	for(int i=0;i<5;i++)
 	    getbit_bitmask[i] = 128;
 }
+/**
+ * \brief	Advances the read position of one plane as if getbit() had been called numbits times.
+ * 			With this a copy of CPlanes can start reading in the middle of the planes.
+ * \param	p		plane of which the position is moved
+ * \param	numbits	Number of bits to skip
+ */
+void CPlanes::skipBits(uint32_t p, unsigned long numbits)
+{
+	// Bit index of the next bit getbit() would read. A mask of zero means the byte is used up.
+	unsigned long bitpos = getbit_bytepos[p]*8;
+	for(unsigned char mask = 128 ; mask != getbit_bitmask[p] ; mask >>= 1)
+		bitpos++;
+
+	bitpos += numbits;
+
+	getbit_bytepos[p] = bitpos/8;
+	getbit_bitmask[p] = (unsigned char)(128 >> (bitpos%8));
+}
+
 /**
  * This functions read one plane of graphics to a designated pointer which is derived by
  * a SDL-Surface normally
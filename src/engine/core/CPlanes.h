@@ -17,6 +17,7 @@ public:
 	unsigned char getbit(unsigned char plane);
 	void setOffsets(unsigned long p1, unsigned long p2, unsigned long p3,
 					 unsigned long p4, unsigned long p5 = 0);
+	void skipBits(uint32_t p, unsigned long numbits);
     void readPlane(uint32_t p, uint8_t *pixels, uint16_t width, uint16_t height);
     void readPlaneofTiles(uint32_t p, uint8_t *pixels, uint16_t columns,
                                 uint16_t tilesize, uint16_t numtiles);
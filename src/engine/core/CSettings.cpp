@@ -101,6 +101,7 @@ bool CSettings::saveDrvCfg()
         Configuration.SetKeyword("Audio", "sndblaster", gSound.getSoundBlasterMode());
         Configuration.WriteInt("Audio", "musicvol", (gSound.getMusicVolume()));
         Configuration.WriteInt("Audio", "soundvol", (gSound.getSoundVolume()));
+        Configuration.WriteInt("Audio", "imflatency", int(gSound.getIMFLatency()));
 
     }
     catch(...)
@@ -219,6 +220,10 @@ bool CSettings::loadDrvCfg()
 
         gSound.setMusicVolume(Uint8(music_vol), false);
         gSound.setSoundVolume(Uint8(sound_vol), false);
+
+        int imf_latency;
+        Configuration.ReadInteger("Audio", "imflatency", &imf_latency, 50);
+        gSound.setIMFLatency(imf_latency > 0 ? unsigned(imf_latency) : 0);
 	}
 	return true;
 }
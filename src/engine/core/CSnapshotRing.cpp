@@ -0,0 +1,162 @@
+/*
+ * CSnapshotRing.cpp
+ */
+
+#include "CSnapshotRing.h"
+
+#include <zlib.h>
+#include <algorithm>
+
+
+void CSnapshotRing::reset(const size_t maxFrames, const size_t keyframeInterval)
+{
+    mMaxFrames = maxFrames;
+    mKeyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+    mSinceKeyframe = 0;
+    mFrames.clear();
+    mNewest.clear();
+    mDelta.clear();
+}
+
+
+void CSnapshotRing::push(const std::vector<byte> &snapshot)
+{
+    if(mMaxFrames == 0)
+        return;
+
+    Frame frame;
+    frame.rawSize = Uint32(snapshot.size());
+    frame.keyframe = mFrames.empty() ||
+                     mSinceKeyframe+1 >= mKeyframeInterval;
+
+    const byte *source = snapshot.data();
+
+    if(!frame.keyframe)
+    {
+        // Past the end of the previous snapshot the bytes go in as they are
+        const size_t common = std::min(snapshot.size(), mNewest.size());
+
+        mDelta.resize(snapshot.size());
+        for(size_t i=0 ; i<common ; i++)
+        {
+            mDelta[i] = snapshot[i] ^ mNewest[i];
+        }
+        std::copy(snapshot.begin()+common, snapshot.end(), mDelta.begin()+common);
+
+        source = mDelta.data();
+    }
+
+    // Speed matters more than size here, this runs every logic tick
+    uLongf deflatedSize = compressBound(snapshot.size());
+    frame.data.resize(deflatedSize);
+
+    if(compress2(frame.data.data(), &deflatedSize, source, snapshot.size(), Z_BEST_SPEED) != Z_OK)
+        return;
+
+    frame.data.resize(deflatedSize);
+    frame.data.shrink_to_fit();
+
+    mSinceKeyframe = frame.keyframe ? 0 : mSinceKeyframe+1;
+    mFrames.push_back(std::move(frame));
+    mNewest = snapshot;
+
+    if(mFrames.size() > mMaxFrames)
+    {
+        mFrames.pop_front();
+
+        // Deltas without their keyframe are useless
+        while(!mFrames.empty() && !mFrames.front().keyframe)
+        {
+            mFrames.pop_front();
+        }
+    }
+}
+
+
+bool CSnapshotRing::get(const size_t age, std::vector<byte> &snapshot) const
+{
+    if(age >= mFrames.size())
+        return false;
+
+    const size_t target = mFrames.size()-1-age;
+
+    if(age == 0)
+    {
+        snapshot = mNewest;
+        return true;
+    }
+
+    size_t keyframe = target;
+    while(!mFrames[keyframe].keyframe)
+    {
+        keyframe--;
+    }
+
+    if(!inflateFrame(mFrames[keyframe], snapshot))
+        return false;
+
+    std::vector<byte> delta;
+    for(size_t idx=keyframe+1 ; idx<=target ; idx++)
+    {
+        if(!inflateFrame(mFrames[idx], delta))
+            return false;
+
+        // What the previous snapshot didn't have was taken as it is
+        snapshot.resize(delta.size(), 0);
+
+        for(size_t i=0 ; i<delta.size() ; i++)
+        {
+            snapshot[i] ^= delta[i];
+        }
+    }
+
+    return true;
+}
+
+
+void CSnapshotRing::dropNewest(const size_t count)
+{
+    if(count == 0)
+        return;
+
+    if(count >= mFrames.size())
+    {
+        reset(mMaxFrames, mKeyframeInterval);
+        return;
+    }
+
+    std::vector<byte> newest;
+    get(count, newest);
+    mNewest.swap(newest);
+
+    mFrames.erase(mFrames.end()-count, mFrames.end());
+
+    mSinceKeyframe = 0;
+    for(size_t idx=mFrames.size()-1 ; !mFrames[idx].keyframe ; idx--)
+    {
+        mSinceKeyframe++;
+    }
+}
+
+
+size_t CSnapshotRing::memoryUsage() const
+{
+    size_t bytes = mNewest.capacity() + mDelta.capacity();
+
+    for(const auto &frame : mFrames)
+    {
+        bytes += frame.data.capacity() + sizeof(Frame);
+    }
+
+    return bytes;
+}
+
+
+bool CSnapshotRing::inflateFrame(const Frame &frame, std::vector<byte> &raw)
+{
+    raw.resize(frame.rawSize);
+    uLongf rawSize = frame.rawSize;
+
+    return uncompress(raw.data(), &rawSize, frame.data.data(), frame.data.size()) == Z_OK &&
+           rawSize == frame.rawSize;
+}
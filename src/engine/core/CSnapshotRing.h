@@ -0,0 +1,89 @@
+/*
+ * CSnapshotRing.h
+ *
+ *  Keeps the last snapshots of a running game, so it can be rewound.
+ *
+ *  Every snapshot is an opaque block of bytes. Most of them are stored as the
+ *  difference (XOR) to the one before, which is mostly zeros and so deflates
+ *  to almost nothing. Every keyframeInterval snapshots a full one is stored instead.
+ *  Once the ring is full, the oldest keyframe is dropped together with the deltas
+ *  depending on it.
+ *
+ *  Deltas are taken byte by byte from the start, so the snapshots should keep
+ *  whatever has a fixed size at the front. If the size changes, the delta covers
+ *  the common part and takes the rest as it is.
+ */
+
+#ifndef CSNAPSHOTRING_H_
+#define CSNAPSHOTRING_H_
+
+#include <base/TypeDefinitions.h>
+#include <SDL.h>
+#include <deque>
+#include <vector>
+
+class CSnapshotRing
+{
+public:
+
+    /**
+     * @brief reset             Forgets all snapshots and sets how many of them are kept
+     * @param maxFrames         Number of snapshots kept at most. 0 disables the ring.
+     * @param keyframeInterval  A full snapshot is stored every that many
+     */
+    void reset(const size_t maxFrames, const size_t keyframeInterval);
+
+    size_t capacity() const
+    {   return mMaxFrames;  }
+
+    size_t size() const
+    {   return mFrames.size();  }
+
+    /**
+     * @brief push  Adds a snapshot as the newest one
+     */
+    void push(const std::vector<byte> &snapshot);
+
+    /**
+     * @brief get       Rebuilds a snapshot
+     * @param age       0 is the newest snapshot, 1 the one before and so on
+     * @param snapshot  receives the data
+     * @return          false if there is no snapshot that old
+     */
+    bool get(const size_t age, std::vector<byte> &snapshot) const;
+
+    /**
+     * @brief dropNewest    Throws away the newest snapshots, e.g. after rewinding past them
+     */
+    void dropNewest(const size_t count);
+
+    /**
+     * @brief memoryUsage   Bytes taken by the stored snapshots
+     */
+    size_t memoryUsage() const;
+
+private:
+
+    struct Frame
+    {
+        bool keyframe;
+        Uint32 rawSize;
+        std::vector<byte> data;   // deflated snapshot or delta
+    };
+
+    static bool inflateFrame(const Frame &frame, std::vector<byte> &raw);
+
+    size_t mMaxFrames = 0;
+    size_t mKeyframeInterval = 1;
+    size_t mSinceKeyframe = 0;
+
+    std::deque<Frame> mFrames;
+
+    // Newest snapshot as it is, the next delta is made against it
+    std::vector<byte> mNewest;
+
+    // Kept, so making the delta doesn't allocate on every push
+    std::vector<byte> mDelta;
+};
+
+#endif /* CSNAPSHOTRING_H_ */
@@ -14,6 +14,7 @@ struct stCheat
     bool god = false;
     bool noclipping = false;
     bool items = false;
+    bool rewind = false;
 };
 
 #endif // __CHEAT_STRUCT__
@@ -14,6 +14,7 @@
 #include "sdl/audio/music/CMusic.h"
 #include "graphics/effects/CDimDark.h"
 #include <base/GsLogging.h>
+#include <base/GsInputRecorder.h>
 #include <base/video/CVideoDriver.h>
 
 #include "engine/core/VGamepads/vgamepadsimple.h"
@@ -84,6 +85,8 @@ void CLevelPlay::reloadLevel()
 bool CLevelPlay::loadLevel(const Uint16 level)
 {
 	loadMap( level );
+
+    gInputRecorder.mark("level", itoa(level));
 		
 	// Add the load message
 	const std::string level_text = "LEVEL" + itoa(level) + "_LOAD_TEXT";
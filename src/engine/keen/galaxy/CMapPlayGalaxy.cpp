@@ -17,10 +17,14 @@
 #include "ep4/ai/CSmokePuff.h"
 #include "engine/core/VGamepads/vgamepadsimple.h"
 #include <base/GsLogging.h>
+#include <base/GsInputRecorder.h>
+#include <base/GsProfiler.h>
 #include <base/video/CVideoDriver.h>
 
 #include <boost/property_tree/ptree.hpp>
-#include <base/utils/Base64.h>
+#include "fileio/BinaryTree.h"
+
+#include <sstream>
 
 #include "GalaxyEngine.h"
 
@@ -110,6 +114,8 @@ void CMapPlayGalaxy::pumpEvent(const CEvent *evPtr)
 
 void CMapPlayGalaxy::ponderBase(const float deltaT)
 {
+    GS_PROFILE_ZONE("ponderBase");
+
     const bool msgboxactive = mMsgBoxOpen;
 
     bool pause = msgboxactive;
@@ -181,6 +187,13 @@ void CMapPlayGalaxy::ponderBase(const float deltaT)
 
             objRef.processEvents();
         }
+
+        // One snapshot per logic tick, if rewinding is enabled at all
+        if( mRewindRing.capacity() > 0 )
+        {
+            takeSnapshot(mSnapshotBuffer);
+            mRewindRing.push(mSnapshotBuffer);
+        }
 	}
 
 
@@ -423,10 +436,28 @@ bool CMapPlayGalaxy::operator<<(CSaveGameController &savedGame)
 }
 
 
-// Saves the level using the Savegamecontroller in XML.
+// Saves the level using the Savegamecontroller.
 void CMapPlayGalaxy::operator>>(boost::property_tree::ptree &levelNode)
 {
-    // Coding here
+    storeObjects(levelNode);
+
+    // Save the map_data as it is left
+    {
+        auto &mapNode = levelNode.put("Map", "");
+        mapNode.put("width", mMap.m_width);
+        mapNode.put("height", mMap.m_height);
+
+        const Uint32 mapSize = mMap.m_width*mMap.m_height*sizeof(word);
+
+        // The planes go in as they are. Only an XML export base64 encodes them.
+        putRawValue(mapNode.put("bgdata", ""), mMap.getBackgroundData(), mapSize);
+        putRawValue(mapNode.put("fgdata", ""), mMap.getForegroundData(), mapSize);
+        putRawValue(mapNode.put("infodata", ""), mMap.getInfoData(), mapSize);
+    }
+}
+
+void CMapPlayGalaxy::storeObjects(boost::property_tree::ptree &levelNode)
+{
     const Uint16 level = mMap.getLevel();
     levelNode.put("level", level);
 
@@ -478,27 +509,15 @@ void CMapPlayGalaxy::operator>>(boost::property_tree::ptree &levelNode)
         spriteNode.put("Actionumber", it->m_ActionNumber);
         it->serialize(spriteNode);
     }
-
-    // Save the map_data as it is left
-    {
-        auto &mapNode = levelNode.put("Map", "");
-        mapNode.put("width", mMap.m_width);
-        mapNode.put("height", mMap.m_height);
-
-        const Uint32 mapSize = mMap.m_width*mMap.m_height*sizeof(word);
-
-        const std::string b64textBG   = base64Encode( reinterpret_cast<byte*>(mMap.getBackgroundData()), mapSize);
-        const std::string b64textFG   = base64Encode( reinterpret_cast<byte*>(mMap.getForegroundData()), mapSize);
-        const std::string b64textInfo = base64Encode( reinterpret_cast<byte*>(mMap.getInfoData()), mapSize);
-
-        mapNode.put("bgdata", b64textBG);
-        mapNode.put("fgdata", b64textFG);
-        mapNode.put("infodata", b64textInfo);
-    }
 }
 
 // This is for loading the game
-void CMapPlayGalaxy::operator<<(boost::property_tree::ptree &levelNode)
+bool CMapPlayGalaxy::operator<<(boost::property_tree::ptree &levelNode)
+{
+    return restoreLevel(levelNode, true);
+}
+
+bool CMapPlayGalaxy::restoreLevel(boost::property_tree::ptree &levelNode, const bool reloadMap)
 {
     int level = levelNode.get<int>("level", 0);
 
@@ -520,25 +539,43 @@ void CMapPlayGalaxy::operator<<(boost::property_tree::ptree &levelNode)
     else
     {
         gLogging.textOut("Error loading the file. This game is not supported!");
-        return;
+        return false;
     }
 
-    // Load the World map level.
-    mapLoader->loadMap( mMap, level );
+    if(reloadMap)
+    {
+        // Load the World map level.
+        mapLoader->loadMap( mMap, level );
 
-    gMusicPlayer.stop();
+        gMusicPlayer.stop();
 
-    // Prepare to load the Background Music
-    if( !galaxy::loadLevelMusic(level) )
-    {
-        gLogging.textOut("Warning: The music cannot be played. Check that all the files have been correctly copied!");
+        // Prepare to load the Background Music
+        if( !galaxy::loadLevelMusic(level) )
+        {
+            gLogging.textOut("Warning: The music cannot be played. Check that all the files have been correctly copied!");
+        }
+        else
+        {
+            gMusicPlayer.play();
+        }
     }
-    else
+
+
+    // The planes have to fit the map exactly. Otherwise nothing more is restored.
+    auto &mapNode = levelNode.get_child("Map");
+    const Uint32 mapSize = mMap.m_width*mMap.m_height*sizeof(word);
+    std::vector<byte> bgPlane, fgPlane, infoPlane;
+
+    if( mapNode.get<Uint32>("width") != mMap.m_width ||
+        mapNode.get<Uint32>("height") != mMap.m_height ||
+        !getRawValue(mapNode.get_child("bgdata"), mapSize, bgPlane) ||
+        !getRawValue(mapNode.get_child("fgdata"), mapSize, fgPlane) ||
+        !getRawValue(mapNode.get_child("infodata"), mapSize, infoPlane) )
     {
-        gMusicPlayer.play();
+        gLogging.textOut("Error loading the level. The stored map doesn't fit the size of the level.");
+        return false;
     }
 
-
     // load the number of objects on screen
     Uint32 x, y;
     Uint16 foeID;
@@ -556,7 +593,8 @@ void CMapPlayGalaxy::operator<<(boost::property_tree::ptree &levelNode)
     mMap.mNumFuses = 0;
     mMap.mFuseInLevel = false;
 
-    gLogging.textOut("Restoring enemies status");
+    if(reloadMap)
+        gLogging.textOut("Restoring enemies status");
 
     for( auto &levelItem : levelNode )
     {
@@ -605,27 +643,203 @@ void CMapPlayGalaxy::operator<<(boost::property_tree::ptree &levelNode)
         }
     }
 
-    gLogging.textOut("Restoring map status");
+    if(reloadMap)
+        gLogging.textOut("Restoring map status");
 
     // Save the map_data as it is left
+    memcpy(mMap.getBackgroundData(), bgPlane.data(), mapSize);
+    memcpy(mMap.getForegroundData(), fgPlane.data(), mapSize);
+    memcpy(mMap.getInfoData(), infoPlane.data(), mapSize);
+
+    if( mMap.m_width * mMap.m_height > 0 )
     {
-        auto &mapNode = levelNode.get_child("Map");
-        mMap.m_width = mapNode.get<int>("width");
-        mMap.m_height = mapNode.get<int>("height");
+        mMap.drawAll();
+    }
+
+    return true;
+}
 
-        const std::string b64textBG   = mapNode.get<std::string>("bgdata");
-        const std::string b64textFG   = mapNode.get<std::string>("fgdata");
-        const std::string b64textInfo = mapNode.get<std::string>("infodata");
 
-        base64Decode(reinterpret_cast<byte*>(mMap.getBackgroundData()), b64textBG);
-        base64Decode(reinterpret_cast<byte*>(mMap.getForegroundData()), b64textFG);
-        base64Decode(reinterpret_cast<byte*>(mMap.getInfoData()), b64textInfo);
+namespace
+{
+
+// Front of a snapshot. It and what follows up to the objects keep their size within a level,
+// so the deltas of the rewind ring line up byte by byte.
+struct SnapshotHeader
+{
+    Uint32 level;
+    Uint32 width;
+    Uint32 height;
+    Uint32 scrollx;
+    Uint32 scrolly;
+    Uint32 numTimers[3];
+};
+
+}
+
+void CMapPlayGalaxy::takeSnapshot(std::vector<byte> &snapshot)
+{
+    using boost::property_tree::ptree;
+
+    SnapshotHeader header;
+    header.level = mMap.getLevel();
+    header.width = mMap.m_width;
+    header.height = mMap.m_height;
+    header.scrollx = mMap.m_scrollx;
+    header.scrolly = mMap.m_scrolly;
+
+    const size_t planeSize = size_t(mMap.m_width)*mMap.m_height*sizeof(word);
+    size_t fixedSize = sizeof(header) + 3*planeSize;
+
+    for( int plane=0 ; plane<3 ; plane++ )
+    {
+        header.numTimers[plane] = Uint32(mMap.getPlaneTimers(plane).size());
+        fixedSize += header.numTimers[plane]*sizeof(int);
     }
 
-    if( mMap.m_width * mMap.m_height > 0 )
+    // Only the objects and the inventories go through a tree, they know how to serialise themselves
+    ptree pt;
+    storeObjects(pt.add("Level", ""));
+
+    for( auto &inv : mInventoryVec )
     {
-        mMap.drawAll();
+        ptree &invNode = pt.add("Inventory", "");
+        inv >> invNode;
+    }
+
+    std::ostringstream stream;
+    writeBinaryTree(stream, pt, false);
+    const std::string tree = stream.str();
+
+    snapshot.resize(fixedSize + tree.size());
+    byte *out = snapshot.data();
+
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+
+    const word *planes[3] = { mMap.getBackgroundData(), mMap.getForegroundData(), mMap.getInfoData() };
+    for( const word *plane : planes )
+    {
+        memcpy(out, plane, planeSize);
+        out += planeSize;
+    }
+
+    for( int plane=0 ; plane<3 ; plane++ )
+    {
+        const std::vector<int> &timers = mMap.getPlaneTimers(plane);
+        memcpy(out, timers.data(), timers.size()*sizeof(int));
+        out += timers.size()*sizeof(int);
+    }
+
+    memcpy(out, tree.data(), tree.size());
+}
+
+
+bool CMapPlayGalaxy::restoreSnapshot(const std::vector<byte> &snapshot)
+{
+    using boost::property_tree::ptree;
+
+    SnapshotHeader header;
+    if( snapshot.size() < sizeof(header) )
+        return false;
+
+    memcpy(&header, snapshot.data(), sizeof(header));
+
+    const size_t planeSize = size_t(header.width)*header.height*sizeof(word);
+    size_t fixedSize = sizeof(header) + 3*planeSize;
+
+    for( int plane=0 ; plane<3 ; plane++ )
+    {
+        fixedSize += header.numTimers[plane]*sizeof(int);
+    }
+
+    if( snapshot.size() < fixedSize )
+        return false;
+
+    ptree pt;
+    std::istringstream stream(std::string(reinterpret_cast<const char*>(snapshot.data()) + fixedSize,
+                                          snapshot.size() - fixedSize));
+    if( !readBinaryTree(stream, pt) )
+        return false;
+
+    ptree &levelNode = pt.get_child("Level");
+
+    // restoreLevel() takes the planes from the map node, like when loading a savegame
+    const byte *in = snapshot.data() + sizeof(header);
+
+    auto &mapNode = levelNode.put("Map", "");
+    mapNode.put("width", header.width);
+    mapNode.put("height", header.height);
+
+    const char *planeNames[3] = { "bgdata", "fgdata", "infodata" };
+    for( const char *name : planeNames )
+    {
+        putRawValue(mapNode.put(name, ""), reinterpret_cast<const word*>(in), planeSize);
+        in += planeSize;
+    }
+
+    // Within the same level, the map doesn't need to be loaded again
+    const bool sameLevel = (header.level == mMap.getLevel());
+    if( !restoreLevel(levelNode, !sameLevel) )
+        return false;
+
+    for( int plane=0 ; plane<3 ; plane++ )
+    {
+        std::vector<int> &timers = mMap.getPlaneTimers(plane);
+        const size_t timersSize = header.numTimers[plane]*sizeof(int);
+
+        if( timers.size() == header.numTimers[plane] )
+        {
+            memcpy(timers.data(), in, timersSize);
+        }
+        in += timersSize;
     }
+
+    auto invIt = mInventoryVec.begin();
+
+    for( auto &item : pt )
+    {
+        if( item.first == "Inventory" && invIt != mInventoryVec.end() )
+        {
+            *invIt << item.second;
+            invIt++;
+        }
+    }
+
+    mMap.gotoPos( header.scrollx, header.scrolly );
+    mMap.drawAll();
+    gVideoDriver.updateScrollBuffer(mMap.m_scrollx, mMap.m_scrolly);
+
+    return true;
+}
+
+
+void CMapPlayGalaxy::setRewindLength(const size_t ticks)
+{
+    // A full snapshot every second of play
+    mRewindRing.reset(ticks, 70);
 }
 
 
+bool CMapPlayGalaxy::rewind(const size_t ticks)
+{
+    std::vector<byte> snapshot;
+
+    if( !mRewindRing.get(ticks, snapshot) )
+        return false;
+
+    if( !restoreSnapshot(snapshot) )
+        return false;
+
+    // Play goes on from the restored snapshot, what came after it is gone
+    mRewindRing.dropNewest(ticks);
+
+    return true;
+}
+
+
+Uint64 CMapPlayGalaxy::stateHash()
+{
+    takeSnapshot(mSnapshotBuffer);
+    return GsInputRecorder::hashBytes(mSnapshotBuffer.data(), mSnapshotBuffer.size());
+}
@@ -20,6 +20,7 @@
 #include "ep6/CMapLoaderGalaxyEp6.h"
 #include <base/CInput.h>
 #include "sdl/audio/music/CMusic.h"
+#include "engine/core/CSnapshotRing.h"
 #include <base/utils/StringUtils.h>
 #include <memory>
 #include <vector>
@@ -74,8 +75,39 @@ public:
     // Saves the inventory using the Savegamecontroller.
     void operator>>(boost::property_tree::ptree &levelNode);
 
-    // This is for loading the game
-    void operator<<(boost::property_tree::ptree &levelNode);
+    // This is for loading the game. false if the stored map doesn't fit the level.
+    bool operator<<(boost::property_tree::ptree &levelNode);
+
+    /**
+     * @brief takeSnapshot  Captures the running level in memory: the map planes with
+     *                      their animation timers, all objects, the inventories and the scroll position.
+     *                      The map goes first in a fixed layout, only the objects and inventories
+     *                      follow as a binary tree.
+     */
+    void takeSnapshot(std::vector<byte> &snapshot);
+
+    /**
+     * @brief restoreSnapshot   Puts the level back into the state of a snapshot
+     * @return                  false if the snapshot is damaged
+     */
+    bool restoreSnapshot(const std::vector<byte> &snapshot);
+
+    /**
+     * @brief setRewindLength   Keeps a snapshot of each of the last logic ticks,
+     *                          so the play can be rewound that far. 0 turns that off.
+     */
+    void setRewindLength(const size_t ticks);
+
+    /**
+     * @brief rewind    Goes back that many logic ticks. The later snapshots are dropped.
+     * @return          false if not that many are kept
+     */
+    bool rewind(const size_t ticks);
+
+    /**
+     * @brief stateHash Hash of what takeSnapshot() captures, used to verify input replays
+     */
+    Uint64 stateHash();
 
 
 	CMap &getMapObj()
@@ -93,6 +125,16 @@ protected:
 	std::vector<CInventory> &mInventoryVec;
 
     bool mMsgBoxOpen;
+
+private:
+
+    // Level number and the objects, everything of the level except the map
+    void storeObjects(boost::property_tree::ptree &levelNode);
+
+    bool restoreLevel(boost::property_tree::ptree &levelNode, const bool reloadMap);
+
+    CSnapshotRing mRewindRing;
+    std::vector<byte> mSnapshotBuffer;
 };
 
 #endif /* CMAPPLAYGALAXY_H_ */
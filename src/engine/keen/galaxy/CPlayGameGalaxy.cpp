@@ -30,6 +30,8 @@
 
 #include <fileio/KeenFiles.h>
 #include <base/GsArguments.h>
+#include <base/GsInputRecorder.h>
+#include <base/GsBenchmark.h>
 
 
 namespace galaxy
@@ -69,6 +71,11 @@ m_LevelPlay( mInventoryVec)
     gEffectController.setupEffect(pColorMergeFX);
 }
 
+CPlayGameGalaxy::~CPlayGameGalaxy()
+{
+    gInputRecorder.setStateHasher(nullptr);
+}
+
 // NOTE: Only for compatibility mode. Since CG 1.5 it is only used for
 // supporting older versions of Savegame states of CG
 bool CPlayGameGalaxy::loadGameState()
@@ -119,7 +126,7 @@ bool CPlayGameGalaxy::loadXMLGameState()
     ptree pt;
 
     CSaveGameController &savedGame = gSaveGameController;
-    if(!savedGame.loadXMLTree(pt))
+    if(!savedGame.loadTree(pt))
         return false;
 
     /// Read the nodes and store the data as needed
@@ -170,14 +177,16 @@ bool CPlayGameGalaxy::loadXMLGameState()
     ptree &wmNode = stateNode.get_child("WorldMap");
     active = wmNode.get<bool>("<xmlattr>.active", false);
     m_WorldMap.setActive(active);
-    m_WorldMap << wmNode;
+    if( !(m_WorldMap << wmNode) )
+        return false;
 
     ptree &levelPlayNode = stateNode.get_child("LevelPlay");
     active = levelPlayNode.get<bool>("<xmlattr>.active");
     m_LevelPlay.setActive(active);
     if( active )
     {
-        m_LevelPlay << levelPlayNode;
+        if( !(m_LevelPlay << levelPlayNode) )
+            return false;
     }
 
     return true;
@@ -236,7 +245,7 @@ bool CPlayGameGalaxy::saveXMLGameState()
         m_LevelPlay >> levelPlayNode;
     }
 
-    if( gSaveGameController.saveXMLTree(pt) )
+    if( gSaveGameController.saveTree(pt) )
     {
         return true;
     }
@@ -269,6 +278,17 @@ bool CPlayGameGalaxy::init()
     mDead.assign(numPlayers, false);
     mGameOver.assign(numPlayers, false);
 
+    // Input recordings verify the replay against whichever map is played
+    gInputRecorder.mark("episode", itoa(int(m_Episode)));
+    gInputRecorder.setStateHasher([this]() -> Uint64
+    {
+        if(m_LevelPlay.isActive())
+            return m_LevelPlay.stateHash();
+        if(m_WorldMap.isActive())
+            return m_WorldMap.stateHash();
+        return 0;
+    });
+
     return true;
 }
 
@@ -590,6 +610,9 @@ void CPlayGameGalaxy::ponder(const float deltaT)
         m_LevelPlay.ponder(deltaT);
     }
 
+    if((m_WorldMap.isActive() || m_LevelPlay.isActive()) && !msgboxactive)
+        gBenchmark.gameplayRunning();
+
     // Draw some Textboxes with Messages only if one of those is open and needs to be drawn
     if(msgboxactive)
     {
@@ -642,6 +665,26 @@ void CPlayGameGalaxy::ponder(const float deltaT)
             cheat.jump = true;
             showMsg("Super Cheat!");
         }
+        else if(gInput.getHoldedKey(KR))
+        {
+            cheat.rewind = !cheat.rewind;
+
+            // The last ten seconds of play are kept
+            const size_t rewindTicks = cheat.rewind ? 10*70 : 0;
+            m_WorldMap.setRewindLength(rewindTicks);
+            m_LevelPlay.setRewindLength(rewindTicks);
+
+            std::string rewindstring = "Rewinding has been ";
+            rewindstring += ((cheat.rewind) ? "enabled" : "disabled");
+            showMsg(rewindstring);
+        }
+        else if(cheat.rewind && gInput.getPressedKey(KBCKSPCE))
+        {
+            // One second back per press
+            CMapPlayGalaxy &map = m_LevelPlay.isActive() ?
+                        static_cast<CMapPlayGalaxy&>(m_LevelPlay) : m_WorldMap;
+            map.rewind(70);
+        }
     }
 
 
@@ -31,6 +31,8 @@ public:
     CPlayGameGalaxy(const int startlevel,
                     const std::vector<int> &spriteVars);
 
+    ~CPlayGameGalaxy();
+
     bool loadGameState();
     bool loadXMLGameState();
     bool saveXMLGameState();
@@ -25,6 +25,7 @@
 #include <base/video/CVideoDriver.h>
 #include <fileio/KeenFiles.h>
 #include <base/GsArguments.h>
+#include <base/GsBenchmark.h>
 
 namespace galaxy
 {
@@ -356,10 +357,10 @@ void GalaxyEngine::pumpEvent(const CEvent *evPtr)
     {
         const auto argLevel = gArgs.getValue("level");
 
-        // Level as parameter given?
-        if(!argLevel.empty())
+        // Level as parameter given? Benchmarks go straight into the game as well, on the map if no level was given
+        if(!argLevel.empty() || gBenchmark.active())
         {
-            const int startLevel = atoi(argLevel.c_str());
+            const int startLevel = argLevel.empty() ? WORLD_MAP_LEVEL_GALAXY : atoi(argLevel.c_str());
 
             // There always is at least one sprite variant, the original one!
             if(mSpriteVars.empty())
@@ -14,6 +14,9 @@
 #include "fileio/compression/CHuffman.h"
 #include "fileio/KeenFiles.h"
 #include "engine/core/CBehaviorEngine.h"
+#include <base/utils/ThreadPool.h>
+#include "sdl/audio/sound/CSoundCache.h"
+#include <memory>
 
 
 
@@ -335,10 +338,12 @@ bool CAudioGalaxy::LoadFromAudioCK(const unsigned int dictOffset)
 
     std::string audioDictfilename = getResourceFilename( gKeenFiles.audioDictFilename, gKeenFiles.gameDir, false, false);
 
+    bool dictLoaded;
+
     if(audioDictfilename.empty())
-        Huffman.readDictionaryNumber( ExeFile, 0, dictOffset );
+        dictLoaded = Huffman.readDictionaryNumber( ExeFile, 0, dictOffset );
     else
-        Huffman.readDictionaryFromFile( audioDictfilename );
+        dictLoaded = Huffman.readDictionaryFromFile( audioDictfilename );
 
     /// First get the size of the AUDIO.CK? File.
     uint32_t audiofilecompsize;
@@ -491,66 +496,100 @@ bool CAudioGalaxy::LoadFromAudioCK(const unsigned int dictOffset)
         }
     }
 
-    for( unsigned int snd=0 ; snd<number_of_total_sounds ; snd++ )
-    {
-        /// Now we have all the data we need.
-        // decompress every file of AUDIO.CK? using huffman decompression algorithm
-        const uint32_t audio_start = audiohed[snd];
-        const uint32_t audio_end = audiohed[snd+1];
+    const Uint8 formatsize = (audioSpec.format == AUDIO_S16) ? 2 : 1;
 
-        const uint32_t audio_comp_data_start = audio_start+sizeof(uint32_t); // Why this strange offset by 4 bytes?
+    // Rendering all the effects takes a while. If they were rendered for the same
+    // data and audio settings before, take them from the cache instead.
+    SoundCacheKey cacheKey;
+    cacheKey.audioCrc = CSoundCache::checksum(AudioCompFileData.data(), AudioCompFileData.size());
+    cacheKey.hedCrc = CSoundCache::checksum(audiohed.data(), audiohed.size()*sizeof(uint32_t));
+    // Without a dictionary its nodes were never set, so they can't be part of the key
+    cacheKey.dictCrc = dictLoaded ?
+                CSoundCache::checksum(Huffman.getDictionary(), DICT_SIZE*sizeof(nodestruct)) : 0;
+    cacheKey.freq = audioSpec.freq;
+    cacheKey.format = audioSpec.format;
+    cacheKey.channels = audioSpec.channels;
 
-        std::vector<byte> imfdata;
+    const CSoundCache soundCache(cacheKey);
 
-        if( audio_comp_data_start < audio_end )
-        {
-            const uint32_t *AudioCompFileData32 = reinterpret_cast<uint32_t*>(
-                        reinterpret_cast<void*>(AudioCompFileData.data() + audio_start));
+    std::vector<char> soundRead(number_of_total_sounds, 1);
 
-            outsize = *AudioCompFileData32;
-            imfdata.resize(outsize);
+    if(soundCache.load(m_soundslot, soundRead))
+    {
+        gLogging.ftextOut("CAudioGalaxy::LoadFromAudioCK(): Sound effects taken from the cache.<br>");
+    }
+    else
+    {
+        // Every sound is decoded and rendered independently, so spread them over the workers.
+        // Adlib effects get their own emulator each, because one chip cannot be shared
+        // between threads. The log isn't thread-safe, so failures are reported afterwards.
+        parallelFor(number_of_total_sounds, [&](const size_t snd)
+        {
+            /// Now we have all the data we need.
+            // decompress every file of AUDIO.CK? using huffman decompression algorithm
+            const uint32_t audio_start = audiohed[snd];
+            const uint32_t audio_end = audiohed[snd+1];
 
-            byte *imfdataPtr = reinterpret_cast<byte *>(imfdata.data());
+            const uint32_t audio_comp_data_start = audio_start+sizeof(uint32_t); // Why this strange offset by 4 bytes?
 
-            const unsigned long insize = audio_end-audio_comp_data_start;
+            std::vector<byte> imfdata;
 
-            // Same size, just copy then
-            if(!mustDehuffman)
-            {
-                memcpy(imfdataPtr,
-                       reinterpret_cast<byte*>(&AudioCompFileData[audio_comp_data_start]),
-                       insize);
-            }
-            else // uncompress!
+            if( audio_comp_data_start < audio_end )
             {
-                Huffman.expand( reinterpret_cast<byte*>(&AudioCompFileData[audio_comp_data_start]),
-                                imfdataPtr,
-                                insize,
-                                outsize);
-            }
+                const uint32_t *AudioCompFileData32 = reinterpret_cast<uint32_t*>(
+                            reinterpret_cast<void*>(AudioCompFileData.data() + audio_start));
 
+                const uint32_t sndOutsize = *AudioCompFileData32;
+                imfdata.resize(sndOutsize);
 
-            if(snd>=al_snd_start)
-            {
-                const bool ok = readISFintoWaveForm( m_soundslot[snd],
-                                                     imfdataPtr,
-                                                     (audioSpec.format == AUDIO_S16) ? 2 : 1 );
-                if(!ok)
+                byte *imfdataPtr = reinterpret_cast<byte *>(imfdata.data());
+
+                const unsigned long insize = audio_end-audio_comp_data_start;
+
+                // Same size, just copy then
+                if(!mustDehuffman)
                 {
-                    gLogging << "Sound " << snd << " could not be read!<br>";
+                    memcpy(imfdataPtr,
+                           reinterpret_cast<byte*>(&AudioCompFileData[audio_comp_data_start]),
+                           insize);
+                }
+                else // uncompress!
+                {
+                    Huffman.expand( reinterpret_cast<byte*>(&AudioCompFileData[audio_comp_data_start]),
+                                    imfdataPtr,
+                                    insize,
+                                    sndOutsize);
                 }
-            }
-            else
-            {
-                const bool ok = readPCSpeakerSoundintoWaveForm( m_soundslot[snd],
-                                                                imfdataPtr,
-                                                                (audioSpec.format == AUDIO_S16) ? 2 : 1 );
 
-                if(!ok)
+
+                if(snd>=al_snd_start)
                 {
-                    gLogging << "Sound " << snd << " could not be read!<br>";
+                    std::unique_ptr<COPLEmulator> pOPLEmulator(new COPLEmulator);
+                    soundRead[snd] = readISFintoWaveForm( m_soundslot[snd],
+                                                          imfdataPtr,
+                                                          formatsize,
+                                                          *pOPLEmulator );
+                }
+                else
+                {
+                    soundRead[snd] = readPCSpeakerSoundintoWaveForm( m_soundslot[snd],
+                                                                     imfdataPtr,
+                                                                     formatsize );
                 }
             }
+        }, "Galaxy sounds");
+
+        if(!soundCache.save(m_soundslot, soundRead))
+        {
+            gLogging.ftextOut("CAudioGalaxy::LoadFromAudioCK(): Sound effects could not be written to the cache.<br>");
+        }
+    }
+
+    for( unsigned int snd=0 ; snd<number_of_total_sounds ; snd++ )
+    {
+        if(!soundRead[snd])
+        {
+            gLogging << "Sound " << snd << " could not be read!<br>";
         }
     }
 
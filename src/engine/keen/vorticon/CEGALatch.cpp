@@ -16,6 +16,7 @@
 #include <base/GsLogging.h>
 #include "engine/core/CPlanes.h"
 #include <base/utils/FindFile.h>
+#include <base/utils/ThreadPool.h>
 #include <SDL.h>
 #include <stdio.h>
 #include <string.h>
@@ -134,7 +135,6 @@ bool CEGALatch::loadData( const std::string &path,
 {
 	std::string filename;
 	byte *RawData;
-    Uint16 width, height;
     SDL_Surface *sfc;
 
 
@@ -149,15 +149,24 @@ bool CEGALatch::loadData( const std::string &path,
     // get the data out of the file into the memory, decompressing it if necessary.
     if (compresseddata)
     {
-		if (lz_decompress(latchfile, (unsigned char*) RawData))
+		if (lz_decompress(latchfile, (unsigned char*) RawData, size_t(m_latchplanesize)*4))
 		{
-			return 1;
+			fclose(latchfile);
+			delete [] RawData;
+			return false;
 		}
     }
     else
     {
-    	for(int i=0 ; i<(m_latchplanesize*4) ; i++)
-    		RawData[i] = fgetc(latchfile);
+		const size_t rawSize = size_t(m_latchplanesize)*4;
+		const size_t read = fread(RawData, 1, rawSize, latchfile);
+
+		// Like fgetc at the end of the file, the missing bytes become 0xFF
+		if( read < rawSize )
+		{
+			memset(RawData+read, 0xFF, rawSize-read);
+			gLogging.textOut("CEGALatch::loadData(): " + filename + " is shorter than expected<br>");
+		}
     }
 
     fclose(latchfile);
@@ -248,27 +257,38 @@ bool CEGALatch::loadData( const std::string &path,
 	// loaded into one continuous stream of image data, with the bitmaps[]
 	// array giving pointers to where each bitmap starts within the stream.
 
-	for(int p=0 ; p<4 ; p++)
+	// Within every plane the bitmaps follow each other bitwise. With the start of each one
+	// known, every bitmap can be decoded by its own job.
+	std::vector<unsigned long> bitmapBitOffset(size_t(m_bitmaps), 0);
+	for(int b=1 ; b<m_bitmaps ; b++)
 	{
-		for(int b=0 ; b<m_bitmaps ; b++)
-		{
-            GsBitmap &bitmap = gGraphics.getBitmapFromId(b);
-			// this points to the location that we're currently
-			// decoding bitmap data to
+		GsBitmap &bitmap = gGraphics.getBitmapFromId(b-1);
+		bitmapBitOffset[b] = bitmapBitOffset[b-1] +
+							 (unsigned long)(bitmap.width())*(unsigned long)(bitmap.height());
+	}
 
-			sfc= bitmap.getSDLSurface();
-			if(SDL_MUSTLOCK(sfc)) SDL_LockSurface(sfc);
-			Uint8* pixel = (Uint8*) sfc->pixels;
-			if(p==0)
-				SDL_FillRect(sfc, NULL, 0);
-			width = bitmap.width(); height = bitmap.height();
-			// Now read the raw data
+	parallelFor(size_t(m_bitmaps), [&](const size_t b)
+	{
+		GsBitmap &bitmap = gGraphics.getBitmapFromId(int(b));
+		// this points to the location that we're currently
+		// decoding bitmap data to
+
+		SDL_Surface *bmpSfc = bitmap.getSDLSurface();
+		if(SDL_MUSTLOCK(bmpSfc)) SDL_LockSurface(bmpSfc);
+		Uint8* pixel = (Uint8*) bmpSfc->pixels;
+		SDL_FillRect(bmpSfc, NULL, 0);
 
-			Planes.readPlane(p, pixel, width, height);
+		CPlanes bitmapPlanes(Planes);
 
-			if(SDL_MUSTLOCK(sfc)) SDL_UnlockSurface(sfc);
+		// Now read the raw data
+		for(int p=0 ; p<4 ; p++)
+		{
+			bitmapPlanes.skipBits(p, bitmapBitOffset[b]);
+			bitmapPlanes.readPlane(p, pixel, bitmap.width(), bitmap.height());
 		}
-	}
+
+		if(SDL_MUSTLOCK(bmpSfc)) SDL_UnlockSurface(bmpSfc);
+	}, "Bitmap planes");
 
 	std::set<std::string> filelist;
 	FileListAdder fileListAdder;
@@ -15,12 +15,14 @@
 #include <base/video/CVideoDriver.h>
 #include "engine/core/spritedefines.h"
 #include "fileio/lz.h"
+#include <base/GsLogging.h>
 #include "fileio/KeenFiles.h"
 #include <fileio/ResourceMgmt.h>
 #include "engine/core/CBehaviorEngine.h"
 #include "CVorticonSpriteObject.h"
 #include "engine/core/CResourceLoader.h"
 #include "graphics/GsGraphics.h"
+#include <base/utils/ThreadPool.h>
 #include <SDL.h>
 #include <stdio.h>
 #include <string.h>
@@ -97,17 +99,30 @@ bool CEGASprit::loadData(const std::string& filename, bool compresseddata)
 	
 	gResourceLoader.setPermilage(10);
 
-    byte RawData[m_planesize * 5];
+    // On the heap, modded sprite files may have planes much larger than the stack allows
+    const size_t rawSize = size_t(m_planesize) * 5;
+    std::vector<byte> RawDataVec(rawSize, 0);
+    byte *RawData = RawDataVec.data();
+
     // get the data out of the file into the memory, decompressing it if necessary.
     if (compresseddata)
     {
-		if (lz_decompress(latchfile, RawData))
-			return 1;
+		if (lz_decompress(latchfile, RawData, rawSize))
+		{
+			fclose(latchfile);
+			return false;
+		}
     }
     else
     {
-    	for(int i=0 ; i<(m_planesize*5) ; i++)
-    		RawData[i] = fgetc(latchfile);
+		const size_t read = fread(RawData, 1, rawSize, latchfile);
+
+		// Like fgetc at the end of the file, the missing bytes become 0xFF
+		if( read < rawSize )
+		{
+			memset(RawData+read, 0xFF, rawSize-read);
+			gLogging.textOut("CEGASprit::loadData(): " + filename + " is shorter than expected<br>");
+		}
     }
 	
     fclose(latchfile);
@@ -135,41 +150,51 @@ bool CEGASprit::loadData(const std::string& filename, bool compresseddata)
 
     auto &SpriteVecPlayer1 = gGraphics.getSpriteVec(0);
 
-    // Read unmasked sprite
-    for(int i=0 ; i<mNumsprites ; i++)
-	{
+    // Every sprite gets decoded by its own job. Those only write to the surfaces of that sprite,
+    // so the result does not depend on how many workers are used.
+    // Progress is only reported between the stages to keep it deterministic.
+    const Uint32 blitFlags = gVideoDriver.mpVideoEngine->getBlitSurface()->flags;
+
+    parallelFor(size_t(mNumsprites), [&](const size_t i)
+    {
         GsSprite &Sprite = SpriteVecPlayer1[i];
 		Sprite.setSize( EGASpriteModell[i].width, EGASpriteModell[i].height );
 		Sprite.setBoundingBoxCoordinates( (EGASpriteModell[i].hitbox_l << STC),
 				(EGASpriteModell[i].hitbox_u << STC),
 				(EGASpriteModell[i].hitbox_r << STC),
 				(EGASpriteModell[i].hitbox_b << STC) );
-		Sprite.createSurface( gVideoDriver.mpVideoEngine->getBlitSurface()->flags,
-				gGraphics.Palette.m_Palette );
-
-        percent = (i*50)/mNumsprites;
-		gResourceLoader.setPermilage(50+percent);
-	}
+		Sprite.createSurface( blitFlags, gGraphics.Palette.m_Palette );
+    }, "Sprite surfaces");
 
 	gResourceLoader.setPermilage(100);
 
+    // The sprites follow each other bitwise within every plane.
+    // Find out where each of them starts, so they can be read independently.
+    std::vector<unsigned long> spriteBitOffset(size_t(mNumsprites), 0);
+    for(int s=1 ; s<mNumsprites ; s++)
+    {
+        auto &sfc = SpriteVecPlayer1[s-1].Surface();
+        spriteBitOffset[s] = spriteBitOffset[s-1] +
+                             (unsigned long)(sfc.width())*(unsigned long)(sfc.height());
+    }
+
     // Read unmasked sprite
-	for(int p=0 ; p<4 ; p++)
-	{
-        for(int s=0 ; s<mNumsprites ; s++)
-		{
-            auto &sfc = SpriteVecPlayer1[s].Surface();
-            sfc.lock();
-            auto pix = sfc.PixelPtr();
+    parallelFor(size_t(mNumsprites), [&](const size_t s)
+    {
+        CPlanes spritePlanes(Planes);
 
-            Planes.readPlane(p, pix, sfc.width(), sfc.height());
+        auto &sfc = SpriteVecPlayer1[s].Surface();
+        sfc.lock();
+        auto pix = sfc.PixelPtr();
 
-            sfc.unlock();
+        for(int p=0 ; p<4 ; p++)
+        {
+            spritePlanes.skipBits(p, spriteBitOffset[s]);
+            spritePlanes.readPlane(p, pix, sfc.width(), sfc.height());
+        }
 
-            percent = (s*100)/mNumsprites;
-			gResourceLoader.setPermilage(100+percent);
-		}
-	}
+        sfc.unlock();
+    }, "Sprite planes");
 
 	gResourceLoader.setPermilage(200);
 
@@ -177,9 +202,12 @@ bool CEGASprit::loadData(const std::string& filename, bool compresseddata)
 	// now load the 5th plane, which contains the sprite masks.
 	// note that we invert the mask because our graphics functions
 	// use white on black masks whereas keen uses black on white.
-    for(int s=0 ; s<mNumsprites ; s++)
+    parallelFor(size_t(mNumsprites), [&](const size_t s)
 	{        
-        GsSprite &sprite = gGraphics.getSprite(0,s);
+        CPlanes maskPlanes(Planes);
+        maskPlanes.skipBits(4, spriteBitOffset[s]);
+
+        GsSprite &sprite = SpriteVecPlayer1[s];
 
         auto &sfc = sprite.Surface();
         auto &maskSfc = sprite.MaskSurface();
@@ -194,7 +222,7 @@ bool CEGASprit::loadData(const std::string& filename, bool compresseddata)
 		{
             for(int x=0 ; x<maskSfc.width() ; x++)
 			{
-				if(Planes.getbit(4))
+				if(maskPlanes.getbit(4))
                 {
                     maskPix[y*maskSfc.width() + x] = pix[y*sfc.width() + x];
                 }
@@ -207,96 +235,76 @@ bool CEGASprit::loadData(const std::string& filename, bool compresseddata)
 
         maskSfc.unlock();
         sfc.unlock();
-
-        percent = (s*100)/mNumsprites;
-		gResourceLoader.setPermilage(200+percent);
-	}
+	}, "Sprite masks");
 
 	gResourceLoader.setPermilage(300);
 
     LoadSpecialSprites( SpriteVecPlayer1 );
 
-    for(unsigned int i=1 ; i<4 ; i++)
-    {
-        auto &spriteVecI = gGraphics.getSpriteVec(i);
-
-        assert(SpriteVecPlayer1.size() == spriteVecI.size());
-
-        for(size_t j=0 ; j<SpriteVecPlayer1.size() ; j++)
-        {
-            spriteVecI[j] = SpriteVecPlayer1[j];
-        }
-    }
-
-
-    // For the other variant let's exchange some colors
     auto &SpriteVecPlayer2 = gGraphics.getSpriteVec(1);
-    for( unsigned int i = 0 ; i < SpriteVecPlayer2.size() ; i++)
-    {
-        auto &sprite = SpriteVecPlayer2[i];
-
-        if(sprite.empty())
-            continue;
+    auto &SpriteVecPlayer3 = gGraphics.getSpriteVec(2);
+    auto &SpriteVecPlayer4 = gGraphics.getSpriteVec(3);
 
-        // Red against Purple
-        sprite.exchangeSpriteColor( 5, 4, 0 );
-        sprite.exchangeSpriteColor( 13, 12, 0 );
+    assert(SpriteVecPlayer1.size() == SpriteVecPlayer2.size());
+    assert(SpriteVecPlayer1.size() == SpriteVecPlayer3.size());
+    assert(SpriteVecPlayer1.size() == SpriteVecPlayer4.size());
 
-        // Yellow against Green
-        sprite.exchangeSpriteColor( 2, 6, 0 );
-        sprite.exchangeSpriteColor( 10, 14, 0 );
-    }
+    // Derive the other player variants by exchanging some colors and optimize all so far created sprite surfaces
+    parallelFor(SpriteVecPlayer1.size(), [&](const size_t j)
+    {
+        SpriteVecPlayer2[j] = SpriteVecPlayer1[j];
+        SpriteVecPlayer3[j] = SpriteVecPlayer1[j];
+        SpriteVecPlayer4[j] = SpriteVecPlayer1[j];
 
+        if(!SpriteVecPlayer2[j].empty())
+        {
+            auto &sprite = SpriteVecPlayer2[j];
 
-    auto &SpriteVecPlayer3 = gGraphics.getSpriteVec(2);
-    for( auto &sprite : SpriteVecPlayer3)
-    {
-        if(sprite.empty())
-            continue;
+            // Red against Purple
+            sprite.exchangeSpriteColor( 5, 4, 0 );
+            sprite.exchangeSpriteColor( 13, 12, 0 );
 
-        // Red against Green
-        sprite.exchangeSpriteColor( 2, 4, 0 );
-        sprite.exchangeSpriteColor( 10, 12, 0 );
+            // Yellow against Green
+            sprite.exchangeSpriteColor( 2, 6, 0 );
+            sprite.exchangeSpriteColor( 10, 14, 0 );
+        }
 
-        // Yellow against Purple
-        sprite.exchangeSpriteColor( 5, 6, 0 );
-        sprite.exchangeSpriteColor( 13, 14, 0 );
-    }
+        if(!SpriteVecPlayer3[j].empty())
+        {
+            auto &sprite = SpriteVecPlayer3[j];
 
-    auto &SpriteVecPlayer4 = gGraphics.getSpriteVec(3);
-    for( auto &sprite : SpriteVecPlayer4)
-    {
-        if(sprite.empty())
-            continue;
+            // Red against Green
+            sprite.exchangeSpriteColor( 2, 4, 0 );
+            sprite.exchangeSpriteColor( 10, 12, 0 );
 
-        // Red against Yellow
-        sprite.exchangeSpriteColor( 6, 4, 0 );
-        sprite.exchangeSpriteColor( 14, 12, 0 );
+            // Yellow against Purple
+            sprite.exchangeSpriteColor( 5, 6, 0 );
+            sprite.exchangeSpriteColor( 13, 14, 0 );
+        }
 
-        // Green against Purple
-        sprite.exchangeSpriteColor( 2, 5, 0 );
-        sprite.exchangeSpriteColor( 10, 13, 0 );
-    }
+        if(!SpriteVecPlayer4[j].empty())
+        {
+            auto &sprite = SpriteVecPlayer4[j];
 
+            // Red against Yellow
+            sprite.exchangeSpriteColor( 6, 4, 0 );
+            sprite.exchangeSpriteColor( 14, 12, 0 );
 
-    // Optimize all so far created sprite surfaces
-    for(unsigned int i=0 ; i<4 ; i++)
-    {
-        auto &spriteVec = gGraphics.getSpriteVec(i);
+            // Green against Purple
+            sprite.exchangeSpriteColor( 2, 5, 0 );
+            sprite.exchangeSpriteColor( 10, 13, 0 );
+        }
 
-        for(Uint16 s=0 ; s<spriteVec.size() ; s++)
+        for(unsigned int i=0 ; i<4 ; i++)
         {
-            GsSprite &Sprite = spriteVec[s];
+            GsSprite &Sprite = gGraphics.getSpriteVec(i)[j];
 
             if(!Sprite.empty())
             {
                 Sprite.optimizeSurface();
             }
-
-            percent = (s*50)/mNumsprites;
-            gResourceLoader.setPermilage(300+percent);
         }
-    }
+    }, "Sprite variants");
 
     gResourceLoader.setPermilage(350);
 
@@ -332,14 +340,13 @@ bool CEGASprit::loadData(const std::string& filename, bool compresseddata)
     for(unsigned int i=0 ; i<4 ; i++)
     {
         auto &spriteVec = gGraphics.getSpriteVec(i);
-        const int noSprites = spriteVec.size();
-        for(Uint16 s=0 ; s<noSprites ; s++)
+
+        parallelFor(spriteVec.size(), [&](const size_t s)
         {
             spriteVec[s].applyTransparency();
+        }, "Sprite transparency");
 
-            percent = (s*250)/noSprites;
-            gResourceLoader.setPermilage(500+percent);
-        }
+        gResourceLoader.setPermilage(500+((i+1)*250)/4);
     }
 
     gResourceLoader.setPermilage(750);
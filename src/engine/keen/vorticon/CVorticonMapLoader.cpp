@@ -9,6 +9,7 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
 #include <base/utils/FindFile.h>
 #include <base/GsLogging.h>
 #include <base/video/CVideoDriver.h>
@@ -68,35 +69,21 @@ mPlayerContainer(playerContainer)
 
 void CVorticonMapLoaderBase::blitPlaneToMap(std::vector<Uint16> &planeitems, const Uint16 planesize, const Uint16 planeID, const Uint16 tilemapID)
 {
-    unsigned int curmapx = 0, curmapy = 0;
+    const size_t startOffest = size_t(planesize)*planeID+17;
 
-    const unsigned int startOffest = planesize*planeID+17;
+    if(startOffest >= planeitems.size())
+        return;
 
     // Some mods seem to incorrectly read the planes, so if there is no data left, just break wiht
     // this trick.
-    const unsigned int realSize = planeitems.size()-startOffest;
-    const unsigned int desiredSize = planesize;
-    const unsigned int obtainedSize = std::min(realSize, desiredSize);
-
-    for( size_t c=0 ; c<obtainedSize ; c++ ) // Check against Tilesize
-    {
-        int t = planeitems.at(startOffest+c);
-
-        mpMap->setTile(curmapx, curmapy, t, false, tilemapID);
-
-        curmapx++;
-        if (curmapx >= mpMap->m_width)
-        {
-            curmapx = 0;
-            curmapy++;
-            if (curmapy >= mpMap->m_height) break;
-        }
-
-        /*if(t > 255)
-        {
-            t=0; // If there are some invalid values in the file, set them to zero.
-        }*/
-    }
+    const size_t realSize = planeitems.size()-startOffest;
+    const size_t desiredSize = planesize;
+    const size_t mapSize = size_t(mpMap->m_width)*mpMap->m_height;
+    const size_t obtainedSize = std::min(std::min(realSize, desiredSize), mapSize);
+
+    // Plane and map are both stored row by row with the same width, so this is one block copy
+    word *mapData = mpMap->getData(tilemapID);
+    memcpy(mapData, planeitems.data()+startOffest, obtainedSize*sizeof(word));
 }
 
 
@@ -141,14 +128,15 @@ bool CVorticonMapLoaderBase::loadBase(  Uint8 episode,
 	}
 	gLogging.ftextOut("MapLoader: file %s opened. Loading...<br>", levelname.c_str());
 
+	MapFile.seekg (0, std::ios::end);
+	const std::streamoff fileSize = MapFile.tellg();
 	MapFile.seekg (0, std::ios::beg);
 
-	// load the compressed data into the memory
-	std::vector<Uint8>	compdata;
-	while( !MapFile.eof() )
-	{
-		compdata.push_back(static_cast<Uint8>(MapFile.get()));
-	}
+	// load the compressed data into the memory with one read.
+	// The former get() loop also stored the EOF marker as trailing 0xFF byte,
+	// keep it so odd sized files decompress the same way.
+	std::vector<Uint8>	compdata(size_t(fileSize)+1, 0xFF);
+	MapFile.read(reinterpret_cast<char*>(compdata.data()), fileSize);
 
 	MapFile.close();
 
@@ -178,22 +166,42 @@ void CVorticonMapLoaderWithPlayer::loadSprites( Uint8 episode,
 {
 	if( !mpSpriteObjectContainer.empty() )
 	    mpSpriteObjectContainer.clear();
-	
-	mpSpriteObjectContainer.reserve(2000);
-	
-	for( size_t curmapx = 0; curmapx<mpMap->m_width ; curmapx++ )
+
+	// Most of the object plane is empty. Collect the used entries first in one scan over
+	// the raw plane, then spawn only those, in the same column by column order as before.
+	struct SpawnEntry
 	{
-        for( size_t curmapy = 0; curmapy<mpMap->m_height ; curmapy++ )
-        {
-            const size_t t = mpMap->getPlaneDataAt(2, curmapx<<CSF, curmapy<<CSF);
+		Uint16 t, x, y;
+	};
 
-            if (mpMap->m_worldmap)
-                addWorldMapObject(t, curmapx, curmapy,  episode );
-            else
-                addSpriteObject(t, curmapx, curmapy, episode, level);
-        }
+	const size_t width = mpMap->m_width;
+	const size_t height = mpMap->m_height;
+	const word *objPlane = mpMap->getData(2);
+
+	std::vector<SpawnEntry> spawnList;
+
+	for( size_t curmapx = 0; curmapx<width ; curmapx++ )
+	{
+		const word *column = objPlane + curmapx;
+
+		for( size_t curmapy = 0; curmapy<height ; curmapy++ )
+		{
+			const word t = column[curmapy*width];
 
-	}	
+			if(t)
+				spawnList.push_back( {t, Uint16(curmapx), Uint16(curmapy)} );
+		}
+	}
+
+	mpSpriteObjectContainer.reserve(std::max(spawnList.size(), size_t(2000)));
+
+	for( const auto &spawn : spawnList )
+	{
+		if (mpMap->m_worldmap)
+			addWorldMapObject(spawn.t, spawn.x, spawn.y,  episode );
+		else
+			addSpriteObject(spawn.t, spawn.x, spawn.y, episode, level);
+	}
 }
 
 
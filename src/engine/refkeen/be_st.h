@@ -78,6 +78,9 @@ void BE_ST_TimeCountWaitFromSrc(uint32_t srctimecount, int16_t timetowait);
 // Same as above, but instead waits to reach dsttimecount
 // e.g., a replacement for "while (TimeCount<dsttimecount)"
 void BE_ST_TimeCountWaitForDest(uint32_t dsttimecount);
+// Replaces the counter TimeCount and the waits are based on, with frequency counts per second,
+// and the sleep of the waits. Null pointers bring back SDL's
+void BE_ST_SetCounterSource(uint64_t (*counterFunc)(void), uint64_t frequency, void (*delayFunc)(uint32_t ms));
 
 /*** Graphics ***/
 //void BE_ST_InitGfx(void);
@@ -7,20 +7,26 @@ extern "C"
 
 #include "SDL.h"
 
-static uint32_t g_sdlTicksOffset = 0;
-
 #define PC_PIT_RATE 1193182
 
 static uint32_t g_sdlTimeCount = 0;
 
-// A variable used for timing measurements
-static uint32_t g_sdlLastTicks;
+// High resolution counter value at which g_sdlTimeCount was last brought up to date
+static uint64_t g_sdlLastCounter;
+// Part of the next TimeCount tick which already went by, in counter units times PC_PIT_RATE
+static uint64_t g_sdlTimeCountRemainder;
+// Counter value all VBL waits are aligned to
+static uint64_t g_sdlCounterBase;
+static int g_sdlCounterReady = 0;
 
 
 // PIT timer divisor
 static uint32_t g_sdlScaledTimerDivisor;
 
 
+// The RefKeen audio backend below is not built. Keen Dreams plays its sounds through
+// CG's Audio (see CAudioGalaxy, slot map 7), which renders them ahead of time,
+// so BEL_ST_CallBack never runs. Changes to how sound is generated go there.
 #if 0
 #include "be_cross.h"
 #include "be_st.h"
@@ -627,10 +633,130 @@ void BE_ST_SetTimer(uint16_t speed, bool isALMusicOn)
 
 #endif
 
-void BEL_ST_TicksDelayWithOffset(int sdltickstowait);
 void BEL_ST_TimeCountWaitByPeriod(int16_t timetowait);
 
 
+// Leave the last couple of milliseconds of a wait to a yielding spin,
+// SDL_Delay() alone often oversleeps by a millisecond or more.
+#define BE_ST_SPIN_MARGIN_MS 2
+
+static uint64_t g_sdlCounterFreq;
+
+static uint64_t BEL_ST_GetSDLCounter(void)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	return SDL_GetPerformanceCounter();
+#else
+	// Only milliseconds here. Widen them, so the wraparound after 49 days does no harm
+	static uint32_t lastSdlTicks = 0;
+	static uint64_t sdlTicks = 0;
+	uint32_t currSdlTicks = SDL_GetTicks();
+	sdlTicks += (uint32_t)(currSdlTicks - lastSdlTicks);
+	lastSdlTicks = currSdlTicks;
+	return sdlTicks;
+#endif
+}
+
+static void BEL_ST_SDLDelay(uint32_t ms)
+{
+	SDL_Delay(ms);
+}
+
+// Where the counter values come from and how waits sleep. SDL's by default,
+// the tests swap in a clock of their own (see BE_ST_SetCounterSource)
+static uint64_t (*g_sdlCounterFunc)(void) = BEL_ST_GetSDLCounter;
+static uint64_t g_sdlCounterFuncFreq = 0; // 0 for the frequency of SDL's counter
+static void (*g_sdlDelayFunc)(uint32_t ms) = BEL_ST_SDLDelay;
+
+static uint64_t BEL_ST_GetCounter(void)
+{
+	return g_sdlCounterFunc();
+}
+
+void BE_ST_SetCounterSource(uint64_t (*counterFunc)(void), uint64_t frequency, void (*delayFunc)(uint32_t ms))
+{
+	g_sdlCounterFunc = counterFunc ? counterFunc : BEL_ST_GetSDLCounter;
+	g_sdlCounterFuncFreq = counterFunc ? frequency : 0;
+	g_sdlDelayFunc = delayFunc ? delayFunc : BEL_ST_SDLDelay;
+	// Values of the old counter mean nothing to the new one, start over
+	g_sdlCounterReady = 0;
+}
+
+static void BEL_ST_InitCounter(void)
+{
+	if (g_sdlCounterReady)
+	{
+		return;
+	}
+	if (g_sdlCounterFuncFreq)
+	{
+		g_sdlCounterFreq = g_sdlCounterFuncFreq;
+	}
+	else
+	{
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+		g_sdlCounterFreq = SDL_GetPerformanceFrequency();
+#else
+		g_sdlCounterFreq = 1000;
+#endif
+	}
+	g_sdlCounterBase = g_sdlLastCounter = BEL_ST_GetCounter();
+	g_sdlTimeCountRemainder = 0;
+	g_sdlCounterReady = 1;
+}
+
+// Counter units one TimeCount tick lasts, times PC_PIT_RATE
+static uint64_t BEL_ST_TickLength(void)
+{
+	return g_sdlCounterFreq * g_sdlScaledTimerDivisor;
+}
+
+static void BEL_ST_UpdateTimeCount(uint64_t currCounter)
+{
+	if (g_sdlScaledTimerDivisor == 0)
+	{
+		// Timer not set up yet, nothing counts
+		g_sdlLastCounter = currCounter;
+		return;
+	}
+	// Only differences of counter values are used, so the fraction
+	// of a tick carries over exactly from one call to the next
+	const uint64_t tickLength = BEL_ST_TickLength();
+	const uint64_t delta = currCounter - g_sdlLastCounter;
+	// Whole seconds are counted apart, so a long pause with a fine
+	// grained counter can't overflow the product with PC_PIT_RATE
+	const uint64_t secondsInPitUnits = (delta / g_sdlCounterFreq) * PC_PIT_RATE;
+	g_sdlTimeCount += (uint32_t)(secondsInPitUnits / g_sdlScaledTimerDivisor);
+	g_sdlTimeCountRemainder += (secondsInPitUnits % g_sdlScaledTimerDivisor) * g_sdlCounterFreq;
+	g_sdlTimeCountRemainder += (delta % g_sdlCounterFreq) * PC_PIT_RATE;
+	g_sdlTimeCount += (uint32_t)(g_sdlTimeCountRemainder / tickLength);
+	g_sdlTimeCountRemainder %= tickLength;
+	g_sdlLastCounter = currCounter;
+}
+
+// Sleeps while the deadline is still far away and spins over the rest of it
+static void BEL_ST_WaitForCounter(uint64_t deadline)
+{
+	for (;;)
+	{
+		uint64_t currCounter = BEL_ST_GetCounter();
+		if ((int64_t)(currCounter - deadline) >= 0)
+		{
+			return;
+		}
+		uint64_t msLeft = (deadline - currCounter) * 1000 / g_sdlCounterFreq;
+		if (msLeft > BE_ST_SPIN_MARGIN_MS)
+		{
+			g_sdlDelayFunc((uint32_t)(msLeft - BE_ST_SPIN_MARGIN_MS));
+		}
+		else
+		{
+			g_sdlDelayFunc(0); // Still give other threads a chance
+		}
+	}
+}
+
+
 
 void BE_ST_SetTimeCount(uint32_t newcount)
 {
@@ -649,32 +775,26 @@ void BE_ST_TimeCountWaitFromSrc(uint32_t srctimecount, int16_t timetowait)
 
 void BEL_ST_TimeCountWaitByPeriod(int16_t timetowait)
 {
-	if (timetowait <= 0)
+	if (timetowait <= 0 || g_sdlScaledTimerDivisor == 0)
 	{
 		return;
 	}
-	// COMMENTED OUT - Do NOT refresh TimeCount and g_sdlLastTicks
+	BEL_ST_InitCounter();
+	// COMMENTED OUT - Do NOT refresh TimeCount and g_sdlLastCounter
 	//BE_ST_GetTimeCount();
 
-	// We want to find the minimal currSdlTicks value (mod 2^32) such that...
-	// ticksToWait <= (uint64_t)currSdlTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor) - (uint64_t)g_sdlLastTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor)
-	// (WARNING: The divisions here are INTEGER divisions!)
-	// i.e.,
-	// ticksToWait + (uint64_t)g_sdlLastTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor) <= (uint64_t)currSdlTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor)
-	// That is, ignoring the types and up to the division by PC_PIT_RATE being an integer:
-	// currSdlTicks >= [ticksToWait + (uint64_t)g_sdlLastTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor)]*1000*g_sdlScaledTimerDivisor / PC_PIT_RATE
-	// So it may seem like we can replace ">=" with "=" and give it a go.
-	//
-	// PROBLEM: The last division IS (or at leat should be) integer. Suppose e.g., the condition is
-	// currSdlTicks >= (PC_PIT_RATE-100) / PC_PIT_RATE
-	// Then we get currSdlTicks = 0, which is not what we want (the minimal integer which is at at least this ratio as a noninteger is 1.)
+	// We want the first counter value at which TimeCount has gone up by timetowait, i.e.
+	// (counter - g_sdlLastCounter) * PC_PIT_RATE + g_sdlTimeCountRemainder >= timetowait * tickLength
 	//
-	// SOLUTION: Add PC_PIC_RATE-1 to the numerator.
-
-	uint32_t nextSdlTicks = ((timetowait + (uint64_t)g_sdlLastTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor))*1000*g_sdlScaledTimerDivisor + (PC_PIT_RATE-1)) / PC_PIT_RATE;
-	// NOTE: nextSdlTicks is already adjusted in terms of offset, so we can simply reset it here
-	g_sdlTicksOffset = 0;
-	BEL_ST_TicksDelayWithOffset(nextSdlTicks-SDL_GetTicks());
+	// timetowait * tickLength may not fit into 64 bits, so it is split into the
+	// quotient and remainder of tickLength / PC_PIT_RATE. Since g_sdlTimeCountRemainder
+	// is less than tickLength, nothing below goes negative.
+	const uint64_t tickLength = BEL_ST_TickLength();
+	const uint64_t wholeTicks = (uint64_t)timetowait - 1;
+	uint64_t countsToWait = wholeTicks * (tickLength / PC_PIT_RATE);
+	countsToWait += (wholeTicks * (tickLength % PC_PIT_RATE) + tickLength - g_sdlTimeCountRemainder + (PC_PIT_RATE-1)) / PC_PIT_RATE;
+
+	BEL_ST_WaitForCounter(g_sdlLastCounter + countsToWait);
 }
 
 
@@ -692,15 +812,15 @@ void BE_ST_WaitVBL(int16_t number)
 	// waiting while NOT in vertical retrace. In practice, we jump
 	// to the very beginning of the next "refresh cycle".
 	// This is repeated for a total of 'length' times.
+	BEL_ST_InitCounter();
 
-	uint32_t currSdlTicks = SDL_GetTicks();
-	uint32_t nextSdlTicks = (int)number*1000000/70086 + currSdlTicks - g_sdlTicksOffset;
-	// First iteration takes a bit less time again, so we want
-	// the value "mod" about 1000/70.086 (VGA adapter);
-	// For the sake of a bit better precision we further multiply by 1000
-	nextSdlTicks -= (((uint64_t)1000*(uint64_t)nextSdlTicks) % ((uint64_t)1000000000/70086))/1000;
-	g_sdlTicksOffset = 0; // Can reset this, taking g_sdlTicksOffset into account above
-	BEL_ST_TicksDelayWithOffset(nextSdlTicks-currSdlTicks);
+	// One refresh of the VGA adapter at about 70.086Hz, in counter units.
+	// Refreshes start at whole multiples of it, counted from g_sdlCounterBase.
+	const double refreshPeriod = (double)g_sdlCounterFreq * 1000.0 / 70086.0;
+	const double elapsed = (double)(BEL_ST_GetCounter() - g_sdlCounterBase);
+	const uint64_t refreshes = (uint64_t)(elapsed / refreshPeriod) + (uint64_t)number;
+
+	BEL_ST_WaitForCounter(g_sdlCounterBase + (uint64_t)(refreshes * refreshPeriod));
 }
 
 
@@ -719,37 +839,11 @@ void BE_ST_ShortSleep(void)
 /*
 void BE_ST_Delay(uint16_t msec) // Replacement for delay from dos.h
 {
-    //BEL_ST_TicksDelayWithOffset(msec);
+    //BEL_ST_WaitForCounter(BEL_ST_GetCounter() + msec * g_sdlCounterFreq / 1000);
 }
 */
 
 
-void BEL_ST_TicksDelayWithOffset(int sdltickstowait)
-{
-	if (sdltickstowait <= (int32_t)g_sdlTicksOffset)
-	{
-		// Already waited for this time earlier, no need to do so now
-		if (sdltickstowait > 0)
-		{
-			g_sdlTicksOffset -= sdltickstowait;
-		}
-        //BE_ST_PollEvents(); // Still safer to do this
-		return;
-	}
-	uint32_t nextSdlTicks = SDL_GetTicks() + sdltickstowait - g_sdlTicksOffset;
-
-    //BE_ST_PollEvents();
-	uint32_t currSdlTicks = SDL_GetTicks();
-	while ((int32_t)(currSdlTicks - nextSdlTicks) < 0)
-	{
-		SDL_Delay(1);
-        //BE_ST_PollEvents();
-		currSdlTicks = SDL_GetTicks();
-	} 
-	g_sdlTicksOffset = (currSdlTicks - nextSdlTicks);
-}
-
-
 // Here, the actual rate is about 1193182Hz/speed
 // NOTE: isALMusicOn is irrelevant for Keen Dreams (even with its music code)
 void BE_ST_SetTimer(uint16_t speed, int isALMusicOn)
@@ -759,21 +853,18 @@ void BE_ST_SetTimer(uint16_t speed, int isALMusicOn)
     // is responsible for incrementing TimeCount at a given rate
     // (~70Hz), although the rate in which the service itself is
     // 560Hz with music on and 140Hz otherwise.
+    BEL_ST_InitCounter();
+    // Ticks which went by so far still count at the old rate
+    BEL_ST_UpdateTimeCount(BEL_ST_GetCounter());
     g_sdlScaledTimerDivisor = isALMusicOn ? (speed*8) : (speed*2);
+    g_sdlTimeCountRemainder = 0;
 }
 
 
 uint32_t BE_ST_GetTimeCount(void)
 {
-    // FIXME: What happens when SDL_GetTicks() reaches the upper bound?
-    // May be challenging to fix... A proper solution should
-    // only work with *differences between SDL_GetTicks values*.
-
-    // WARNING: This must have offset subtracted! (So the game "thinks" it gets the correct (but actually delayed) TimeCount value)
-    uint32_t currOffsettedSdlTicks = SDL_GetTicks() - g_sdlTicksOffset;
-    uint32_t ticksToAdd = (uint64_t)currOffsettedSdlTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor) - (uint64_t)g_sdlLastTicks * (uint64_t)PC_PIT_RATE / (1000*g_sdlScaledTimerDivisor);
-    g_sdlTimeCount += ticksToAdd;
-    g_sdlLastTicks = currOffsettedSdlTicks;
+    BEL_ST_InitCounter();
+    BEL_ST_UpdateTimeCount(BEL_ST_GetCounter());
     return g_sdlTimeCount;
 }
 
@@ -0,0 +1,365 @@
+/*
+ * BinaryTree.cpp
+ *
+ *  Layout:
+ *
+ *  "CGBT"
+ *  varint  version
+ *  varint  flags
+ *  varint  size of the body
+ *  varint  size of the stored body (differs from the above if deflated)
+ *  body
+ *
+ *  Body:
+ *  varint  number of keys, followed by every key as varint size and its characters
+ *  root node
+ *
+ *  Node:
+ *  varint  size of the value and the value itself
+ *  varint  number of children, each one as varint key index followed by the child node
+ */
+
+#include "BinaryTree.h"
+
+#include <base/utils/Base64.h>
+#include <SDL.h>
+#include <zlib.h>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+using boost::property_tree::ptree;
+
+namespace
+{
+
+const char TREE_MAGIC[4] = { 'C', 'G', 'B', 'T' };
+const Uint64 TREE_VERSION = 1;
+
+const Uint64 FLAG_DEFLATED = 1;
+
+// Smaller bodies are stored as they are, deflate wouldn't gain much there
+const size_t DEFLATE_THRESHOLD = 256;
+
+// Savegame trees are only a few levels deep. Deeper ones are taken as damaged data.
+const int MAX_DEPTH = 64;
+
+
+void putVarint(std::vector<Uint8> &out, Uint64 value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(Uint8(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(Uint8(value));
+}
+
+void putString(std::vector<Uint8> &out, const std::string &str)
+{
+    putVarint(out, str.size());
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+
+class TreeWriter
+{
+public:
+
+    void collectKeys(const ptree &node)
+    {
+        for(const auto &child : node)
+        {
+            if(mKeyIndex.find(child.first) == mKeyIndex.end())
+            {
+                mKeyIndex[child.first] = mKeys.size();
+                mKeys.push_back(child.first);
+            }
+
+            collectKeys(child.second);
+        }
+    }
+
+    void writeKeys(std::vector<Uint8> &out) const
+    {
+        putVarint(out, mKeys.size());
+        for(const auto &key : mKeys)
+        {
+            putString(out, key);
+        }
+    }
+
+    void writeNode(std::vector<Uint8> &out, const ptree &node) const
+    {
+        putString(out, node.data());
+        putVarint(out, node.size());
+
+        for(const auto &child : node)
+        {
+            putVarint(out, mKeyIndex.at(child.first));
+            writeNode(out, child.second);
+        }
+    }
+
+private:
+
+    std::vector<std::string> mKeys;
+    std::map<std::string, size_t> mKeyIndex;
+};
+
+
+class TreeReader
+{
+public:
+
+    TreeReader(const Uint8 *data, const size_t size) :
+    mpData(data),
+    mSize(size)
+    {}
+
+    bool getVarint(Uint64 &value)
+    {
+        value = 0;
+
+        for(int shift = 0 ; shift < 64 ; shift += 7)
+        {
+            if(mPos >= mSize)
+                return false;
+
+            const Uint8 byte = mpData[mPos++];
+            value |= Uint64(byte & 0x7F) << shift;
+
+            if(!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    bool getString(std::string &str)
+    {
+        Uint64 len;
+        if(!getVarint(len) || len > mSize - mPos)
+            return false;
+
+        str.assign(reinterpret_cast<const char*>(mpData + mPos), size_t(len));
+        mPos += size_t(len);
+        return true;
+    }
+
+    bool readKeys()
+    {
+        Uint64 numKeys;
+        if(!getVarint(numKeys) || numKeys > mSize - mPos)
+            return false;
+
+        mKeys.resize(size_t(numKeys));
+        for(auto &key : mKeys)
+        {
+            if(!getString(key))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool readNode(ptree &node, const int depth)
+    {
+        if(depth > MAX_DEPTH)
+            return false;
+
+        if(!getString(node.data()))
+            return false;
+
+        Uint64 numChildren;
+        if(!getVarint(numChildren) || numChildren > mSize - mPos)
+            return false;
+
+        for(Uint64 i=0 ; i<numChildren ; i++)
+        {
+            Uint64 keyIdx;
+            if(!getVarint(keyIdx) || keyIdx >= mKeys.size())
+                return false;
+
+            ptree &child = node.push_back(ptree::value_type(mKeys[size_t(keyIdx)], ptree()))->second;
+
+            if(!readNode(child, depth+1))
+                return false;
+        }
+
+        return true;
+    }
+
+    size_t position() const
+    {   return mPos;   }
+
+    bool atEnd() const
+    {   return mPos == mSize;   }
+
+private:
+
+    const Uint8 *mpData;
+    const size_t mSize;
+    size_t mPos = 0;
+
+    std::vector<std::string> mKeys;
+};
+
+}
+
+
+bool isBinaryTree(std::istream &stream)
+{
+    const std::streampos start = stream.tellg();
+
+    char magic[sizeof(TREE_MAGIC)];
+    const bool match = stream.read(magic, sizeof(magic)) &&
+                       memcmp(magic, TREE_MAGIC, sizeof(TREE_MAGIC)) == 0;
+
+    stream.clear();
+    stream.seekg(start);
+    return match;
+}
+
+
+bool writeBinaryTree(std::ostream &stream, const ptree &pt, const bool deflate)
+{
+    TreeWriter writer;
+    writer.collectKeys(pt);
+
+    std::vector<Uint8> body;
+    writer.writeKeys(body);
+    writer.writeNode(body, pt);
+
+    Uint64 flags = 0;
+    std::vector<Uint8> stored;
+
+    if(deflate && body.size() >= DEFLATE_THRESHOLD)
+    {
+        uLongf deflatedSize = compressBound(body.size());
+        stored.resize(deflatedSize);
+
+        if(compress2(stored.data(), &deflatedSize, body.data(), body.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+            return false;
+
+        stored.resize(deflatedSize);
+        flags |= FLAG_DEFLATED;
+    }
+    else
+    {
+        stored.swap(body);
+    }
+
+    std::vector<Uint8> header(TREE_MAGIC, TREE_MAGIC+sizeof(TREE_MAGIC));
+    putVarint(header, TREE_VERSION);
+    putVarint(header, flags);
+    putVarint(header, (flags & FLAG_DEFLATED) ? body.size() : stored.size());
+    putVarint(header, stored.size());
+
+    stream.write(reinterpret_cast<const char*>(header.data()), header.size());
+    stream.write(reinterpret_cast<const char*>(stored.data()), stored.size());
+
+    return bool(stream);
+}
+
+
+bool readBinaryTree(std::istream &stream, ptree &pt)
+{
+    pt.clear();
+
+    const std::vector<char> file( (std::istreambuf_iterator<char>(stream)),
+                                  std::istreambuf_iterator<char>() );
+
+    const Uint8 *data = reinterpret_cast<const Uint8*>(file.data());
+
+    if(file.size() < sizeof(TREE_MAGIC) ||
+       memcmp(data, TREE_MAGIC, sizeof(TREE_MAGIC)) != 0)
+    {
+        return false;
+    }
+
+    TreeReader header(data + sizeof(TREE_MAGIC), file.size() - sizeof(TREE_MAGIC));
+
+    Uint64 version, flags, bodySize, storedSize;
+    // Flags this version doesn't know would mean a layout it can't read
+    if(!header.getVarint(version) || version != TREE_VERSION ||
+       !header.getVarint(flags) || (flags & ~FLAG_DEFLATED) != 0 ||
+       !header.getVarint(bodySize) ||
+       !header.getVarint(storedSize))
+    {
+        return false;
+    }
+
+    const size_t storedStart = sizeof(TREE_MAGIC) + header.position();
+    if(storedSize != file.size() - storedStart)
+        return false;
+
+    const Uint8 *stored = data + storedStart;
+    std::vector<Uint8> inflated;
+
+    if(flags & FLAG_DEFLATED)
+    {
+        // A corrupt size must not make us allocate gigabytes
+        if(bodySize > Uint64(storedSize) * 1032 + 64)
+            return false;
+
+        inflated.resize(size_t(bodySize));
+        uLongf inflatedSize = uLongf(bodySize);
+
+        if(uncompress(inflated.data(), &inflatedSize, stored, uLong(storedSize)) != Z_OK ||
+           inflatedSize != bodySize)
+        {
+            return false;
+        }
+
+        stored = inflated.data();
+    }
+    else if(bodySize != storedSize)
+    {
+        return false;
+    }
+
+    TreeReader body(stored, size_t(bodySize));
+
+    if(!body.readKeys() || !body.readNode(pt, 0) || !body.atEnd())
+    {
+        pt.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+void putRawValue(ptree &node, const void *data, const size_t size)
+{
+    node.data().assign(static_cast<const char*>(data), size);
+    node.put("<xmlattr>.encoding", "raw");
+}
+
+
+bool getRawValue(const ptree &node, const size_t size, std::vector<byte> &data)
+{
+    const std::string &value = node.data();
+
+    // Values of XML savegames are base64 encoded
+    if(node.get<std::string>("<xmlattr>.encoding", "base64") == "raw")
+    {
+        data.assign(value.begin(), value.end());
+    }
+    else
+    {
+        try
+        {
+            data = base64Decode(value);
+        }
+        catch(const std::runtime_error &)
+        {
+            return false;
+        }
+    }
+
+    return data.size() == size;
+}
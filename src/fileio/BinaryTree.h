@@ -0,0 +1,59 @@
+/*
+ * BinaryTree.h
+ *
+ *  Stores a boost property tree in a compact binary form. It is what the
+ *  savegames use instead of XML, the tree itself and so its layout stay the same.
+ *
+ *  The file starts with a small header, followed by a table holding every
+ *  key of the tree once. Nodes refer to their keys by index into that table,
+ *  all numbers are written as varints. The values are copied as they are, so
+ *  a node can hold raw binary data. Once the body gets bigger than a few
+ *  hundred bytes it is deflated.
+ */
+
+#ifndef BINARYTREE_H_
+#define BINARYTREE_H_
+
+#include <boost/property_tree/ptree.hpp>
+#include <base/TypeDefinitions.h>
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief isBinaryTree  Tells whether the stream starts like a binary tree.
+ *                      The position of the stream is restored afterwards.
+ */
+bool isBinaryTree(std::istream &stream);
+
+/**
+ * @brief writeBinaryTree   Writes the whole tree into stream
+ * @param deflate           false keeps the body uncompressed even if it is big.
+ *                          Useful if the result gets compared with other trees.
+ * @return                  false if the tree couldn't be compressed or written
+ */
+bool writeBinaryTree(std::ostream &stream,
+                     const boost::property_tree::ptree &pt,
+                     const bool deflate = true);
+
+/**
+ * @brief readBinaryTree    Reads a tree written by writeBinaryTree() from stream.
+ * @param pt                Receives the tree. It is left empty if the data is damaged.
+ * @return                  true if the tree was read
+ */
+bool readBinaryTree(std::istream &stream, boost::property_tree::ptree &pt);
+
+/**
+ * @brief putRawValue   Stores size bytes of data as the value of node, marked with encoding="raw".
+ *                      Written as XML, such values get base64 encoded (see saveXMLTree()).
+ */
+void putRawValue(boost::property_tree::ptree &node, const void *data, const size_t size);
+
+/**
+ * @brief getRawValue   Reads a value stored by putRawValue(), raw or base64 encoded.
+ * @param size          Number of bytes the value must have
+ * @return              false if the value doesn't decode to exactly size bytes
+ */
+bool getRawValue(const boost::property_tree::ptree &node, const size_t size,
+                 std::vector<byte> &data);
+
+#endif /* BINARYTREE_H_ */
@@ -22,7 +22,8 @@ m_headersize(0),
 m_episode(0),
 m_crc(0),
 m_headerdata(NULL),
-m_rawdata(NULL)
+m_rawdata(NULL),
+mpDictSigMutex(SDL_CreateMutex())
 {
 
 	// Setup support map
@@ -53,6 +54,36 @@ m_rawdata(NULL)
 
 }
 
+CExeFile::~CExeFile()
+{
+	SDL_DestroyMutex(mpDictSigMutex);
+}
+
+
+const std::vector<size_t>& CExeFile::getDictSignatureOffsets() const
+{
+	// Loaders may look up dictionaries from several threads at once
+	SDL_mutexP(mpDictSigMutex);
+
+	if(!mDictSigsValid)
+	{
+		mDictSigOffsets = CHuffman::findDictionarySignatures( mData.data(), m_datasize );
+		mDictSigsValid = true;
+	}
+
+	SDL_mutexV(mpDictSigMutex);
+
+	return mDictSigOffsets;
+}
+
+
+void CExeFile::dataPatched()
+{
+	SDL_mutexP(mpDictSigMutex);
+	mDictSigsValid = false;
+	SDL_mutexV(mpDictSigMutex);
+}
+
 
 unsigned long CExeFile::fetchUncompressedHeaderSize(void *m_headerdata)
 {
@@ -198,6 +229,8 @@ bool CExeFile::readData(const unsigned int episode,
 
 	m_crc = getcrc32( mData.data(), m_datasize );
 
+	dataPatched();
+
 	gLogging.ftextOut( "EXE processed with size of %d and crc of %X\n", m_datasize, m_crc );
 
 	return true;
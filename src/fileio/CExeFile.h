@@ -26,6 +26,7 @@
 class CExeFile {
   public:
     CExeFile();
+    ~CExeFile();
     
     char getEpisode() const
     { return m_episode;	}
@@ -80,6 +81,19 @@ class CExeFile {
     byte* getDSegPtr() const
     {	return m_data_segment; }
 
+    /**
+     * @brief getDictSignatureOffsets   Offsets relative to the header data of all Huffman dictionary
+     *                                  signatures. Collected in one sweep on the first lookup
+     *                                  after the exe was read or patched.
+     */
+    const std::vector<size_t>& getDictSignatureOffsets() const;
+
+    /**
+     * @brief dataPatched   Has to be called when the data in memory was modified,
+     *                      so the dictionary signatures get collected again.
+     */
+    void dataPatched();
+
     bool loadMusicTrack(RingBuffer<IMFChunkType> &imfData, const int track) const;
 
     bool isPythonScript() const
@@ -136,6 +150,11 @@ private:
 	void *m_headerdata;
 	byte *m_rawdata;
 	byte *m_data_segment;
+
+	mutable std::vector<size_t> mDictSigOffsets;
+	mutable bool mDictSigsValid = false;
+	SDL_mutex *mpDictSigMutex;
+
 	std::string m_filename;
 
 	std::map< size_t, std::map<int , bool> > m_supportmap;
@@ -21,6 +21,7 @@
 
 
 CPatcher::CPatcher(CExeFile &ExeFile, const std::string &patchFname) :
+mExeFile(ExeFile),
 mPatchFname(patchFname)
 {
 	m_episode = ExeFile.getEpisode();
@@ -166,6 +167,7 @@ void CPatcher::process()
 					{
 						// In this case we have a number
 						memcpy(m_data+offset, &number, width);
+						mExeFile.dataPatched();
 						offset+=width;
 					}
 					else if(readPatchString(textline, patchtext))
@@ -179,6 +181,7 @@ void CPatcher::process()
 						}
 
 						memcpy( m_data+offset, patchtext.c_str(), textsize);
+						mExeFile.dataPatched();
 						offset += textsize;
 					}
 				}
@@ -313,6 +316,7 @@ bool CPatcher::patchMemfromFile(const std::string& patch_file_name, long offset)
 	}
 
 	buf_to_patch = m_data + offset;
+	mExeFile.dataPatched();
 
 	long counter = 0;
     while(!patchfile.eof())
@@ -354,6 +358,7 @@ void CPatcher::PatchLevelhint(const int level, std::list<std::string> &input)
 	}
 
 	p_patch = m_data + offset;
+	mExeFile.dataPatched();
 
 	// Fill everything with zeros, so the old text won't be shown
 	if(end > offset)
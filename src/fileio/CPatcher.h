@@ -45,6 +45,7 @@ private:
 
     bool loadPatchfile(const std::string &patchFname);
 
+	CExeFile &mExeFile;
 	int m_episode;
 	int m_version;
 	unsigned char *m_data;
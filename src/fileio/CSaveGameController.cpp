@@ -8,13 +8,20 @@
  */
 
 #include <base/utils/FindFile.h>
+#include <base/utils/ThreadPool.h>
 #include "CSaveGameController.h"
+#include "BinaryTree.h"
 #include "engine/core/CBehaviorEngine.h"
 
 #include <ctime>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include <zlib.h>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/version.hpp>
+#include <base/utils/Base64.h>
 
 #include "fileio/KeenFiles.h"
 
@@ -36,6 +43,13 @@ m_offset(0)
 	setEpisode(gBehaviorEngine.getEpisode());
 }
 
+CSaveGameController::~CSaveGameController()
+{
+	// Without the pool the writer has already been waited for
+	if(threadPool)
+		finishPendingSave();
+}
+
 void CSaveGameController::setGameDirectory(const std::string& game_directory)
 {
 	m_savedir = JoinPaths("save", game_directory);
@@ -116,6 +130,9 @@ bool CSaveGameController::readSlotList(std::vector<std::string> &list)
     if(!list.empty())
         list.clear();
 
+    // A savegame still being written would be missing or incomplete
+    finishPendingSave();
+
     //Get the list of ".ck?" and ".cx?" files
 	StateFileListFiller sfilelist;
     gLogging.ftextOut("Reading savegames from \"%s\"", m_savedir.c_str());
@@ -518,7 +535,7 @@ std::string CSaveGameController::getSlotName(const std::string &filename)
     // Check Savegame version
     version = StateFile.get();
 
-    if(version != SAVEGAMEVERSION)
+    if(version != SAVEGAMEVERSION && version != OLDSAVEGAMEVERSION6)
     {
         SlotName = "- File Incompatible -";
     }
@@ -547,7 +564,7 @@ std::string CSaveGameController::getSlotNameXML(const std::string &filename)
 
     m_stateXMLfilename = filename;
 
-    if(!gSaveGameController.loadXMLTree(pt))
+    if(!gSaveGameController.loadTree(pt))
         return "";
 
     /// Load the nodes and retrieve the data as needed
@@ -561,6 +578,7 @@ std::string CSaveGameController::getSlotNameXML(const std::string &filename)
  */
 bool CSaveGameController::Fileexists( int SaveSlot )
 {
+	finishPendingSave();
 	std::string filename = m_savedir + "/cksave"+itoa(SaveSlot)+".ck"+itoa(m_Episode);
 	return IsFileAvailable(filename);
 }
@@ -603,6 +621,9 @@ bool CSaveGameController::prepareLoadGame(int SaveSlot)
 
 bool CSaveGameController::load()
 {
+	// The slot might just have been saved
+	finishPendingSave();
+
 	Uint32 size;
 	std::ifstream StateFile;
 	std::string fullpath = GetFullFileName(m_statefilename);
@@ -615,21 +636,35 @@ bool CSaveGameController::load()
     }
 
     // Skip the header as we already chose the game
-    StateFile.get(); // Skip the version info
+    const char version = StateFile.get();
     size = StateFile.get(); // get the size of the slotname and...
-    for(Uint32 i=0 ; i<size ; i++)	// skip that name string
+    StateFile.ignore(size); // skip that name string
+
+    if(version == SAVEGAMEVERSION)
     {
-    	StateFile.get();
-    }
+        // The data block is deflated, its original size comes first
+        const Uint32 datasize = getDataSize(StateFile);
+        const std::vector<char> compressed( (std::istreambuf_iterator<char>(StateFile)),
+                                            std::istreambuf_iterator<char>() );
 
-    while(!StateFile.eof())
-    {   // read it everything in
-    	m_datablock.push_back(StateFile.get());
-    }
+        m_datablock.resize(datasize);
+        uLongf uncompressedSize = datasize;
 
-	// TODO: Decompression has still to be done!
+        if( uncompress(m_datablock.data(), &uncompressedSize,
+                       reinterpret_cast<const Bytef*>(compressed.data()), compressed.size()) != Z_OK ||
+            uncompressedSize != datasize )
+        {
+            gLogging.textOut("Error loading \"" + fullpath + "\". The file seems to be damaged.\n" );
+            m_datablock.clear();
+            return false;
+        }
+    }
+    else
+    {   // Older savegames have the data block stored as it is
+        m_datablock.assign( std::istreambuf_iterator<char>(StateFile),
+                            std::istreambuf_iterator<char>() );
+    }
 
-	// Now write all the data to the file
 	StateFile.close();
 
 	// Done!
@@ -644,6 +679,8 @@ bool CSaveGameController::load()
 // This function checks if the file we want to read or save already exists
 bool CSaveGameController::alreadyExits()
 {
+	finishPendingSave();
+
 	std::ifstream StateFile;
 	std::string fullpath = GetFullFileName(m_statefilename);
 	OpenGameFileR( StateFile, m_statefilename, std::ofstream::binary );
@@ -658,64 +695,257 @@ bool CSaveGameController::alreadyExits()
 }
 
 
-bool CSaveGameController::save()
+namespace
 {
-	std::ofstream StateFile;
-	std::string fullpath = GetFullFileName(m_statefilename);
-	bool open = OpenGameFileW( StateFile, m_statefilename, std::ofstream::binary );
 
-    if (!open)
-    {
-    	gLogging.textOut("Error saving \"" + fullpath + "\". Please check the status of that path.\n" );
-    	return false;
-    }
+enum SaveGameWriteStatus
+{
+	SAVE_OK = 0,
+	SAVE_COMPRESS_FAILED,
+	SAVE_WRITE_FAILED,
+	SAVE_RENAME_FAILED
+};
+
+// Writes everything under a temporary name first,
+// so an interrupted save never destroys the previous one
+int writeFileReplacing(const std::string &fullpath, const void *data, const size_t size)
+{
+	const std::string tempPath = fullpath + ".tmp";
+
+	{
+		std::ofstream StateFile(tempPath.c_str(), std::ios::binary);
+		if(!StateFile.write(static_cast<const char*>(data), size))
+			return SAVE_WRITE_FAILED;
+
+		StateFile.flush();
+		if(!StateFile)
+			return SAVE_WRITE_FAILED;
+	}
+
+#ifdef WIN32
+	// rename does not replace existing files there
+	remove(fullpath.c_str());
+#endif
+
+	if(rename(tempPath.c_str(), fullpath.c_str()) != 0)
+		return SAVE_RENAME_FAILED;
+
+	return SAVE_OK;
+}
 
-	// Convert everything to a primitive data structure
-	// First pass the header, which is only version,
-	// sizeofname and name of slot itself
-	Uint32 offset = 0;
-	Uint32 size = sizeof(SAVEGAMEVERSION)
-				+ sizeof(char)
-				+ m_statename.size()*sizeof(char);
+// Compresses a finished data block and writes it out, away from the game thread.
+// Nothing in here may log, gLogging is only used by the game thread.
+struct SaveGameWriter : public Action
+{
+	SaveGameWriter(const std::string &fullpath,
+				   const std::string &statename,
+				   std::vector<byte> &&datablock) :
+	mFullpath(fullpath),
+	mStatename(statename),
+	mDatablock(std::move(datablock))
+	{}
+
+	int handle()
+	{
+		// Header: version, size of the slot name, the name itself
+		// and the size of the data block before compression
+		std::vector<Bytef> buffer;
+		buffer.push_back(SAVEGAMEVERSION);
+		buffer.push_back(static_cast<Bytef>(mStatename.size()));
+		buffer.insert(buffer.end(), mStatename.begin(), mStatename.end());
+
+		const Uint32 datasize = mDatablock.size();
+		for(Uint32 i=0 ; i<sizeof(Uint32) ; i++)
+			buffer.push_back( static_cast<Bytef>(datasize >> (i*8)) );
 
-	size += m_datablock.size();
-	// Headersize + Datablock size
-	std::vector<char> primitive_buffer(size);
+		const size_t headersize = buffer.size();
+		uLongf compressedSize = compressBound(datasize);
+		buffer.resize(headersize + compressedSize);
 
-	// Write the header
-	primitive_buffer[offset++] = SAVEGAMEVERSION;
-	primitive_buffer[offset++] = m_statename.size();
+		if( compress2(buffer.data()+headersize, &compressedSize,
+					  mDatablock.data(), datasize, Z_DEFAULT_COMPRESSION) != Z_OK )
+			return SAVE_COMPRESS_FAILED;
 
-	for( Uint32 i=0; i<m_statename.size() ; i++ )
+		buffer.resize(headersize + compressedSize);
+
+		return writeFileReplacing(mFullpath, buffer.data(), buffer.size());
+	}
+
+	const std::string mFullpath;
+	const std::string mStatename;
+	std::vector<byte> mDatablock;
+};
+
+// Writes an already serialised savegame, like the binary property trees of Galaxy
+struct SaveFileWriter : public Action
+{
+	SaveFileWriter(const std::string &fullpath,
+				   std::string &&data) :
+	mFullpath(fullpath),
+	mData(std::move(data))
+	{}
+
+	int handle()
 	{
-		primitive_buffer[offset++] = m_statename[i];
+		return writeFileReplacing(mFullpath, mData.data(), mData.size());
 	}
 
-	// Write the collected data block
-	std::vector<byte>::iterator pos = m_datablock.begin();
-	for( size_t i=0; i<m_datablock.size() ; i++ )
+	const std::string mFullpath;
+	const std::string mData;
+};
+
+bool reportSaveStatus(const int status, const std::string &fullpath)
+{
+	switch(status)
 	{
-		primitive_buffer[offset++] = *pos;
-		pos++;
+	case SAVE_OK:
+		gLogging.textOut("File \""+ fullpath +"\" was successfully saved.\n");
+		return true;
+	case SAVE_COMPRESS_FAILED:
+		gLogging.textOut("Error saving \"" + fullpath + "\". The data could not be compressed.\n" );
+		return false;
+	case SAVE_RENAME_FAILED:
+		gLogging.textOut("Error saving \"" + fullpath + "\". The finished savegame could not replace the old one, it was left with a .tmp ending.\n" );
+		return false;
+	default:
+		gLogging.textOut("Error saving \"" + fullpath + "\". Please check the status of that path.\n" );
+		return false;
 	}
+}
+
+}
 
-	// TODO: Compression has still to be done!
 
-	// Now write all the data to the file
-    StateFile.write( &primitive_buffer[0], size );
-	StateFile.close();
+bool CSaveGameController::save()
+{
+	// Only one savegame is written at a time
+	finishPendingSave();
 
+	const std::string fullpath = GetWriteFullFileName(m_statefilename, true);
+
+	// The data block is moved over, so the game thread doesn't copy anything here
+	SaveGameWriter *writer = new SaveGameWriter(fullpath, m_statename, std::move(m_datablock));
 	m_datablock.clear();
 
-	// Done!
-	gLogging.textOut("File \""+ fullpath +"\" was successfully saved. Size: "+itoa(size)+"\n");
 	m_statefilename.clear();
 	m_statename.clear();
 
+	return startSaveWriter(writer, fullpath);
+}
+
+
+bool CSaveGameController::startSaveWriter(Action *writer, const std::string &fullpath)
+{
+	mPendingSavePath = fullpath;
+
+	if(!threadPool)
+	{
+		const int status = writer->handle();
+		delete writer;
+		return reportSaveStatus(status, mPendingSavePath);
+	}
+
+	mpSaveWriter = threadPool->start(writer, "Savegame writer");
+
+	if(!mpSaveWriter)
+	{
+		delete writer;
+		gLogging.textOut("Error saving \"" + mPendingSavePath + "\". The savegame could not be handed over for writing.\n" );
+		return false;
+	}
+
 	return true;
 }
 
 
+bool CSaveGameController::finishPendingSave()
+{
+	if(!mpSaveWriter)
+		return true;
+
+	int status = SAVE_WRITE_FAILED;
+	threadPool->wait(mpSaveWriter, &status);
+	mpSaveWriter = nullptr;
+
+	return reportSaveStatus(status, mPendingSavePath);
+}
+
+
+
+bool CSaveGameController::saveTree(boost::property_tree::ptree &pt)
+{
+    // Only one savegame is written at a time
+    finishPendingSave();
+
+    // The savegame internal name
+    pt.put("GameState.<xmlattr>.name", m_statename);
+
+    const std::string fullpath = GetWriteFullFileName(m_stateXMLfilename, true);
+
+    // The tree is serialised right here, only the file is written by the writer thread
+    std::ostringstream stream(std::ios::binary);
+
+    if (!writeBinaryTree( stream, pt ))
+    {
+        gLogging.textOut("Error saving \"" + fullpath + "\". The savegame could not be serialised.\n" );
+        return false;
+    }
+
+    return startSaveWriter(new SaveFileWriter(fullpath, stream.str()), fullpath);
+}
+
+
+bool CSaveGameController::loadTree(boost::property_tree::ptree &pt)
+{
+    // The slot might just have been saved
+    finishPendingSave();
+
+    std::ifstream StateFile;
+    bool open = OpenGameFileR( StateFile, m_stateXMLfilename, std::ofstream::binary );
+
+    if (!open)
+        return false;
+
+    if (isBinaryTree(StateFile))
+    {
+        if(readBinaryTree( StateFile, pt ))
+            return true;
+
+        std::string fullpath = GetFullFileName(m_stateXMLfilename);
+        gLogging.textOut("Error loading \"" + fullpath + "\". The file seems to be damaged.\n" );
+        return false;
+    }
+
+    // Savegames of older versions are XML files
+    read_xml( StateFile, pt );
+
+    return true;
+}
+
+
+namespace
+{
+
+// XML can't hold binary data. Values marked as raw are base64 encoded therefore.
+void encodeRawValues(boost::property_tree::ptree &node)
+{
+    for(auto &child : node)
+    {
+        auto &value = child.second;
+
+        if(value.get<std::string>("<xmlattr>.encoding", "") == "raw")
+        {
+            std::string &data = value.data();
+            data = base64Encode(reinterpret_cast<BYTE*>(&data[0]), data.size());
+            value.put("<xmlattr>.encoding", "base64");
+        }
+
+        encodeRawValues(value);
+    }
+}
+
+}
+
 
 bool CSaveGameController::saveXMLTree(boost::property_tree::ptree &pt)
 {
@@ -727,9 +957,14 @@ bool CSaveGameController::saveXMLTree(boost::property_tree::ptree &pt)
     boost::property_tree::xml_writer_settings<char> settings('\t', 1);
 #endif
 
+    // Only one savegame is written at a time
+    finishPendingSave();
+
     // The savegame internal name
     pt.put("GameState.<xmlattr>.name", m_statename);
 
+    encodeRawValues(pt);
+
     std::ofstream StateFile;
     bool open = OpenGameFileW( StateFile, m_stateXMLfilename, std::ofstream::binary );
 
@@ -748,6 +983,9 @@ bool CSaveGameController::saveXMLTree(boost::property_tree::ptree &pt)
 
 bool CSaveGameController::loadXMLTree(boost::property_tree::ptree &pt)
 {
+    // The slot might just have been saved
+    finishPendingSave();
+
     // load the xml-file
     using boost::property_tree::ptree;
 
@@ -769,6 +1007,8 @@ bool CSaveGameController::loadXMLTree(boost::property_tree::ptree &pt)
 // Adds data of size to the main data block
 void CSaveGameController::addData(byte *data, Uint32 size)
 {
+	m_datablock.reserve(m_datablock.size() + sizeof(Uint32) + size);
+
 	for(Uint32 i=0 ; i<sizeof(Uint32) ; i++ )
 	{
 		Uint32 datasize;
@@ -776,8 +1016,8 @@ void CSaveGameController::addData(byte *data, Uint32 size)
 		datasize >>= (i*8);
 		m_datablock.push_back( static_cast<byte>(datasize) );
 	}
-	for(Uint32 i=0 ; i<size ; i++ )
-		m_datablock.push_back(data[i]);
+
+	m_datablock.insert(m_datablock.end(), data, data+size);
 }
 
 // Read data of size from the main data block
@@ -23,13 +23,16 @@
 
 
 #define SG_HEADERSIZE			7
-#define SAVEGAMEVERSION 		'6'
+#define SAVEGAMEVERSION 		'7'
+#define OLDSAVEGAMEVERSION6		'6'
 #define OLDSAVEGAMEVERSION5		'5'
 #define OLDSAVEGAMEVERSION4		'4'
 
 
 #define gSaveGameController CSaveGameController::get()
 
+struct ThreadPoolItem;
+struct Action;
 
 class CSaveGameController : public GsSingleton<CSaveGameController>
 {
@@ -37,6 +40,7 @@ public:
 
 	// Initialization
 	CSaveGameController();
+	~CSaveGameController();
 
 	// Setters
 	void setGameDirectory(const std::string& game_directory);
@@ -59,6 +63,23 @@ public:
 	bool prepareSaveGame( int SaveSlot, const std::string &Name);
 	bool prepareLoadGame( int SaveSlot );
 
+    /**
+     * @brief saveTree  Writes the tree as a binary savegame (see BinaryTree.h).
+     *                  Like save(), the file is written by the writer thread
+     *                  and replaces the old savegame once it is complete.
+     */
+    bool saveTree(boost::property_tree::ptree &pt);
+
+    /**
+     * @brief loadTree  Reads a savegame written by saveTree() or saveXMLTree(),
+     *                  the format is told by the file itself.
+     */
+    bool loadTree(boost::property_tree::ptree &pt);
+
+    /**
+     * @brief saveXMLTree   Writes the tree as XML, which is handy for looking into a savegame.
+     *                      Values marked as raw are base64 encoded in pt for that.
+     */
     bool saveXMLTree(boost::property_tree::ptree &pt);
     bool loadXMLTree(boost::property_tree::ptree &pt);
 
@@ -76,12 +97,21 @@ public:
 	bool readDataBlock(byte *data);
 
     /**
-     * @brief save  This function writes all the data from the CPlayGame and CMenu Instances to a file,
-     *              closes it and flushes the data block.
-     * @return
+     * @brief save  This function hands all the data from the CPlayGame and CMenu Instances
+     *              over to a writer thread and flushes the data block.
+     *              That thread compresses it and writes it to a temporary file,
+     *              which replaces the savegame once it is complete.
+     * @return      false if the data could not be handed over
      */
 	bool save();
 
+    /**
+     * @brief finishPendingSave Waits until the savegame given to the writer thread is on disk
+     *                          and logs how that went. Returns at once if nothing is pending.
+     * @return                  false if that write failed
+     */
+	bool finishPendingSave();
+
 
 	bool load();
 	bool alreadyExits();
@@ -100,6 +130,9 @@ private:
 	bool IsOldSGVersion4(const std::string& fname);
 	int getOldSGVersion(const std::string& fname);
 
+	// Hands writer over to the writer thread, or runs it here without a thread pool
+	bool startSaveWriter(Action *writer, const std::string &fullpath);
+
 	std::string m_savedir;
     std::string m_statefilename;
     std::string m_stateXMLfilename;
@@ -109,6 +142,9 @@ private:
 	Uint32 m_offset;	
 
 	std::vector<byte> m_datablock;
+
+	ThreadPoolItem *mpSaveWriter = nullptr;
+	std::string mPendingSavePath;
 };
 
 
@@ -21,17 +21,12 @@
 template <class S>
 void CSaveGameController::encodeData(S structure)
 {
-	size_t size = sizeof(S);
-	byte sizebuf[sizeof(size_t)];
-	byte databuf[size];
+	const size_t size = sizeof(S);
+	const byte *sizebuf = reinterpret_cast<const byte*>(&size);
+	const byte *databuf = reinterpret_cast<const byte*>(&structure);
 
-	memcpy(sizebuf, &size, sizeof(size_t));
-	for( Uint32 i=0 ; i<sizeof(size_t) ; i++ )
-		m_datablock.push_back( sizebuf[i] );
-
-	memcpy(databuf, &structure, size);
-	for( Uint32 i=0 ; i<size ; i++ )
-		m_datablock.push_back( databuf[i] );
+	m_datablock.insert( m_datablock.end(), sizebuf, sizebuf+sizeof(size_t) );
+	m_datablock.insert( m_datablock.end(), databuf, databuf+size );
 }
 
 template <class S>
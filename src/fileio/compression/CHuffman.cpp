@@ -8,41 +8,71 @@
 #include "CHuffman.h"
 #include <base/utils/FindFile.h>
 #include <fstream>
+#include <cstring>
 
 const unsigned int DICT_SIG_BYTES = 6;
 const uint8_t DICTSIG[DICT_SIG_BYTES] = { 0xFD, 0x01, 0x00, 0x00, 0x00, 0x00 };
 
+std::vector<size_t> CHuffman::findDictionarySignatures(const byte *data, const size_t len)
+{
+    std::vector<size_t> offsets;
+
+    if(len < DICT_SIG_BYTES)
+        return offsets;
+
+    const byte *cur = data;
+    const byte *last = data + len - DICT_SIG_BYTES;
+
+    // memchr skips quickly to the candidates, only those get compared completely
+    while(cur <= last)
+    {
+        const void *hit = memchr(cur, DICTSIG[0], size_t(last - cur) + 1);
+        if(!hit)
+            break;
+
+        cur = static_cast<const byte*>(hit);
+        if( memcmp(cur, DICTSIG, DICT_SIG_BYTES) == 0 )
+            offsets.push_back(size_t(cur - data));
+        cur++;
+    }
+
+    return offsets;
+}
+
 bool CHuffman::readDictionaryNumber( const CExeFile& ExeFile,
                                      const int dictnum,
                                      const unsigned int dictOffset )
 {
     uint8_t dictnumleft = dictnum;
+    const Uint32 size = DICT_SIZE*sizeof(nodestruct);
 
     if( dictOffset == 0) // don't seek to offset
     {
-        uint8_t *data_ptr = ExeFile.getRawData();
+        const uint8_t *headerdata = static_cast<uint8_t*>(ExeFile.getHeaderData());
+        const size_t rawStart = size_t(ExeFile.getRawData() - headerdata);
 
-        for( Uint32 i=0; i<ExeFile.getExeDataSize() ; i++ )
+        // Signatures are indexed relative to the header, only those past it count here
+        for( const size_t offset : ExeFile.getDictSignatureOffsets() )
         {
-            if( memcmp(data_ptr, DICTSIG, DICT_SIG_BYTES) == 0 )
+            if(offset < rawStart)
+                continue;
+
+            if(dictnumleft == 0)
             {
-                if(dictnumleft == 0)
-                {
-                    uint8_t *dictdata = data_ptr-(DICT_SIZE*sizeof(nodestruct))+DICT_SIG_BYTES;
-                    const Uint32 size = DICT_SIZE*sizeof(nodestruct);
-                    memcpy(m_nodes, dictdata, size);
-                    return true;
-                }
-                dictnumleft--;
+                if(offset + DICT_SIG_BYTES < size)
+                    return false;
+
+                memcpy(m_nodes, headerdata+offset+DICT_SIG_BYTES-size, size);
+                return true;
             }
-            data_ptr++;
+            dictnumleft--;
         }
         return false;
     }
     else // Otherwise copy the dictionary normally
     {
         uint8_t *dictdata = (byte*)(ExeFile.getHeaderData())+dictOffset;
-        memcpy(reinterpret_cast<char*>(m_nodes), dictdata, DICT_SIZE*sizeof(nodestruct));
+        memcpy(reinterpret_cast<char*>(m_nodes), dictdata, size);
         return true;
     }
 }
@@ -52,26 +82,27 @@ bool CHuffman::readDictionaryNumber( const CExeFile& ExeFile,
 
 bool CHuffman::readDictionaryNumberfromEnd(const CExeFile& ExeFile)
 {        
-    const uint32_t bytesToCheck = ExeFile.getExeDataSize()-DICT_SIG_BYTES;
-
-    uint8_t *data_ptr = static_cast<uint8_t*>(ExeFile.getHeaderData())+bytesToCheck;
+    const size_t bytesToCheck = ExeFile.getExeDataSize()-DICT_SIG_BYTES;
+    const uint8_t *headerdata = static_cast<uint8_t*>(ExeFile.getHeaderData());
+    const std::vector<size_t> &offsets = ExeFile.getDictSignatureOffsets();
 
-    for( Uint32 i=0; i<bytesToCheck ; i++ )
+    // Last signature wins, which is the first one a backwards scan would find
+    for( auto it = offsets.rbegin() ; it != offsets.rend() ; it++ )
     {
-        data_ptr--;
-        if( memcmp(data_ptr, DICTSIG, DICT_SIG_BYTES) == 0 )
-        {
-       		uint8_t *dictdata = data_ptr-(DICT_SIZE*sizeof(nodestruct))+DICT_SIG_BYTES;
-       		const Uint32 size = DICT_SIZE*sizeof(nodestruct);
-       		memcpy(m_nodes, dictdata, size);
+        const size_t offset = *it;
+        if(offset >= bytesToCheck)
+            continue;
 
-            //dumpToExternalFile("dump.huffmann");
+        const Uint32 size = DICT_SIZE*sizeof(nodestruct);
+        if(offset + DICT_SIG_BYTES < size)
+            return false;
 
-       		return true;
-        }
-    }
+        memcpy(m_nodes, headerdata+offset+DICT_SIG_BYTES-size, size);
 
+        //dumpToExternalFile("dump.huffmann");
 
+        return true;
+    }
 
     return false;
 }
@@ -85,9 +116,8 @@ bool CHuffman::readDictionaryFromFile( const std::string &filename )
 		return false;
 	}
 
-	file.read(reinterpret_cast<char*>(m_nodes), DICT_SIZE*sizeof(nodestruct));
-
-	return true;
+	// A short file leaves part of the nodes unset, which doesn't count as read
+	return bool(file.read(reinterpret_cast<char*>(m_nodes), DICT_SIZE*sizeof(nodestruct)));
 }
 
 
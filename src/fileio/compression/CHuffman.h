@@ -15,6 +15,7 @@
 #include <base/TypeDefinitions.h>
 #include "fileio/CExeFile.h"
 #include <string>
+#include <vector>
 
 #define DICT_SIZE       256
 
@@ -30,6 +31,14 @@ struct compstruct{
 class CHuffman
 {
 public:
+    /**
+     * @brief findDictionarySignatures  Sweeps once over the given image and collects the offsets
+     *                                  of every Huffman dictionary signature in ascending order.
+     *                                  CExeFile keeps the result, so the dictionaries can be
+     *                                  located later without scanning the image again.
+     */
+    static std::vector<size_t> findDictionarySignatures(const byte *data, const size_t len);
+
     bool readDictionaryNumber(const CExeFile& ExeFile,
                               const int dictnum ,
                               const unsigned int dictOffset);
@@ -38,6 +47,12 @@ public:
 	void readDictionaryAt( byte *p_exedata, unsigned long offset);
     void expand(byte *pin, byte *pout, const unsigned long inlen, const unsigned long outlen);
 
+    /**
+     * @brief getDictionary Nodes of the dictionary read before, DICT_SIZE of them
+     */
+    const nodestruct *getDictionary() const
+    {   return m_nodes;   }
+
 private:
 
 	nodestruct m_nodes[DICT_SIZE];
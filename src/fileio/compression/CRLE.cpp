@@ -51,7 +51,7 @@ void CRLE::expandSwapped( std::vector<word>& dst, std::vector<byte>& src, word k
 
 	finsize = (src.at(1)<<8) | src.at(0);
 	finsize /= 2;
-
+	dst.reserve(finsize);
 
     for(std::size_t i=WORDSIZE ; dst.size() < finsize ; i+=inc)
     {
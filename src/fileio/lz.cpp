@@ -2,8 +2,10 @@
  This file contains the functions which decompress the graphics
  data from Keen 1.
  */
+#include "lz.h"
 #include <base/GsLogging.h>
-#include <cstdio>
+#include <cstring>
+#include <vector>
 
 #define LZ_STARTBITS        9
 #define LZ_ERRORCODE        256
@@ -12,7 +14,8 @@
 
 #define LZ_MAXSTRINGSIZE    72
 
-unsigned char *lz_outbuffer;
+// Keen uses 12 bit codes. Anything much wider means the file is broken.
+#define LZ_MAXCODEBITS      16
 
 typedef struct stLZDictionaryEntry
 {
@@ -20,166 +23,186 @@ typedef struct stLZDictionaryEntry
 	unsigned char string[LZ_MAXSTRINGSIZE];
 } stLZDictionaryEntry;
 
-stLZDictionaryEntry **lzdict;
 
-// reads a word of length numbits from file lzfile.
-unsigned int lz_readbits(FILE *lzfile, unsigned char numbits, unsigned char reset)
+namespace
 {
-	static int mask, byte;
-	unsigned char bitsread;
-	unsigned int dat;
-	/*unsigned int posit, mult*/;
-	
-	if (reset)
+
+// Reads codes MSB first out of the compressed data, which is completely in memory.
+// Reading past the end yields set bits, same as the former fgetc() based reader did with EOF.
+class LZBitReader
+{
+public:
+	LZBitReader(const std::vector<unsigned char> &data) :
+	mData(data.data()),
+	mEnd(data.data() + data.size())
+	{}
+
+	unsigned int read(const unsigned int numbits)
 	{
-		mask = 0;
-		byte = 0;
-		return 0;
+		while(mNumBits < numbits)
+		{
+			unsigned int byte = 0xFF;
+			if(mData < mEnd)
+				byte = *mData++;
+			else
+				mPadded++;
+			mBits = (mBits << 8) | byte;
+			mNumBits += 8;
+		}
+
+		mNumBits -= numbits;
+		return (mBits >> mNumBits) & ((1u << numbits) - 1);
 	}
-	
-	bitsread = 0;
-	dat = 0;
-	do
-	{
-        if (!mask)
-        {
-			byte = fgetc(lzfile);
-			mask = 0x80;
-        }
-		
-        if (byte & mask)
-        {
-			dat |= 1 << ((numbits - bitsread) - 1);
-        }
-		
-        mask >>= 1;
-        bitsread++;
-	} while(bitsread<numbits);
-	
-	return dat;
-}
 
-// writes dictionary entry 'entry' to the output buffer
-void lz_outputdict(int entry)
-{
-	int i;
-	
-	for(i=0;i<lzdict[entry]->stringlen;i++)
+	// True once a whole code came out of the padding. A stream cut off before its
+	// EOF code would otherwise spin forever.
+	bool exhausted() const
 	{
-		*lz_outbuffer = lzdict[entry]->string[i];
-		lz_outbuffer++;
+		return mPadded*8 > mNumBits + LZ_MAXCODEBITS;
 	}
+
+private:
+	const unsigned char *mData;
+	const unsigned char *mEnd;
+	unsigned int mBits = 0;
+	unsigned int mNumBits = 0;
+	unsigned int mPadded = 0;
+};
+
 }
 
+
 // decompresses LZ data from open file lzfile into buffer outbuffer
 // returns nonzero if an error occurs
-char lz_decompress(FILE *lzfile, unsigned char *outbuffer)
+char lz_decompress(FILE *lzfile, unsigned char *outbuffer, const size_t outlen)
 {
-	unsigned int i;
-	unsigned int numbits;
-	unsigned int decsize;
-	unsigned short maxdictcodewords;
-	unsigned int maxdictsize;
-	unsigned int dictindex, maxdictindex;
-	unsigned int lzcode,lzcode_save,lastcode;
-	char addtodict;
-	
-	// Get the decompressed file-size
-	decsize = fgetc(lzfile);
-	decsize += fgetc(lzfile) << 8;
-	decsize += fgetc(lzfile) << 16;
-	decsize += fgetc(lzfile) << 24;
-	
+	// Pull the rest of the file into memory with one read
+	const long start = ftell(lzfile);
+	fseek(lzfile, 0, SEEK_END);
+	const long end = ftell(lzfile);
+	fseek(lzfile, start, SEEK_SET);
+
+	if(start < 0 || end < start + 6)
+	{
+		gLogging.textOut("lz_decompress(): compressed data is too short!<br>");
+		return 1;
+	}
+
+	std::vector<unsigned char> compdata(size_t(end - start));
+	compdata.resize(fread(compdata.data(), 1, compdata.size(), lzfile));
+
+	if(compdata.size() < 6)
+	{
+		gLogging.textOut("lz_decompress(): unable to read the compressed data!<br>");
+		return 1;
+	}
+
+	// Get the decompressed file-size. Not needed, the codes tell when the data ends
+	// and the output is bounded by outlen.
+
 	// Get the length of the maximum dictionary size
-	
-	maxdictcodewords = fgetc(lzfile);
-	maxdictcodewords += fgetc(lzfile) << 8;
-	
-	maxdictsize = ((1<<maxdictcodewords)+1);
-	
-	lzdict = new stLZDictionaryEntry*[maxdictsize];
-	// allocate memory for the LZ dictionary
-	for(i=0;i<maxdictsize;i++)
+	const unsigned int maxdictcodewords = compdata[4] | (compdata[5] << 8);
+
+	if(maxdictcodewords < LZ_STARTBITS || maxdictcodewords > LZ_MAXCODEBITS)
 	{
-		lzdict[i] = new stLZDictionaryEntry;
-		if (!lzdict[i])
-		{
-			gLogging.textOut("lz_decompress(): unable to allocate memory for dictionary!<br>");
-			return 1;
-		}
+		gLogging.ftextOut("lz_decompress(): unsupported code width of %d bits<br>", maxdictcodewords);
+		return 1;
 	}
-	
+
+	const unsigned int maxdictsize = ((1<<maxdictcodewords)+1);
+
+	// allocate memory for the LZ dictionary, all entries in one block
+	std::vector<stLZDictionaryEntry> lzdict(maxdictsize);
+
 	/* initilize the dictionary */
-	
+
 	// entries 0-255 start with a single character corresponding
 	// to their entry number
-	for(i=0;i<256;i++)
+	for(unsigned int i=0;i<256;i++)
 	{
-		lzdict[i]->stringlen = 1;
-		lzdict[i]->string[0] = i;
+		lzdict[i].stringlen = 1;
+		lzdict[i].string[0] = (unsigned char)(i);
 	}
 	// 256+ start undefined
-	for(i=256;i<maxdictsize;i++)
+	for(unsigned int i=256;i<maxdictsize;i++)
 	{
-		lzdict[i]->stringlen = 0;
+		lzdict[i].stringlen = 0;
 	}
-	
-	// reset readbits
-	lz_readbits(NULL, 0, 1);
-	
+
+	LZBitReader reader(compdata);
+	reader.read(16); reader.read(16); reader.read(16); // skip the header
+
+	unsigned char *out = outbuffer;
+	unsigned char *const outEnd = outbuffer + outlen;
+
+	// writes dictionary entry 'entry' to the output buffer, never past its end
+	auto outputDict = [&](const unsigned int entry)
+	{
+		const size_t left = size_t(outEnd - out);
+		size_t len = size_t(lzdict[entry].stringlen);
+		if(len > left) len = left;
+		memcpy(out, lzdict[entry].string, len);
+		out += len;
+	};
+
 	// set starting # of bits-per-code
-	numbits = LZ_STARTBITS;
-	maxdictindex = (1 << numbits) - 1;
-	
-	// point the global pointer to the buffer we were passed
-	lz_outbuffer = outbuffer;
-	
+	unsigned int numbits = LZ_STARTBITS;
+	unsigned int maxdictindex = (1 << numbits) - 1;
+
 	// setup where to start adding strings to the dictionary
-	dictindex = LZ_DICTSTARTCODE;
-	addtodict = 1;                    // enable adding to dictionary
-	
+	unsigned int dictindex = LZ_DICTSTARTCODE;
+	bool addtodict = true;                    // enable adding to dictionary
+
 	// read first code
-	lastcode = lz_readbits(lzfile, numbits, 0);
-	lz_outputdict(lastcode);
-	do
+	unsigned int lastcode = reader.read(numbits);
+	outputDict(lastcode);
+	while(1)
 	{
 		// read the next code from the compressed data stream
-		lzcode = lz_readbits(lzfile, numbits, 0);
-		lzcode_save = lzcode;
-		
+		const unsigned int lzcode_save = reader.read(numbits);
+		unsigned int lzcode = lzcode_save;
+
 		if (lzcode==LZ_ERRORCODE || lzcode==LZ_EOFCODE)
 			break;
-		
+
+		if (reader.exhausted())
+		{
+			gLogging.textOut("lz_decompress(): compressed data ended without EOF code<br>");
+			break;
+		}
+
 		// if the code is present in the dictionary,
 		// lookup and write the string for that code, then add the
 		// last string + the first char of the just-looked-up string
 		// to the dictionary at dictindex
-		
+
 		// if not in dict, add the last string + the first char of the
 		// last string to the dictionary at dictindex (which will be equal
 		// to lzcode), then lookup and write string lzcode.
-		
-		if (lzdict[lzcode]->stringlen==0)
+
+		if (lzdict[lzcode].stringlen==0)
 			// code is not present in dictionary
 			lzcode = lastcode;
-		
+
 		if (addtodict)     // room to add more entries to the dictionary?
 		{
-			// copies string lastcode to string dictindex, then
-			// concatenates the first character of string lzcode.
-			for(i=0 ; i< (unsigned int) lzdict[lastcode]->stringlen ; i++)
-				lzdict[dictindex]->string[i] = lzdict[lastcode]->string[i];
-			
-			lzdict[dictindex]->string[i] = lzdict[lzcode]->string[0];
-			lzdict[dictindex]->stringlen = (lzdict[lastcode]->stringlen + 1);
-			
-			// ensure we haven't overflowed the buffer
-			if (lzdict[dictindex]->stringlen >= (LZ_MAXSTRINGSIZE-1))
+			stLZDictionaryEntry &last = lzdict[lastcode];
+			stLZDictionaryEntry &entry = lzdict[dictindex];
+
+			// ensure we won't overflow the buffer
+			if (last.stringlen+1 >= (LZ_MAXSTRINGSIZE-1))
 			{
 				gLogging.ftextOut("lz_decompress(): lzdict[%d]->stringlen is too long...max length is %d<br>", dictindex, LZ_MAXSTRINGSIZE);
 				return 1;
 			}
-			
+
+			// copies string lastcode to string dictindex, then
+			// concatenates the first character of string lzcode.
+			const unsigned char first = lzdict[lzcode].string[0];
+			memcpy(entry.string, last.string, size_t(last.stringlen));
+			entry.string[last.stringlen] = first;
+			entry.stringlen = last.stringlen + 1;
+
 			dictindex++;
 			if (dictindex >= maxdictindex)
 			{ // no more entries can be specified with current code bit-width
@@ -193,24 +216,17 @@ char lz_decompress(FILE *lzfile, unsigned char *outbuffer)
 					// reached maximum bit width, can't increase.
 					// use the final entry (4095) before we shut off
 					// adding items to the dictionary.
-					if (dictindex>=(maxdictsize-1)) addtodict = 0;
+					if (dictindex>=(maxdictsize-1)) addtodict = false;
 				}
 			}
 		}
-		
+
 		// write the string associated with the original code read.
 		// if the code wasn't present, it now should have been added.
-		lz_outputdict(lzcode_save);
-		
+		outputDict(lzcode_save);
+
 		lastcode = lzcode_save;
-	} while(1);
-	
-	/* free the memory used by the LZ dictionary */
-	for(i=0;i<maxdictsize;i++)
-		delete lzdict[i];
-	
-	delete [] lzdict;
-	
+	}
+
 	return 0;
 }
-
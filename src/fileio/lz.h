@@ -1 +1,11 @@
-char lz_decompress(FILE *lzfile, unsigned char *outbuffer);
+#ifndef LZ_H
+#define LZ_H
+
+#include <cstdio>
+#include <cstddef>
+
+// decompresses LZ data from open file lzfile into outbuffer, writing at most outlen bytes
+// returns nonzero if an error occurs
+char lz_decompress(FILE *lzfile, unsigned char *outbuffer, const size_t outlen);
+
+#endif // LZ_H
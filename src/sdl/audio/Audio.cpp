@@ -6,11 +6,13 @@
  */
 
 #include "Audio.h"
+#include "Mixer.h"
 #include "fileio.h"
 #include "fileio/ResourceMgmt.h"
 #include <base/GsLogging.h>
 #include <base/utils/FindFile.h>
 #include "sdl/audio/music/CMusic.h"
+#include "sdl/audio/music/CIMFPlayer.h"
 
 #include <SDL_mixer.h>
 
@@ -133,13 +135,21 @@ bool Audio::init()
              << (audio_channels>1?"stereo":"mono")
              << ", " << mAudioSpec.size << " bytes audio buffer.\n";
 
+    // No more than 32, the finished channels are reported through one bit each
     const unsigned int channels = 32;
     Mix_AllocateChannels(channels);
 
 
     mSndChnlVec.clear();
 
-    mSndChnlVec.assign(channels, CSoundChannel(mAudioSpec));
+    for(unsigned int i=0 ; i<channels ; i++)
+    {
+        mSndChnlVec.push_back(CSoundChannel(mAudioSpec, i));
+    }
+
+    mVoiceAllocator.reset(channels);
+    mFinishedVoices.store(0);
+    Mix_ChannelFinished(&Audio::onChannelFinished);
 
     Mix_VolumeMusic(m_MusicVolume);
     Mix_Volume(-1, m_SoundVolume);
@@ -159,23 +169,34 @@ bool Audio::init()
 
 void (*mixAudio)(Uint8*, const Uint8*, Uint32, Uint32);
 
-void mixAudioUnsigned8(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
-
-void mixAudioSigned16(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
-
 
 /**
  * @brief updateFuncPtrs Depending on the audio setup it will update the mixAudio function pointer.
+ *                       Vectorized kernels are taken when the CPU supports them.
  */
 void Audio::updateFuncPtrs()
 {
     if(mAudioSpec.format == AUDIO_S16)
     {
         mixAudio = mixAudioSigned16;
+
+#if defined(MIXER_NEON)
+        mixAudio = mixAudioSigned16NEON;
+#elif defined(MIXER_SSE2)
+        if(SDL_HasSSE2())
+            mixAudio = mixAudioSigned16SSE2;
+#endif
     }
     else if(mAudioSpec.format == AUDIO_U8)
     {
         mixAudio = mixAudioUnsigned8;
+
+#if defined(MIXER_NEON)
+        mixAudio = mixAudioUnsigned8NEON;
+#elif defined(MIXER_SSE2)
+        if(SDL_HasSSE2())
+            mixAudio = mixAudioUnsigned8SSE2;
+#endif
     }
 }
 
@@ -185,15 +206,20 @@ void Audio::destroy()
 	stopAllSounds();
 
     Mix_HaltChannel(-1);
+    Mix_ChannelFinished(nullptr);
 
     if(!mSndChnlVec.empty())
     {
         mSndChnlVec.clear();
     }
 
+    mVoiceAllocator.reset(0);
+
 	// Shutdown the OPL Emulator here!
 	gLogging.ftextOut("SoundDrv_Stop(): shut down.<br>");
 
+    // The IMF producer must not render anymore while the emulator goes down
+    suspendIMFProducer();
 	m_OPL_Player.shutdown();
 
     Mix_CloseAudio();
@@ -206,6 +232,46 @@ void Audio::stopAllSounds()
     {
 		snd_chnl.stopSound();
     }
+
+    mVoiceAllocator.reset(mSndChnlVec.size());
+    mFinishedVoices.store(0);
+}
+
+
+void Audio::onChannelFinished(int channel)
+{
+    if(channel >= 0 && channel < 32)
+    {
+        gSound.mFinishedVoices.fetch_or(Uint32(1) << channel);
+    }
+}
+
+
+void Audio::reclaimFinishedVoices()
+{
+    Uint32 finished = mFinishedVoices.exchange(0);
+
+    for(int voice = 0 ; finished ; voice++, finished >>= 1)
+    {
+        // A stopped channel might have been started again already
+        if((finished & 1) && !mSndChnlVec[voice].isPlaying())
+        {
+            mVoiceAllocator.release(voice);
+        }
+    }
+
+    // Everything taken? Then make sure no voice is held by a sound which could not be started
+    // or whose end was missed, before anything gets stolen.
+    if(mVoiceAllocator.numFreeVoices() == 0)
+    {
+        for(unsigned int voice = 0 ; voice < mVoiceAllocator.numVoices() ; voice++)
+        {
+            if(!mSndChnlVec[voice].isPlaying())
+            {
+                mVoiceAllocator.release(voice);
+            }
+        }
+    }
 }
 
 // pauses any currently playing sounds
@@ -225,15 +291,12 @@ void Audio::resumeAudio()
 // returns true if sound snd is currently playing
 bool Audio::isPlaying(const GameSound snd)
 {
-    std::vector<CSoundChannel>::iterator snd_chnl = mSndChnlVec.begin();
-    for( ; snd_chnl != mSndChnlVec.end() ; snd_chnl++ )
+    reclaimFinishedVoices();
+
+    for( const int voice : mVoiceAllocator.getVoicesOf(snd) )
 	{
-		if (snd_chnl->isPlaying())
-		{
-			CSoundSlot *pSlotToStop = mpAudioRessources->getSlotPtrAt(snd);
-			if (snd_chnl->getCurrentSoundPtr() == pSlotToStop)
-				return true;
-		}
+		if (mSndChnlVec[voice].isPlaying())
+			return true;
 	}
 	return false;
 }
@@ -241,17 +304,13 @@ bool Audio::isPlaying(const GameSound snd)
 // if sound snd is currently playing, stop it immediately
 void Audio::stopSound(const GameSound snd)
 {
-    std::vector<CSoundChannel>::iterator snd_chnl = mSndChnlVec.begin();
-    for( ; snd_chnl != mSndChnlVec.end() ; snd_chnl++)
+    // Copy them, releasing a voice removes it from that list
+    const std::vector<int> voices = mVoiceAllocator.getVoicesOf(snd);
+
+    for( const int voice : voices )
 	{
-		if (snd_chnl->isPlaying())
-		{
-            CSoundSlot *pSlotToStop =  mpAudioRessources->getSlotPtrAt(snd);
-            if( snd_chnl->getCurrentSoundPtr() == pSlotToStop )
-            {
-                snd_chnl->stopSound();
-            }
-        }
+        mSndChnlVec[voice].stopSound();
+        mVoiceAllocator.release(voice);
 	}
 }
 
@@ -375,43 +434,29 @@ void Audio::playStereosoundSlot(unsigned char slotplay,
     }
 
 
-	// first try to find an empty channel
-    for( auto &sndChnl : mSndChnlVec)
-	{
-        // check if channel is still playing
+    reclaimFinishedVoices();
 
-        auto slotPtr = sndChnl.getCurrentSoundPtr();
+	// Take a free channel, or steal one playing something less important
+    bool stolen = false;
+    const int voice = mVoiceAllocator.allocate(slotplay, chosenSlot.priority, stolen);
 
-        if(slotPtr)
-        {
-            CSoundSlot &currentSlot = *(slotPtr);
+    if(voice < 0)
+    {
+        return;
+    }
 
-            if (!sndChnl.isPlaying() ||
-                chosenSlot.priority >= currentSlot.priority )
-            {
-                if(mAudioSpec.channels == 2)
-                {
-                    sndChnl.setBalance(balance);
-                }
-
-                sndChnl.setupSound(chosenSlot,
-                                  (mode==SoundPlayMode::PLAY_FORCE) ? true : false );
-                break;
-            }
-        }
-        else if (!sndChnl.isPlaying())
-        {
-            if(mAudioSpec.channels == 2)
-            {
-                sndChnl.setBalance(balance);
-            }
+    CSoundChannel &sndChnl = mSndChnlVec[voice];
 
-            sndChnl.setupSound(chosenSlot,
-                                (mode==SoundPlayMode::PLAY_FORCE) ? true : false );
+    if(mAudioSpec.channels == 2)
+    {
+        sndChnl.setBalance(balance);
+    }
 
-            break;
-        }
-	}
+    if(!sndChnl.setupSound(chosenSlot,
+                           (mode==SoundPlayMode::PLAY_FORCE) ? true : false ))
+    {
+        mVoiceAllocator.release(voice);
+    }
 }
 
 void Audio::setupSoundData(const std::map<GameSound, int> &slotMap,
@@ -20,8 +20,10 @@
 #include <vector>
 #include <list>
 #include <memory>
+#include <atomic>
 
 #include "sound/CSoundChannel.h"
+#include "sound/CVoiceAllocator.h"
 #include "CAudioResources.h"
 
 class Audio : public GsSingleton<Audio>
@@ -63,7 +65,7 @@ public:
      * @brief playStereosound Play with indication of balance
      * @param snd   number of sound to play
      * @param mode  How to play it
-     * @param balance between -127(left) to 127(right)
+     * @param balance between -255(left) to 255(right)
      */
     void playStereosound(const GameSound snd,
                          const SoundPlayMode mode,
@@ -73,7 +75,7 @@ public:
      * @brief playStereosoundSlot
      * @param slotplay
      * @param mode
-     * @param balance
+     * @param balance between -255(left) to 255(right)
      */
     void playStereosoundSlot(const unsigned char slotplay,
                              const SoundPlayMode mode,
@@ -109,6 +111,13 @@ public:
     bool getSoundBlasterMode() {	return mUseSoundBlaster;	}
     COPLEmulator &getOPLEmulatorRef() { return m_OPL_Player; }
 
+    /**
+     * @brief getIMFLatency How many milliseconds of IMF music are rendered ahead of the audio callback
+     *                      on a separate thread. 0 renders inside the callback.
+     */
+    unsigned int getIMFLatency() const { return mIMFLatency; }
+    void setIMFLatency(const unsigned int latency) { mIMFLatency = latency; }
+
 	void setSettings( const int rate,
 							  const int channels,
 							  const int format,
@@ -148,6 +157,22 @@ private:
 
     std::vector<CSoundChannel>	mSndChnlVec;
 
+    // Which of those channels are free and which play what
+    CVoiceAllocator mVoiceAllocator;
+
+    // Bit per channel, set by the mixer when a channel stopped playing
+    std::atomic<Uint32> mFinishedVoices{0};
+
+    /**
+     * @brief onChannelFinished Called by SDL_mixer, from the audio thread, whenever a channel stops
+     */
+    static void onChannelFinished(int channel);
+
+    /**
+     * @brief reclaimFinishedVoices Hands the channels which stopped playing back to the allocator
+     */
+    void reclaimFinishedVoices();
+
     std::unique_ptr<CAudioResources> mpAudioRessources;
 
 	Uint8 m_MusicVolume;
@@ -160,6 +185,8 @@ private:
 
     COPLEmulator m_OPL_Player;
     bool mPauseGameplay = false;
+
+    unsigned int mIMFLatency = 50;
 };
 
 #endif /* __AUDIO_H__ */
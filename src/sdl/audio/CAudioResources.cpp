@@ -15,7 +15,10 @@
 CAudioResources::CAudioResources()
 {}
 
-bool CAudioResources::readISFintoWaveForm( CSoundSlot &soundslot, const byte *imfdata, const Uint8 formatsize )
+bool CAudioResources::readISFintoWaveForm( CSoundSlot &soundslot,
+                                           const byte *imfdata,
+                                           const Uint8 formatsize,
+                                           COPLEmulator &OPLEmulator )
 {
 	byte *imfdata_ptr = (byte*)imfdata;
 	const longword size = READLONGWORD(imfdata_ptr);
@@ -27,7 +30,6 @@ bool CAudioResources::readISFintoWaveForm( CSoundSlot &soundslot, const byte *im
     }
 
 	soundslot.priority = READWORD(imfdata_ptr);
-    COPLEmulator &OPLEmulator = gSound.getOPLEmulatorRef();
 
 	// It's time make it Adlib Sound structure and read it into the waveform
 	AdLibSound AL_Sound = *((AdLibSound*) imfdata_ptr);
@@ -36,6 +38,9 @@ bool CAudioResources::readISFintoWaveForm( CSoundSlot &soundslot, const byte *im
 	const byte *AL_Sounddata_start = imfdata_ptr;
 	const byte *AL_Sounddata_end = AL_Sounddata_start+data_size;
 
+    // Always start from a freshly reset chip, so every effect sounds the same
+    // no matter which effect was rendered before on that emulator.
+    OPLEmulator.setup();
 	OPLEmulator.ShutAL();
 	Bit8u alBlock = ((AL_Sound.block & 7) << 2) | 0x20;
 	if (!(AL_Sound.inst.mSus | AL_Sound.inst.cSus))
@@ -176,7 +176,22 @@ public:
     virtual bool loadSoundData(const unsigned int dictOffset) = 0;
 	virtual void unloadSound() = 0;
 
-    bool readISFintoWaveForm(CSoundSlot &soundslot, const byte *imfdata, const Uint8 formatsize );
+    /**
+     * @brief readISFintoWaveForm   Renders an Adlib sound effect into the waveform of the given slot.
+     *                              The passed emulator is set up from scratch before rendering,
+     *                              so the result does not depend on what the chip played before.
+     *                              Different effects may be rendered concurrently as long as every
+     *                              thread uses its own emulator.
+     * @param soundslot             Slot receiving the waveform
+     * @param imfdata               ISF data of the sound effect
+     * @param formatsize            Bytes per sample (1 or 2)
+     * @param OPLEmulator           Chip used for rendering
+     * @return                      true if the effect could be read, otherwise false
+     */
+    bool readISFintoWaveForm(CSoundSlot &soundslot,
+                             const byte *imfdata,
+                             const Uint8 formatsize,
+                             COPLEmulator &OPLEmulator);
 	
 	CSoundSlot *getSlotPtr(){	return &m_soundslot[0];	}
 	CSoundSlot *getSlotPtrAt(const unsigned int idx){	return &m_soundslot[idx];	}
@@ -9,7 +9,15 @@
  *  I think that led to many problems,
  */
 
-#include <SDL.h>
+#include "Mixer.h"
+
+#ifdef MIXER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef MIXER_NEON
+#include <arm_neon.h>
+#endif
 
 #define WAVE_SILENCE_U8         128
 #define WAVE_SILENCE_S8         0
@@ -17,8 +25,41 @@
 #define WAVE_SILENCE_U16        32768
 #define WAVE_SILENCE_S16        0
 
+// SDL_MIX_MAXVOLUME is 128, so the volume gets applied as a 7-bit fixed-point factor.
+// The shift rounds towards minus infinity, the vector kernels do the very same.
+#define VOLUME_SHIFT            7
+
+
+static inline Sint32 clampVolume(const Uint32 volume)
+{
+    return (volume > SDL_MIX_MAXVOLUME) ? SDL_MIX_MAXVOLUME : Sint32(volume);
+}
+
+static inline Sint16 mixSampleSigned16(const Sint16 dst, const Sint16 src, const Sint32 volume)
+{
+    Sint32 outputValue = dst + ((src*volume) >> VOLUME_SHIFT);
+
+    // And clip the result
+    if (outputValue > WAVE_SILENCE_U16-1)
+        outputValue = WAVE_SILENCE_U16-1;
+    else if(outputValue < -WAVE_SILENCE_U16)
+        outputValue = -WAVE_SILENCE_U16;
+
+    return Sint16(outputValue);
+}
+
+static inline Uint8 mixSampleUnsigned8(const Uint8 dst, const Uint8 src, const Sint32 volume)
+{
+    const Sint32 chnl_src = Sint32(src) - WAVE_SILENCE_U8;
+
+    // dst still carries the silence offset, so the result has it as well
+    Sint32 outputValue = dst + ((chnl_src*volume) >> VOLUME_SHIFT);
+
+    if (outputValue > 255) outputValue = 255;        // and clip the result
+    if (outputValue < 0) outputValue = 0;
 
-#define CHUNKSIZE 4
+    return Uint8(outputValue);
+}
 
 /**
  * This will mix 16-bit signed streams together.
@@ -30,39 +71,13 @@ void mixAudioSigned16(Uint8 *dst,
 {
 	len /= 2;
 
-    // let's try to unroll loops and get SSE/AVX work better
-    const Uint32 chunks = len/CHUNKSIZE;
-
+    const Sint32 vol = clampVolume(volume);
     Sint16 *s_dst = (Sint16*) (void *)dst;
-	Sint16 *s_src = (Sint16*) (void *)src;
-    Sint32 chnl_src[CHUNKSIZE];
-    Sint32 chnl_dst[CHUNKSIZE];
-    Sint32 outputValue[CHUNKSIZE];
+    const Sint16 *s_src = (const Sint16*) (const void *)src;
 
-    for ( Uint32 j=0 ; j<chunks ; j++ )
+    for ( Uint32 i=0 ; i<len ; i++ )
     {
-        for ( Uint32 i=0 ; i<CHUNKSIZE ; i++ )
-        {
-            chnl_src[i] = s_src[i];
-            chnl_dst[i] = s_dst[i];
-
-            chnl_src[i] *= volume;
-            chnl_src[i] /= SDL_MIX_MAXVOLUME;
-
-            // Add the channels and normalize the volume
-            outputValue[i] = chnl_src[i] + chnl_dst[i];// just add the channels
-
-            // And clip the result
-            if (outputValue[i] > WAVE_SILENCE_U16-1)
-                outputValue[i] = WAVE_SILENCE_U16-1;
-            else if(outputValue[i] < -WAVE_SILENCE_U16)
-                outputValue[i] = -WAVE_SILENCE_U16;
-
-            // And pass result to the destination
-            s_dst[i] = outputValue[i];
-        }
-        s_src += CHUNKSIZE;
-        s_dst += CHUNKSIZE;
+        s_dst[i] = mixSampleSigned16(s_dst[i], s_src[i], vol);
     }
 }
 
@@ -71,29 +86,155 @@ void mixAudioSigned16(Uint8 *dst,
  */
 void mixAudioUnsigned8(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume)
 {
-    Sint32 chnl_src=0;
-    Sint32 chnl_dst=0;
-    Sint32 outputValue=0;           // just add the channels
-    
+    const Sint32 vol = clampVolume(volume);
+
     for (Uint32 i=0;i<len;i++) 
     {
-        chnl_src = *src;
-        chnl_dst = *dst;
+        dst[i] = mixSampleUnsigned8(dst[i], src[i], vol);
+    }
+}
+
+
+#ifdef MIXER_SSE2
+
+/**
+ * SSE2 version of mixAudioSigned16(). Eight samples per step, the rest is done one by one.
+ */
+void mixAudioSigned16SSE2(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume)
+{
+    len /= 2;
+
+    const Sint32 vol = clampVolume(volume);
+    Sint16 *s_dst = (Sint16*) (void *)dst;
+    const Sint16 *s_src = (const Sint16*) (const void *)src;
+
+    // Every 32-bit lane holds the pair (vol, 0), so madd yields sample*vol in 32 bits
+    const __m128i volPairs = _mm_set1_epi32(vol);
+    const __m128i zero = _mm_setzero_si128();
+
+    Uint32 i = 0;
+    for ( ; i+8 <= len ; i += 8 )
+    {
+        const __m128i srcVec = _mm_loadu_si128((const __m128i*)(s_src+i));
+        const __m128i dstVec = _mm_loadu_si128((const __m128i*)(s_dst+i));
+
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(srcVec, zero), volPairs);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(srcVec, zero), volPairs);
+        lo = _mm_srai_epi32(lo, VOLUME_SHIFT);
+        hi = _mm_srai_epi32(hi, VOLUME_SHIFT);
+
+        const __m128i scaled = _mm_packs_epi32(lo, hi);
+        _mm_storeu_si128((__m128i*)(s_dst+i), _mm_adds_epi16(dstVec, scaled));
+    }
+
+    for ( ; i<len ; i++ )
+    {
+        s_dst[i] = mixSampleSigned16(s_dst[i], s_src[i], vol);
+    }
+}
+
+/**
+ * SSE2 version of mixAudioUnsigned8(). Sixteen samples per step, the rest is done one by one.
+ */
+void mixAudioUnsigned8SSE2(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume)
+{
+    const Sint32 vol = clampVolume(volume);
+
+    const __m128i volVec = _mm_set1_epi16(Sint16(vol));
+    const __m128i silence = _mm_set1_epi16(WAVE_SILENCE_U8);
+    const __m128i zero = _mm_setzero_si128();
+
+    Uint32 i = 0;
+    for ( ; i+16 <= len ; i += 16 )
+    {
+        const __m128i srcVec = _mm_loadu_si128((const __m128i*)(src+i));
+        const __m128i dstVec = _mm_loadu_si128((const __m128i*)(dst+i));
+
+        // (sample-128)*vol stays within 16 bits, since vol is at most 128
+        __m128i srcLo = _mm_sub_epi16(_mm_unpacklo_epi8(srcVec, zero), silence);
+        __m128i srcHi = _mm_sub_epi16(_mm_unpackhi_epi8(srcVec, zero), silence);
+        srcLo = _mm_srai_epi16(_mm_mullo_epi16(srcLo, volVec), VOLUME_SHIFT);
+        srcHi = _mm_srai_epi16(_mm_mullo_epi16(srcHi, volVec), VOLUME_SHIFT);
+
+        const __m128i outLo = _mm_add_epi16(_mm_unpacklo_epi8(dstVec, zero), srcLo);
+        const __m128i outHi = _mm_add_epi16(_mm_unpackhi_epi8(dstVec, zero), srcHi);
+
+        _mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(outLo, outHi));
+    }
+
+    for ( ; i<len ; i++ )
+    {
+        dst[i] = mixSampleUnsigned8(dst[i], src[i], vol);
+    }
+}
+
+#endif // MIXER_SSE2
+
+
+#ifdef MIXER_NEON
+
+/**
+ * NEON version of mixAudioSigned16(). Eight samples per step, the rest is done one by one.
+ */
+void mixAudioSigned16NEON(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume)
+{
+    len /= 2;
+
+    const Sint32 vol = clampVolume(volume);
+    Sint16 *s_dst = (Sint16*) (void *)dst;
+    const Sint16 *s_src = (const Sint16*) (const void *)src;
+
+    const int16x4_t volVec = vdup_n_s16(Sint16(vol));
+
+    Uint32 i = 0;
+    for ( ; i+8 <= len ; i += 8 )
+    {
+        const int16x8_t srcVec = vld1q_s16(s_src+i);
+        const int16x8_t dstVec = vld1q_s16(s_dst+i);
+
+        const int32x4_t lo = vshrq_n_s32(vmull_s16(vget_low_s16(srcVec), volVec), VOLUME_SHIFT);
+        const int32x4_t hi = vshrq_n_s32(vmull_s16(vget_high_s16(srcVec), volVec), VOLUME_SHIFT);
+
+        const int16x8_t scaled = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+        vst1q_s16(s_dst+i, vqaddq_s16(dstVec, scaled));
+    }
+
+    for ( ; i<len ; i++ )
+    {
+        s_dst[i] = mixSampleSigned16(s_dst[i], s_src[i], vol);
+    }
+}
+
+/**
+ * NEON version of mixAudioUnsigned8(). Sixteen samples per step, the rest is done one by one.
+ */
+void mixAudioUnsigned8NEON(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume)
+{
+    const Sint32 vol = clampVolume(volume);
 
-        chnl_src -= WAVE_SILENCE_U8;
-        chnl_dst -= WAVE_SILENCE_U8;
+    const int16x8_t silence = vdupq_n_s16(WAVE_SILENCE_U8);
 
-        chnl_src *= volume;
-        chnl_src /= SDL_MIX_MAXVOLUME;
+    Uint32 i = 0;
+    for ( ; i+16 <= len ; i += 16 )
+    {
+        const uint8x16_t srcVec = vld1q_u8(src+i);
+        const uint8x16_t dstVec = vld1q_u8(dst+i);
 
-        outputValue = chnl_src + chnl_dst + WAVE_SILENCE_U8;           // just add the channels
-        if (outputValue > 255) outputValue = 255;        // and clip the result
-        if (outputValue < 0) outputValue = 0;
+        int16x8_t srcLo = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(srcVec))), silence);
+        int16x8_t srcHi = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(srcVec))), silence);
+        srcLo = vshrq_n_s16(vmulq_n_s16(srcLo, Sint16(vol)), VOLUME_SHIFT);
+        srcHi = vshrq_n_s16(vmulq_n_s16(srcHi, Sint16(vol)), VOLUME_SHIFT);
 
-        *dst = outputValue;
+        const int16x8_t outLo = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(dstVec))), srcLo);
+        const int16x8_t outHi = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(dstVec))), srcHi);
 
-        src++;
-        dst++;
+        vst1q_u8(dst+i, vcombine_u8(vqmovun_s16(outLo), vqmovun_s16(outHi)));
+    }
+
+    for ( ; i<len ; i++ )
+    {
+        dst[i] = mixSampleUnsigned8(dst[i], src[i], vol);
     }
 }
 
+#endif // MIXER_NEON
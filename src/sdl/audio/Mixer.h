@@ -0,0 +1,48 @@
+/*
+ * Mixer.h
+ *
+ *  Created on: 31.07.2010
+ *      Author: gerstrong
+ *
+ *  Mixing kernels of our own mixer. All of them do the same:
+ *  dst = clip(dst + src*volume/SDL_MIX_MAXVOLUME) for every sample of the stream,
+ *  with the volume applied in fixed-point and clamped to SDL_MIX_MAXVOLUME.
+ *  len is always given in bytes.
+ *
+ *  The vectorized variants give exactly the same output as the plain ones.
+ *  Audio::updateFuncPtrs() picks the one that fits the audio format and CPU
+ *  and sets mixAudio to it. SDL_mixer mixes the sound channels itself,
+ *  mixAudio is used for the music we render, like IMF.
+ */
+
+#ifndef MIXER_H_
+#define MIXER_H_
+
+#include <SDL.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE2
+#endif
+
+// The NEON kernels have not been built and tested on ARM yet, so they have to be asked for
+// with the MIXER_NEON_KERNELS option. Until then ARM takes the plain kernels.
+#if defined(MIXER_ENABLE_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define MIXER_NEON
+#endif
+
+extern void (*mixAudio)(Uint8*, const Uint8*, Uint32, Uint32);
+
+void mixAudioSigned16(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
+void mixAudioUnsigned8(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
+
+#ifdef MIXER_SSE2
+void mixAudioSigned16SSE2(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
+void mixAudioUnsigned8SSE2(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
+#endif
+
+#ifdef MIXER_NEON
+void mixAudioSigned16NEON(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
+void mixAudioUnsigned8NEON(Uint8 *dst, const Uint8 *src, Uint32 len, Uint32 volume);
+#endif
+
+#endif /* MIXER_H_ */
@@ -21,7 +21,9 @@ const int KEEN_IMF_CLOCK_RATE = 560;
 
 COPLEmulator::COPLEmulator() :
 m_imf_clock_rate(KEEN_IMF_CLOCK_RATE)
-{}
+{
+    memset(&m_alZeroInst, 0, sizeof(m_alZeroInst));
+}
 
 COPLEmulator::~COPLEmulator()
 {
@@ -78,6 +80,7 @@ void COPLEmulator::setup()
 
     const SDL_AudioSpec &audioSpec = gSound.getAudioSpec();
     Chip__Setup(&m_opl_chip, audioSpec.freq);
+    mChipReady = true;
 
     StartOPLforAdlibSound();
 }
@@ -118,6 +121,9 @@ void COPLEmulator::ShutAL()
 
 void COPLEmulator::shutdown()
 {
+    if(!mChipReady)
+        return;
+
     Chip__WriteReg( alEffects, 0 );
 
     for (int i = 1 ; i < 0xf5 ; i++)
@@ -129,6 +135,7 @@ void COPLEmulator::shutdown()
 void COPLEmulator::clear()
 {
     m_opl_chip.clear();
+    mChipReady = false;
 }
 
 
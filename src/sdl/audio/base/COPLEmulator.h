@@ -71,12 +71,22 @@ public:
 
 	/**
 	 * Wrapper for the original C Emulator function Chip__GenerateBlock2(&m_opl_chip, length, mix_buffer )
+	 * Unless disabled through setFastPath(), the OPL2 fast path renders the block. Its output is the same.
 	 */
 	inline void Chip__GenerateBlock2(const uintptr_t total, Bit32s* output )
 	{
-	    ::Chip__GenerateBlock2( &m_opl_chip, total, output );
+	    if(mFastPath)
+	        ::Chip__GenerateBlock2Fast( &m_opl_chip, total, output );
+	    else
+	        ::Chip__GenerateBlock2( &m_opl_chip, total, output );
 	}
 
+	/**
+	 * Selects between the OPL2 fast path and the original generation routine
+	 */
+	void setFastPath(const bool value) { mFastPath = value; }
+	bool isFastPath() const { return mFastPath; }
+
 
 	/**
 	 * Wrapper for the original C Emulator function Chip__WriteReg(Chip *self, Bit32u reg, Bit8u val )
@@ -101,7 +111,8 @@ public:
 
 	/**
 	 * Shutdown the emulator. This should only the called whenever the audio settings need to be shutdown
-	 * or restarted like when the user changes the audio settings in the configuration while playing
+	 * or restarted like when the user changes the audio settings in the configuration while playing.
+	 * A chip which was never set up is left alone.
 	 */
 	void shutdown();
 
@@ -114,6 +125,10 @@ private:
 	Chip m_opl_chip;
 	Instrument	m_alZeroInst;
 	unsigned int m_imf_clock_rate;
+	bool mFastPath = true;
+
+	// Registers may only be written once setup() prepared the chip
+	bool mChipReady = false;
 };
 
 #endif /* COPLEMULATOR_H_ */
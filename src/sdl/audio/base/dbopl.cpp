@@ -40,6 +40,14 @@
 #include <string.h>
 #include "dbopl.h"
 
+#if defined(DBOPL_SSE2_ACCUMULATE)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#else
+#undef DBOPL_SSE2_ACCUMULATE
+#endif
+#endif
+
 typedef intptr_t Bits;
 typedef uintptr_t Bitu;
 
@@ -153,15 +161,17 @@ static inline void Operator__SetState(Operator *self, Bit8u s );
 static inline Bit32u Chip__ForwardNoise(Chip *self);
 
 // C++'s template<> sure is useful sometimes.
+// The mode is a template argument, so every synth handler gets its own copy
+// of the sample loop with all the mode checks resolved at compile time.
 
+template <SynthMode mode>
 static Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
-                                Bit32u samples, Bit32s* output,
-                                SynthMode mode );
+                                Bit32u samples, Bit32s* output );
 #define BLOCK_TEMPLATE(mode) \
-    static inline Channel* Channel__BlockTemplate_ ## mode(Channel *self, Chip* chip, \
+    static Channel* Channel__BlockTemplate_ ## mode(Channel *self, Chip* chip, \
                                              Bit32u samples, Bit32s* output) \
     { \
-       return Channel__BlockTemplate(self, chip, samples, output, mode); \
+       return Channel__BlockTemplate<mode>(self, chip, samples, output); \
     }
 
 BLOCK_TEMPLATE(sm2AM)
@@ -938,9 +948,9 @@ static inline void Channel__GeneratePercussion(Channel *self, Chip* chip,
 // Value to scale in order to get normalized volume on this device matching to other players in CG
 const int SCALE_VOL = 1;
 
+template <SynthMode mode>
 Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
-                                Bit32u samples, Bit32s* output,
-                                SynthMode mode ) {
+                                Bit32u samples, Bit32s* output ) {
         Bitu i;
 
 	switch( mode ) {
@@ -1330,6 +1340,103 @@ void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s* output )
     }
 }
 
+/*
+	OPL2 fast path
+	Produces exactly the same output as Chip__GenerateBlock2, but resolves the synth
+	handler of every channel once per block instead of calling it through the pointer
+	for every LFO step. Those handlers are only changed by register writes, which never
+	happen while a block is generated. Fully silent channels are skipped that way too.
+*/
+
+//Samples of one LFO step that fit into the lanes of the SSE2 accumulation
+#define FAST_LANE_SAMPLES 512
+
+static inline Channel* Channel__Block2(Channel *self, Chip *chip, SynthMode mode,
+                                       Bit32u samples, Bit32s *output ) {
+	switch ( mode ) {
+	case sm2AM:
+		return Channel__BlockTemplate<sm2AM>( self, chip, samples, output );
+	case sm2FM:
+		return Channel__BlockTemplate<sm2FM>( self, chip, samples, output );
+	default:
+		return Channel__BlockTemplate<sm2Percussion>( self, chip, samples, output );
+	}
+}
+
+#ifdef DBOPL_SSE2_ACCUMULATE
+//Every channel renders into its own lane, the lanes are summed up four samples at a time.
+//Integer addition doesn't care about the order, so the result stays the same.
+static void Chip__AccumulateLanes(Bit32s lanes[][FAST_LANE_SAMPLES], Bitu count,
+                                  Bit32u samples, Bit32s *output ) {
+	Bit32u i = 0;
+	for ( ; i + 4 <= samples; i += 4 ) {
+		__m128i sum = _mm_loadu_si128( (const __m128i*)(output + i) );
+		for ( Bitu lane = 0; lane < count; lane++ ) {
+			sum = _mm_add_epi32( sum, _mm_load_si128( (const __m128i*)(lanes[lane] + i) ) );
+		}
+		_mm_storeu_si128( (__m128i*)(output + i), sum );
+	}
+	for ( ; i < samples; i++ ) {
+		for ( Bitu lane = 0; lane < count; lane++ ) {
+			output[i] += lanes[lane][i];
+		}
+	}
+}
+#endif
+
+void Chip__GenerateBlock2Fast(Chip *self, Bitu total, Bit32s* output )
+{
+	Channel *chans[9];
+	SynthMode modes[9];
+	Bitu count = 0;
+
+	//Anything else than the plain OPL2 handlers goes the regular way
+	if ( self->opl3Active ) {
+		Chip__GenerateBlock2( self, total, output );
+		return;
+	}
+	for ( Channel *ch = self->chan; ch < self->chan + 9; ) {
+		if ( ch->synthHandler == Channel__BlockTemplate_sm2FM ) {
+			modes[count] = sm2FM;
+		} else if ( ch->synthHandler == Channel__BlockTemplate_sm2AM ) {
+			modes[count] = sm2AM;
+		} else if ( ch->synthHandler == Channel__BlockTemplate_sm2Percussion ) {
+			modes[count] = sm2Percussion;
+		} else {
+			Chip__GenerateBlock2( self, total, output );
+			return;
+		}
+		chans[count++] = ch;
+		ch += ( modes[count-1] == sm2Percussion ) ? 3 : 1;
+	}
+
+	memset(output, 0, sizeof(Bit32s) * total);
+
+#ifdef DBOPL_SSE2_ACCUMULATE
+	alignas(16) Bit32s lanes[9][FAST_LANE_SAMPLES];
+#endif
+
+	while ( total > 0 ) {
+		Bit32u samples = Chip__ForwardLFO( self, total );
+#ifdef DBOPL_SSE2_ACCUMULATE
+		if ( samples <= FAST_LANE_SAMPLES ) {
+			for ( Bitu c = 0; c < count; c++ ) {
+				memset( lanes[c], 0, sizeof(Bit32s) * samples );
+				Channel__Block2( chans[c], self, modes[c], samples, lanes[c] );
+			}
+			Chip__AccumulateLanes( lanes, count, samples, output );
+		} else
+#endif
+		{
+			for ( Bitu c = 0; c < count; c++ ) {
+				Channel__Block2( chans[c], self, modes[c], samples, output );
+			}
+		}
+		total -= samples;
+		output += samples;
+	}
+}
+
 void Chip__GenerateBlock3(Chip *self, Bitu total, Bit32s* output  )
 {
 	while ( total > 0 )
@@ -13,9 +13,13 @@
 #include "fileio/KeenFiles.h"
 #include <base/utils/FindFile.h>
 #include <base/GsLogging.h>
+#include <base/utils/ThreadPool.h>
+#include <base/GsProfiler.h>
+#include "sdl/audio/Mixer.h"
 #include <fstream>
 #include <string>
 #include <cassert>
+#include <algorithm>
 
 #include <SDL_mixer.h>
 
@@ -27,6 +31,16 @@ m_opl_emulator(opl_emulator)
             m_opl_emulator.getIMFClockRate();
 }
 
+CIMFPlayer::~CIMFPlayer()
+{
+    stopProducer();
+
+    if(mpProducerWake)
+        SDL_DestroyCond(mpProducerWake);
+    if(mpControlMutex)
+        SDL_DestroyMutex(mpControlMutex);
+}
+
 
 bool CIMFPlayer::loadMusicFromFile(const std::string& filename)
 {    
@@ -99,30 +113,200 @@ bool CIMFPlayer::open(const bool lock)
 	
 	m_opl_emulator.setup();
 
-	return !m_IMF_Data.empty();
+    if(m_IMF_Data.empty())
+        return false;
+
+    // Whatever of the previous track is still in the ring gets dropped
+    postControl(IMFControl::FLUSH);
+    startProducer();
+
+	return true;
 }
 
 void CIMFPlayer::close(const bool lock)
 {
 	play(false);
+    stopProducer();
 	m_IMF_Data.gotoStart();	
 	m_numreadysamples = m_IMFDelay = 0;	
 	m_opl_emulator.ShutAL();
 	m_opl_emulator.shutdown();
 
+    const unsigned int underruns = mUnderruns.exchange(0);
+    if(underruns > 0)
+    {
+        gLogging.ftextOut("IMF-Player: The audio callback ran dry %u times. "
+                          "A higher IMF latency might help.<br>", underruns);
+    }
+
 	return;
 }
 
+void CIMFPlayer::rewind()
+{
+    if(mProducerRunning)
+    {
+        postControl(IMFControl::REWIND);
+        return;
+    }
+
+    // The producer might have been suspended because the audio device got reopened
+    m_IMF_Data.gotoStart();
+    m_numreadysamples = m_IMFDelay = 0;
+    m_samplesPerMusicTick = gSound.getAudioSpec().freq / m_opl_emulator.getIMFClockRate();
+    m_opl_emulator.setup();
+
+    postControl(IMFControl::FLUSH);
+    startProducer();
+}
+
+void CIMFPlayer::postControl(const IMFControl type)
+{
+    if(!mpControlMutex)
+    {
+        mpControlMutex = SDL_CreateMutex();
+        mpProducerWake = SDL_CreateCond();
+    }
+
+    SDL_mutexP(mpControlMutex);
+    mControlSeq++;
+    mControlQueue.push_back({mControlSeq, type});
+    SDL_mutexV(mpControlMutex);
+    SDL_CondSignal(mpProducerWake);
+}
+
+// Runs on the producer thread with mpControlMutex locked
+void CIMFPlayer::processControls()
+{
+    for( const auto &msg : mControlQueue )
+    {
+        if(msg.type == IMFControl::REWIND)
+        {
+            m_IMF_Data.gotoStart();
+            m_numreadysamples = m_IMFDelay = 0;
+            m_opl_emulator.setup();
+        }
+
+        // Both kinds make the consumer skip what was rendered before
+        mPCMRing.publishFlush(msg.seq);
+    }
+
+    mControlQueue.clear();
+}
+
+
+struct IMFProducerAction : public Action
+{
+    IMFProducerAction(CIMFPlayer &player) : mPlayer(player) {}
+
+    int handle()
+    {
+        mPlayer.produce();
+        return 0;
+    }
+
+    CIMFPlayer &mPlayer;
+};
+
+// The control queue always exists here, because open() and rewind() post a flush first.
+void CIMFPlayer::startProducer()
+{
+    const unsigned int latency = gSound.getIMFLatency();
+
+    if(mProducerRunning || !threadPool || latency == 0 || !mpControlMutex)
+        return;
+
+    const SDL_AudioSpec &audioSpec = gSound.getAudioSpec();
+    const size_t frameSize = audioSpec.channels *
+                             ((audioSpec.format == AUDIO_S16) ? sizeof(Sint16) : sizeof(Uint8));
+    const size_t callbackSize = audioSpec.samples*frameSize;
+    const size_t chunkFrames = std::max(audioSpec.samples/4, 1);
+
+    // Keep one callback buffer plus the latency target rendered ahead
+    mChunkSize = chunkFrames*frameSize;
+    mTargetFill = callbackSize + (size_t(audioSpec.freq)*latency/1000)*frameSize;
+    mProducerWaitMs = std::max(Uint32(chunkFrames*1000/audioSpec.freq), Uint32(1));
+
+    const size_t capacity = mTargetFill + mChunkSize;
+
+    // Reallocating is only needed after the audio settings changed.
+    // The music hook is not installed at that point, so nobody reads the ring.
+    if(mPCMRing.capacity() != capacity)
+    {
+        mPCMRing.reset(capacity);
+    }
+
+    mProducerQuit = false;
+    mProducerRunning = true;
+    mpProducer = threadPool->start(new IMFProducerAction(*this), "IMF producer");
+
+    if(!mpProducer)
+    {
+        mProducerRunning = false;
+    }
+}
+
+void CIMFPlayer::stopProducer()
+{
+    if(!mProducerRunning)
+        return;
+
+    postControl(IMFControl::FLUSH);
+
+    SDL_mutexP(mpControlMutex);
+    mProducerQuit = true;
+    SDL_mutexV(mpControlMutex);
+    SDL_CondSignal(mpProducerWake);
+
+    threadPool->wait(mpProducer, nullptr);
+    mpProducer = nullptr;
+    mProducerRunning = false;
+}
+
+void CIMFPlayer::produce()
+{
+    std::vector<Uint8> chunk(mChunkSize);
+
+    SDL_mutexP(mpControlMutex);
+
+    while(1)
+    {
+        processControls();
+
+        if(mProducerQuit)
+            break;
+
+        if( mPCMRing.fill() < mTargetFill &&
+            mPCMRing.capacity()-mPCMRing.fill() >= mChunkSize )
+        {
+            // Synthesis runs unlocked, so posting controls never waits for the emulator
+            SDL_mutexV(mpControlMutex);
+
+            renderBuffer(chunk.data(), Uint32(mChunkSize));
+            mPCMRing.write(chunk.data(), mChunkSize);
+
+            SDL_mutexP(mpControlMutex);
+            continue;
+        }
+
+        SDL_CondWaitTimeout(mpProducerWake, mpControlMutex, mProducerWaitMs);
+    }
+
+    SDL_mutexV(mpControlMutex);
+}
+
 
 
 void CIMFPlayer::OPLUpdate(byte *buffer, const unsigned int length)
 {    
+    GS_PROFILE_ZONE("OPLUpdate");
+
     auto &audioSpec = gSound.getAudioSpec();
 
-    if(mMixBuffer.empty())
+    // The buffer size may change when the audio settings do
+    if(mMixBuffer.size() < length)
     {
-        gLogging.textOut("Creating enough Audio Buffer for the IMF-Player");
-        mMixBuffer.assign(audioSpec.samples, 0);
+        mMixBuffer.assign(std::max(Uint32(audioSpec.samples), length), 0);
     }
 
     m_opl_emulator.Chip__GenerateBlock2( length, mMixBuffer.data() );
@@ -176,6 +360,22 @@ void CIMFPlayer::readBuffer(Uint8* buffer,
     if(!m_playing)
         return;
 
+    if(!mProducerRunning)
+    {
+        renderBuffer(buffer, length);
+        return;
+    }
+
+    // The callback buffer has been cleared already, so an underrun just stays silent.
+    if(mPCMRing.read(buffer, length) < length)
+    {
+        mUnderruns++;
+    }
+}
+
+void CIMFPlayer::renderBuffer(Uint8* buffer,
+                              Uint32 length)
+{
     auto &audioSpec = gSound.getAudioSpec();
     
     /// if a delay of the instruments is pending, play it
@@ -230,6 +430,10 @@ CIMFPlayer locIMFPlayer;
 
 int locImfMusPos = 0;
 
+// The music is rendered here first and then mixed in with the music volume.
+// Only touched by the audio callback.
+std::vector<Uint8> locImfMusBuffer;
+
 bool loadIMFFile(const std::string &fname)
 {
     if(locIMFPlayer.playing())
@@ -238,6 +442,9 @@ bool loadIMFFile(const std::string &fname)
         Mix_HaltMusic();
     }
 
+    // Make sure the callback is out of the player while it gets set up
+    Mix_HookMusic(nullptr, nullptr);
+
     if(locIMFPlayer.loadMusicFromFile(fname))
     {
         locIMFPlayer.open(false);
@@ -258,6 +465,9 @@ bool loadIMFTrack(const int track)
         Mix_HaltMusic();
     }
 
+    // Make sure the callback is out of the player while it gets set up
+    Mix_HookMusic(nullptr, nullptr);
+
     if(locIMFPlayer.loadMusicTrack(track))
     {        
         locIMFPlayer.open(false);
@@ -277,12 +487,24 @@ void imfMusicPlayer(void *udata,
 {
     int pos = *static_cast<int*>(udata);
 
+    const Uint8 silence = gSound.getAudioSpec().silence;
+    const size_t length = static_cast<size_t>(len);
+
+    if(locImfMusBuffer.size() < length)
+    {
+        locImfMusBuffer.resize(length);
+    }
+
     // Fill buffer with music
-    memset(stream, 0, static_cast<size_t>(len));
+    memset(locImfMusBuffer.data(), silence, length);
 
-    locIMFPlayer.readBuffer(stream,
+    locIMFPlayer.readBuffer(locImfMusBuffer.data(),
                             static_cast<Uint32>(len));
-    // fill buffer with...uh...music...
+
+    // SDL_mixer doesn't apply the music volume to hooked music, so it happens here
+    memset(stream, silence, length);
+    mixAudio(stream, locImfMusBuffer.data(),
+             static_cast<Uint32>(len), gSound.getMusicVolume());
 
     // set udata for next time
     pos+=len;
@@ -296,11 +518,29 @@ void musicFinished()
     locIMFPlayer.close(false);
 }
 
+void rewindIMF()
+{
+    if(locIMFPlayer.playing())
+    {
+        Mix_HookMusic(nullptr, nullptr);
+        locIMFPlayer.rewind();
+        Mix_HookMusic(imfMusicPlayer, &locImfMusPos);
+    }
+}
+
+void suspendIMFProducer()
+{
+    locIMFPlayer.stopProducer();
+}
+
 void unhookAll()
 {
     locImfMusPos = 0;
     Mix_HookMusic(nullptr, nullptr);
     Mix_HookMusicFinished(nullptr);
+
+    // Nobody reads the rendered music anymore
+    suspendIMFProducer();
 }
 
 
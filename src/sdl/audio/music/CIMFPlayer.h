@@ -12,8 +12,11 @@
 #include <base/TypeDefinitions.h>
 #include "sdl/audio/Audio.h"
 #include "CRingBuffer.h"
+#include "CPCMRingBuffer.h"
 #include <SDL.h>
 #include <string>
+#include <vector>
+#include <atomic>
 
 #include <SDL_mixer.h>
 
@@ -24,11 +27,31 @@ struct IMFChunkType
 	word Delay;
 };
 
+struct ThreadPoolItem;
+
+/**
+ * Control messages for the producer thread. Every message gets a sequence number,
+ * which is published through the PCM ring once the producer has handled it.
+ */
+enum class IMFControl
+{
+    FLUSH,  // Drop everything rendered so far
+    REWIND  // Play the track from the start again
+};
+
+struct IMFControlMsg
+{
+    unsigned int seq;
+    IMFControl type;
+};
+
 class CIMFPlayer : public CMusicPlayer
 {
 public:
     CIMFPlayer( COPLEmulator& opl_emulator = gSound.getOPLEmulatorRef());
 
+    ~CIMFPlayer();
+
 
 	/**
 	 * \brief 	This function will load music using other dictionaries which are embedded in the Exe File.
@@ -41,13 +64,49 @@ public:
 
     bool open(const bool lock);
     void close(const bool lock);
+
+    /**
+     * \brief  Called from the audio callback. If the producer thread runs,
+     *          this only copies the rendered samples from the PCM ring,
+     *          otherwise the OPL emulator is run right here.
+     */
 	void readBuffer(Uint8* buffer, Uint32 length);
 
+    /**
+     * \brief  Generates the next length bytes of the track in the audio format of the driver.
+     *          Either called by the producer thread or by readBuffer() when there is none.
+     */
+    void renderBuffer(Uint8* buffer, Uint32 length);
+
+    /**
+     * \brief  Plays the track from the start again. Restarts a suspended producer.
+     */
+    void rewind();
+
+    /**
+     * \brief  Starts the thread that renders ahead of the audio callback.
+     *          Does nothing if no latency target is set or there is no thread pool.
+     */
+    void startProducer();
+
+    /**
+     * \brief  Stops the producer thread and waits for it.
+     *          Audio already rendered is flushed.
+     */
+    void stopProducer();
+
+    /**
+     * \brief  Main loop of the producer thread
+     */
+    void produce();
 
     bool loadMusicTrack(const int track) override;
 
 private:
 
+    void postControl(const IMFControl type);
+    void processControls();
+
 		
     bool unpackAudioInterval(const std::string &dataPath,
                 const std::vector<uint8_t> &AudioCompFileData,
@@ -61,6 +120,24 @@ private:
     Uint32 m_samplesPerMusicTick =0;
     unsigned int m_IMFDelay = 0;
     std::vector<Sint32> mMixBuffer;
+
+    // Producer thread and its PCM ring. The audio callback only ever reads from mPCMRing.
+    PCMRingBuffer mPCMRing;
+    ThreadPoolItem *mpProducer = nullptr;
+    std::atomic<bool> mProducerRunning{false};
+    bool mProducerQuit = false;
+
+    // Guards the control queue and the quit flag, the producer sleeps on mpProducerWake
+    SDL_mutex *mpControlMutex = nullptr;
+    SDL_cond *mpProducerWake = nullptr;
+    std::vector<IMFControlMsg> mControlQueue;
+    unsigned int mControlSeq = 0;
+
+    size_t mTargetFill = 0;     // Bytes the producer tries to keep ahead
+    size_t mChunkSize = 0;      // Bytes rendered per pass of the producer
+    Uint32 mProducerWaitMs = 1;
+
+    std::atomic<unsigned int> mUnderruns{0};
 };
 
 
@@ -95,6 +172,18 @@ void imfMusicPlayer(void *udata,
  */
 void musicFinished();
 
+/**
+ * @brief rewindIMF Plays the current IMF track from the start again
+ */
+void rewindIMF();
+
+/**
+ * @brief suspendIMFProducer    Stops rendering ahead while the audio device is going down,
+ *                              so the OPL emulator can be shut down safely.
+ *                              Rewinding or loading a track starts it again.
+ */
+void suspendIMFProducer();
+
 
 
 /**
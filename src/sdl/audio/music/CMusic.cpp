@@ -111,6 +111,7 @@ void CMusic::reload()
     gSound.pauseAudio();
 
     Mix_RewindMusic();
+    rewindIMF();
 
     gSound.resumeAudio();
 }
@@ -0,0 +1,146 @@
+/*
+ * CPCMRingBuffer.h
+ *
+ *  Ring of rendered PCM bytes handed from exactly one producer thread to
+ *  exactly one consumer (the audio callback).
+ *
+ *  The producer only moves the write position and the consumer only the
+ *  read position, so neither side has to lock. Both positions are counters
+ *  which only grow, the offset into the buffer is taken modulo its size.
+ *
+ *  Flushing works with sequence numbers: the producer remembers where the
+ *  data of a new sequence starts and publishes the number afterwards.
+ *  When the consumer sees a number it hasn't handled yet, it skips
+ *  everything in front of that position. That way stale audio of a
+ *  stopped or changed track is never played after the new one.
+ */
+
+#ifndef CPCMRINGBUFFER_H_
+#define CPCMRINGBUFFER_H_
+
+#include <SDL.h>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+class PCMRingBuffer
+{
+public:
+
+    /**
+     * @brief reset Allocates the ring and drops all its data.
+     *              Must only be called while neither producer nor consumer uses it.
+     */
+    void reset(const size_t capacity)
+    {
+        mData.assign(capacity, 0);
+        mReadPos.store(0);
+        mWritePos.store(0);
+        mFlushPos.store(0);
+        mFlushSeq.store(0);
+        mSeenFlushSeq = 0;
+    }
+
+    size_t capacity() const
+    {   return mData.size();    }
+
+    /**
+     * @brief fill  Number of bytes not read yet. May be used by either side.
+     */
+    size_t fill() const
+    {
+        return mWritePos.load(std::memory_order_acquire) -
+               mReadPos.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief write     Producer side: Appends up to len bytes.
+     * @return          Number of bytes which really fitted in
+     */
+    size_t write(const Uint8 *data, const size_t len)
+    {
+        if(mData.empty())
+            return 0;
+
+        const size_t w = mWritePos.load(std::memory_order_relaxed);
+        const size_t r = mReadPos.load(std::memory_order_acquire);
+        const size_t n = std::min(len, mData.size() - (w-r));
+
+        copyIn(w, data, n);
+
+        mWritePos.store(w+n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief publishFlush  Producer side: Everything written before this call
+     *                      belongs to older sequences and will be skipped
+     *                      by the consumer once it sees seq.
+     */
+    void publishFlush(const unsigned int seq)
+    {
+        // Released, so a consumer seeing this position also sees the data in front of it
+        mFlushPos.store(mWritePos.load(std::memory_order_relaxed),
+                        std::memory_order_release);
+        mFlushSeq.store(seq, std::memory_order_release);
+    }
+
+    /**
+     * @brief read  Consumer side: Takes up to len bytes.
+     * @return      Number of bytes copied to data
+     */
+    size_t read(Uint8 *data, const size_t len)
+    {
+        if(mData.empty())
+            return 0;
+
+        size_t r = mReadPos.load(std::memory_order_relaxed);
+
+        const unsigned int seq = mFlushSeq.load(std::memory_order_acquire);
+        if(seq != mSeenFlushSeq)
+        {
+            // Only skip forward, a newer flush might already be further ahead
+            r = std::max(r, mFlushPos.load(std::memory_order_acquire));
+            mSeenFlushSeq = seq;
+        }
+
+        const size_t w = mWritePos.load(std::memory_order_acquire);
+        const size_t n = std::min(len, w-r);
+
+        copyOut(r, data, n);
+
+        mReadPos.store(r+n, std::memory_order_release);
+        return n;
+    }
+
+private:
+
+    void copyIn(const size_t pos, const Uint8 *data, const size_t len)
+    {
+        const size_t offset = pos % mData.size();
+        const size_t first = std::min(len, mData.size()-offset);
+        memcpy(&mData[offset], data, first);
+        memcpy(&mData[0], data+first, len-first);
+    }
+
+    void copyOut(const size_t pos, Uint8 *data, const size_t len) const
+    {
+        const size_t offset = pos % mData.size();
+        const size_t first = std::min(len, mData.size()-offset);
+        memcpy(data, &mData[offset], first);
+        memcpy(data+first, &mData[0], len-first);
+    }
+
+    std::vector<Uint8> mData;
+
+    std::atomic<size_t> mReadPos{0};
+    std::atomic<size_t> mWritePos{0};
+    std::atomic<size_t> mFlushPos{0};
+    std::atomic<unsigned int> mFlushSeq{0};
+
+    // Only touched by the consumer
+    unsigned int mSeenFlushSeq = 0;
+};
+
+#endif /* CPCMRINGBUFFER_H_ */
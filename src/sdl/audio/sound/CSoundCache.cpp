@@ -0,0 +1,236 @@
+/*
+ * CSoundCache.cpp
+ *
+ *  File layout, all values in native byte order:
+ *
+ *  CacheHeader
+ *  CacheEntry[numSounds]
+ *  waveforms, every one at a 16-byte aligned offset
+ */
+
+#include "CSoundCache.h"
+#include "fileio/crc.h"
+#include <base/utils/FindFile.h>
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+namespace
+{
+
+const char CACHE_MAGIC[4] = { 'C', 'G', 'S', 'C' };
+
+// Layout of the file itself, not of its content
+const Uint32 CACHE_LAYOUT_VERSION = 2;
+
+const size_t CACHE_ALIGN = 16;
+
+struct CacheHeader
+{
+    char magic[4];
+    Uint32 layoutVersion;
+    SoundCacheKey key;
+    Uint32 numSounds;
+    Uint32 payloadSize;
+    Uint32 contentCrc;      // Everything after the header, index and waveforms
+};
+
+struct CacheEntry
+{
+    Uint32 offset;
+    Uint32 length;
+    Uint16 priority;
+    Uint16 read;
+};
+
+size_t alignUp(const size_t value)
+{
+    return (value + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1);
+}
+
+}
+
+
+bool SoundCacheKey::operator==(const SoundCacheKey &other) const
+{
+    return audioCrc == other.audioCrc &&
+           hedCrc == other.hedCrc &&
+           dictCrc == other.dictCrc &&
+           freq == other.freq &&
+           format == other.format &&
+           channels == other.channels &&
+           synthVersion == other.synthVersion;
+}
+
+
+CSoundCache::CSoundCache(const SoundCacheKey &key) :
+mKey(key)
+{}
+
+
+Uint32 CSoundCache::checksum(const void *data, const size_t len)
+{
+    // The launcher sets up the table too, but the game may have been started without it
+    static const bool tableReady = (crc32_init(), true);
+    (void) tableReady;
+
+    const size_t bulk = len & ~size_t(3);
+
+    // The tail is zero padded and folded in together with the length,
+    // so data only differing in trailing zeros still gives different sums.
+    Uint32 tail[3] = { 0, 0, Uint32(len) };
+    memcpy(&tail[1], static_cast<const Uint8*>(data) + bulk, len - bulk);
+
+    if(bulk > 0)
+    {
+        tail[0] = getcrc32(static_cast<unsigned char*>(const_cast<void*>(data)), int(bulk));
+    }
+
+    return getcrc32(reinterpret_cast<unsigned char*>(tail), sizeof(tail));
+}
+
+
+std::string CSoundCache::getFilename() const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "sounds_%08X.dat", mKey.audioCrc);
+    return JoinPaths("cache", name);
+}
+
+
+bool CSoundCache::load(std::vector<CSoundSlot> &slots, std::vector<char> &soundRead) const
+{
+    std::ifstream file;
+    if(!OpenGameFileR(file, getFilename(), std::ios::binary))
+        return false;
+
+    // Read it at once, the waveforms are handed to the slots right out of that buffer
+    file.seekg(0, std::ios::end);
+    const size_t fileSize = size_t(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    if(fileSize < sizeof(CacheHeader))
+        return false;
+
+    std::vector<Uint8> data(fileSize);
+    if(!file.read(reinterpret_cast<char*>(data.data()), fileSize))
+        return false;
+
+    CacheHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    if(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+       header.layoutVersion != CACHE_LAYOUT_VERSION ||
+       !(header.key == mKey) ||
+       header.numSounds != slots.size())
+    {
+        return false;
+    }
+
+    const size_t payloadStart = alignUp(sizeof(CacheHeader) + header.numSounds*sizeof(CacheEntry));
+
+    if(payloadStart + header.payloadSize != fileSize)
+        return false;
+
+    const Uint8 *payload = data.data() + payloadStart;
+
+    if(checksum(data.data() + sizeof(CacheHeader), fileSize - sizeof(CacheHeader)) != header.contentCrc)
+        return false;
+
+    std::vector<CacheEntry> entries(header.numSounds);
+    memcpy(entries.data(), data.data() + sizeof(CacheHeader), entries.size()*sizeof(CacheEntry));
+
+    for(const auto &entry : entries)
+    {
+        if(entry.offset > header.payloadSize ||
+           entry.length > header.payloadSize - entry.offset)
+        {
+            return false;
+        }
+    }
+
+    // Everything checked out, only now touch the slots
+    soundRead.assign(entries.size(), 1);
+
+    for(size_t snd=0 ; snd<entries.size() ; snd++)
+    {
+        const CacheEntry &entry = entries[snd];
+        CSoundSlot &slot = slots[snd];
+
+        slot.priority = entry.priority;
+        soundRead[snd] = char(entry.read);
+
+        if(entry.length > 0)
+        {
+            slot.setupWaveForm(const_cast<Uint8*>(payload + entry.offset), entry.length);
+        }
+    }
+
+    return true;
+}
+
+
+bool CSoundCache::save(const std::vector<CSoundSlot> &slots, const std::vector<char> &soundRead) const
+{
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.layoutVersion = CACHE_LAYOUT_VERSION;
+    header.key = mKey;
+    header.numSounds = Uint32(slots.size());
+
+    std::vector<CacheEntry> entries(slots.size());
+
+    size_t payloadSize = 0;
+    for(size_t snd=0 ; snd<slots.size() ; snd++)
+    {
+        CacheEntry &entry = entries[snd];
+        entry.offset = Uint32(payloadSize);
+        entry.length = slots[snd].getSoundlength();
+        entry.priority = slots[snd].priority;
+        entry.read = (snd < soundRead.size() && soundRead[snd]) ? 1 : 0;
+        payloadSize = alignUp(payloadSize + entry.length);
+    }
+
+    const size_t payloadStart = alignUp(sizeof(CacheHeader) + entries.size()*sizeof(CacheEntry));
+
+    std::vector<Uint8> data(payloadStart + payloadSize, 0);
+    Uint8 *payload = data.data() + payloadStart;
+
+    for(size_t snd=0 ; snd<slots.size() ; snd++)
+    {
+        if(entries[snd].length > 0)
+        {
+            memcpy(payload + entries[snd].offset,
+                   slots[snd].getSoundData(),
+                   entries[snd].length);
+        }
+    }
+
+    memcpy(data.data() + sizeof(header), entries.data(), entries.size()*sizeof(CacheEntry));
+
+    header.payloadSize = Uint32(payloadSize);
+    header.contentCrc = checksum(data.data() + sizeof(header), data.size() - sizeof(header));
+
+    memcpy(data.data(), &header, sizeof(header));
+
+    const std::string filename = getFilename();
+    const std::string tempFilename = filename + ".tmp";
+
+    {
+        std::ofstream file;
+        if(!OpenGameFileW(file, tempFilename, std::ios::binary))
+            return false;
+
+        if(!file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+            return false;
+    }
+
+#ifdef WIN32
+    // rename does not replace existing files there
+    remove(GetWriteFullFileName(filename).c_str());
+#endif
+
+    return rename(GetWriteFullFileName(tempFilename).c_str(),
+                  GetWriteFullFileName(filename, true).c_str()) == 0;
+}
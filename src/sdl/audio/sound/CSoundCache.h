@@ -0,0 +1,81 @@
+/*
+ * CSoundCache.h
+ *
+ *  Keeps the rendered waveforms of the PC Speaker and Adlib sound effects
+ *  on disk, so they don't have to be synthesized again on every start.
+ *
+ *  All waveforms of a game go into one file in the cache directory of the user's
+ *  config path. It starts with a header holding the key, followed by an index
+ *  and the waveforms themselves, each one starting 16-byte aligned. If anything
+ *  in the key differs or the file doesn't check out, it is treated as a miss
+ *  and the sounds are rendered like before.
+ */
+
+#ifndef CSOUNDCACHE_H_
+#define CSOUNDCACHE_H_
+
+#include "CSoundSlot.h"
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+/**
+ * Bump this whenever the generated waveforms change, e.g. because of changes in
+ * generateWave(), readISFintoWaveForm() or the OPL emulator. Old cache files
+ * are ignored then.
+ */
+const Uint32 SOUND_CACHE_SYNTH_VERSION = 1;
+
+/**
+ * Everything the rendered waveforms depend on
+ */
+struct SoundCacheKey
+{
+    Uint32 audioCrc = 0;    // Audio file of the game
+    Uint32 hedCrc = 0;      // Offsets of the sounds in that file
+    Uint32 dictCrc = 0;     // Huffman dictionary the sounds are compressed with
+    Uint32 freq = 0;
+    Uint16 format = 0;
+    Uint16 channels = 0;
+    Uint32 synthVersion = SOUND_CACHE_SYNTH_VERSION;
+
+    bool operator==(const SoundCacheKey &other) const;
+};
+
+
+class CSoundCache
+{
+public:
+
+    CSoundCache(const SoundCacheKey &key);
+
+    /**
+     * @brief load      Sets up the slots from the cache file if it matches the key.
+     * @param slots     Slots to fill. Its size has to match the number of cached sounds.
+     * @param soundRead Receives for every slot whether the sound could be read when it was rendered
+     * @return          true on a hit. On a miss the slots remain untouched.
+     */
+    bool load(std::vector<CSoundSlot> &slots, std::vector<char> &soundRead) const;
+
+    /**
+     * @brief save      Writes the waveforms of all slots into the cache file.
+     *                  The file is written under a temporary name first, so a
+     *                  broken write never leaves a half file behind.
+     * @return          true if the file could be written
+     */
+    bool save(const std::vector<CSoundSlot> &slots, const std::vector<char> &soundRead) const;
+
+    /**
+     * @brief checksum  CRC32 over data of any length, getcrc32() itself only
+     *                  handles multiples of four bytes.
+     */
+    static Uint32 checksum(const void *data, const size_t len);
+
+private:
+
+    std::string getFilename() const;
+
+    SoundCacheKey mKey;
+};
+
+#endif /* CSOUNDCACHE_H_ */
@@ -47,40 +47,34 @@ enum class SoundPlayMode
 class CSoundChannel
 {
 public:
-    CSoundChannel(const SDL_AudioSpec &AudioSpec);
+    /**
+     * \param AudioSpec  Spec of the opened audio device
+     * \param id         Mixer channel this one plays on
+     */
+    CSoundChannel(const SDL_AudioSpec &AudioSpec, const int id);
 
-    CSoundChannel(const CSoundChannel &chnl);
-
-
-    virtual ~CSoundChannel();
+    virtual ~CSoundChannel() {}
 
 	void stopSound();
     bool isPlaying();
     bool isForcedPlaying() { return (isPlaying() && mSoundForced); }
     CSoundSlot *getCurrentSoundPtr() { return mpCurrentSndSlot; }
 
-	/**
-	 * \brief	Reads the sound of a specified slot into the waveform which normally is mixed
-	 * \param	waveform 8-bit data array where the mixform will be written to
-	 * \param	length in bytes that have to be read
-	 * \warning	If there is no sound curently assigned to be played, please don't call that function.
-	 * 			It might crash. Call setupSound first before you call this one!
-	 */
-    //void readWaveform( Uint8 * const waveform, const Uint32 len );
-	template <typename T>
-	void transintoStereoChannels(T* waveform, const Uint32 len);
-
     short getBalance() { return mBalance; }
     void setBalance(short value) { mBalance = value; }
 
 	/**
-	 * \brief	Sets up the slot to play a sound
+	 * \brief	Sets up the slot to play a sound. The balance set before is applied through
+	 * 			the panned copies the slot keeps.
 	 * \param	SndSlottoPlay	Reference to the slot that has to be played
 	 * \param	sound_forced	This will play a sound again even if it's already playing. Use this one wise
+	 * \return	false if the mixer couldn't start the sound
 	 */
-	void setupSound(CSoundSlot &SndSlottoPlay,
+	bool setupSound(CSoundSlot &SndSlottoPlay,
 					const bool sound_forced );
 
+    int getId() const { return mId; }
+
 private:
 
     CSoundSlot *mpCurrentSndSlot = nullptr;		// Pointer to the slot of the currently playing sound
@@ -92,7 +86,6 @@ private:
 
     SDL_AudioSpec m_AudioSpec;
 
-    static int mTotNumChannels;
     int mId = 0;
 };
 
@@ -8,6 +8,7 @@
 #include <string.h>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include "CSoundSlot.h"
 #include <base/GsLogging.h>
 #include "fileio.h"
@@ -84,11 +85,118 @@ void CSoundSlot::unload()
         mSounddata.clear();
     }        
 
+    m_soundlength = 0;
+
     if(mpWaveChunk)
     {
         Mix_FreeChunk(mpWaveChunk);
         mpWaveChunk = nullptr;
     }
+
+    for(auto &chunk : mPannedChunks)
+    {
+        if(chunk)
+        {
+            Mix_FreeChunk(chunk);
+        }
+    }
+
+    mPannedChunks.clear();
+    mPannedData.clear();
+}
+
+
+/**
+ * \brief Applies the balance to an interleaved stereo waveform
+ *  \param waveform	pass it as 8-bit or 16-bit Waveform pointer depeding on what depth you have
+ *  \param len 		length in bytes of the waveform
+ *  \param balance	-255 (left only) to 255 (right only)
+ *  \param silence	value of a silent sample in the waveform's format
+ */
+template <typename T>
+static void panStereoWaveform(T* waveform, const Uint32 len,
+                              const short balance, const Sint32 silence)
+{
+    // The side the sound comes from keeps its full volume, only the other one gets quieter.
+    // That way the center stays as loud as the unpanned chunk.
+    const Uint32 length = len/sizeof(T);
+
+    const Sint32 leftGain = (balance > 0) ? 256 - balance : 256;
+    const Sint32 rightGain = (balance < 0) ? 256 + balance : 256;
+
+    for( Uint32 index = 0 ; index+1 < length ; index += 2 )
+    {
+        const Sint32 left = Sint32(waveform[index]) - silence;
+        const Sint32 right = Sint32(waveform[index+1]) - silence;
+
+        waveform[index] = T( ((left*leftGain) >> 8) + silence );
+        waveform[index+1] = T( ((right*rightGain) >> 8) + silence );
+    }
+}
+
+
+Mix_Chunk *CSoundSlot::getPannedChunk(const short balance, const SDL_AudioSpec &audioSpec)
+{
+    if(audioSpec.channels != 2 || mSounddata.empty())
+    {
+        return mpWaveChunk;
+    }
+
+    const int clamped = std::max(-255, std::min(255, int(balance)));
+    const int bucket = (clamped + 255 + PAN_STEP/2) / PAN_STEP;
+    const int bucketBalance = std::max(-255, std::min(255, bucket*PAN_STEP - 256));
+
+    if(bucketBalance == 0)
+    {
+        return mpWaveChunk;
+    }
+
+    if(mPannedChunks.empty())
+    {
+        // Sized once, so the data of the chunks made before never moves
+        mPannedChunks.assign(PAN_BUCKETS, nullptr);
+        mPannedData.resize(PAN_BUCKETS);
+    }
+
+    if(!mPannedChunks[bucket])
+    {
+        std::vector<Uint8> &data = mPannedData[bucket];
+        data = mSounddata;
+
+        switch(audioSpec.format)
+        {
+        case AUDIO_S16:
+            panStereoWaveform(reinterpret_cast<Sint16*>(data.data()), Uint32(data.size()),
+                              short(bucketBalance), 0);
+            break;
+        case AUDIO_U16:
+            panStereoWaveform(reinterpret_cast<Uint16*>(data.data()), Uint32(data.size()),
+                              short(bucketBalance), 0x8000);
+            break;
+        case AUDIO_S8:
+            panStereoWaveform(reinterpret_cast<Sint8*>(data.data()), Uint32(data.size()),
+                              short(bucketBalance), 0);
+            break;
+        case AUDIO_U8:
+            panStereoWaveform(data.data(), Uint32(data.size()),
+                              short(bucketBalance), 0x80);
+            break;
+        default:
+            // Other sample formats aren't converted, those play centered
+            data.clear();
+            return mpWaveChunk;
+        }
+
+        mPannedChunks[bucket] = Mix_QuickLoad_RAW(data.data(), Uint32(data.size()));
+
+        if(!mPannedChunks[bucket])
+        {
+            gLogging.ftextOut("Mix_QuickLoad_RAW: %s\n", Mix_GetError());
+            return mpWaveChunk;
+        }
+    }
+
+    return mPannedChunks[bucket];
 }
 
 
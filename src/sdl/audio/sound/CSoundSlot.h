@@ -15,6 +15,10 @@
 
 #include <SDL_mixer.h>
 
+// Balance steps for which panned copies of a sound are made
+const int PAN_STEP = 32;
+const int PAN_BUCKETS = (2*256)/PAN_STEP + 1;
+
 class CSoundSlot
 {
 public:
@@ -36,10 +40,25 @@ public:
         return mSounddata.data();
     }
 
+    const byte *getSoundData() const
+    {
+        return mSounddata.data();
+    }
+
     auto WaveChunk()
     {
         return mpWaveChunk;
     }
+
+    /**
+     * @brief getPannedChunk    Chunk of this sound with the balance applied, -255 (left) to 255 (right).
+     *                          The balance is rounded to steps of PAN_STEP and every panned copy is
+     *                          made only once, so further plays don't have to convert anything.
+     *                          The side the sound comes from keeps its full volume.
+     *                          Without stereo, for the center or for other formats than
+     *                          8 and 16 bit integers the plain chunk is returned.
+     */
+    Mix_Chunk *getPannedChunk(const short balance, const SDL_AudioSpec &audioSpec);
 	
 	word priority;
 
@@ -50,6 +69,10 @@ private:
     int mOggFreq;
 
     Mix_Chunk *mpWaveChunk = nullptr;
+
+    // Panned copies of the waveform, one per balance step, made when first needed
+    std::vector< std::vector<Uint8> > mPannedData;
+    std::vector<Mix_Chunk*> mPannedChunks;
 };
 
 #endif /* CSOUNDSLOT_H_ */
@@ -0,0 +1,114 @@
+/*
+ * CVoiceAllocator.cpp
+ */
+
+#include "CVoiceAllocator.h"
+
+#include <algorithm>
+
+
+void CVoiceAllocator::reset(const unsigned int numVoices)
+{
+    mVoices.assign(numVoices, Voice());
+    mSlotVoices.clear();
+    mSerial = 0;
+
+    // Lowest voices are handed out first
+    mFreeVoices.clear();
+    for(int voice = int(numVoices)-1 ; voice >= 0 ; voice--)
+    {
+        mFreeVoices.push_back(voice);
+    }
+}
+
+
+int CVoiceAllocator::allocate(const unsigned int slot, const int priority, bool &stolen)
+{
+    int voice = -1;
+    stolen = false;
+
+    if(!mFreeVoices.empty())
+    {
+        voice = mFreeVoices.back();
+        mFreeVoices.pop_back();
+    }
+    else
+    {
+        // Everything is busy. Take the least important voice, which has been playing the longest
+        for(int i=0 ; i<int(mVoices.size()) ; i++)
+        {
+            const Voice &candidate = mVoices[i];
+
+            if(candidate.priority > priority)
+                continue;
+
+            if(voice < 0 ||
+               candidate.priority < mVoices[voice].priority ||
+               (candidate.priority == mVoices[voice].priority &&
+                Sint32(candidate.serial - mVoices[voice].serial) < 0))
+            {
+                voice = i;
+            }
+        }
+
+        if(voice < 0)
+            return -1;
+
+        unlinkFromSlot(voice);
+        stolen = true;
+    }
+
+    Voice &chosen = mVoices[voice];
+    chosen.slot = slot;
+    chosen.priority = priority;
+    chosen.serial = mSerial++;
+    chosen.active = true;
+
+    if(slot >= mSlotVoices.size())
+    {
+        mSlotVoices.resize(slot+1);
+    }
+
+    mSlotVoices[slot].push_back(voice);
+
+    return voice;
+}
+
+
+void CVoiceAllocator::release(const int voice)
+{
+    if(voice < 0 || voice >= int(mVoices.size()))
+        return;
+
+    if(!mVoices[voice].active)
+        return;
+
+    unlinkFromSlot(voice);
+    mVoices[voice].active = false;
+    mFreeVoices.push_back(voice);
+}
+
+
+const std::vector<int> &CVoiceAllocator::getVoicesOf(const unsigned int slot) const
+{
+    static const std::vector<int> noVoices;
+
+    if(slot >= mSlotVoices.size())
+        return noVoices;
+
+    return mSlotVoices[slot];
+}
+
+
+void CVoiceAllocator::unlinkFromSlot(const int voice)
+{
+    // Those lists only hold the few voices of one sound
+    std::vector<int> &voices = mSlotVoices[mVoices[voice].slot];
+    auto it = std::find(voices.begin(), voices.end(), voice);
+
+    if(it != voices.end())
+    {
+        *it = voices.back();
+        voices.pop_back();
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * CVoiceAllocator.h
+ *
+ *  Keeps track which mixer channel (voice) plays which sound slot,
+ *  so neither a free voice nor the voices of a sound have to be searched.
+ *
+ *  Free voices are kept on a stack. For every slot there is a small list of
+ *  the voices playing it. Only when every voice is busy the allocator looks
+ *  at all of them to find one it may steal.
+ *
+ *  It only does the bookkeeping, starting and halting the channels is up to the caller.
+ */
+
+#ifndef CVOICEALLOCATOR_H_
+#define CVOICEALLOCATOR_H_
+
+#include <SDL.h>
+#include <vector>
+
+class CVoiceAllocator
+{
+public:
+
+    /**
+     * @brief reset Forgets all voices and makes numVoices of them available
+     */
+    void reset(const unsigned int numVoices);
+
+    /**
+     * @brief allocate  Gets a voice to play slot on.
+     *                  A free voice is taken if there is one. Otherwise the voice
+     *                  playing with the lowest priority is stolen, the one started first
+     *                  if several have that priority. Voices with a higher priority
+     *                  than the new sound are never stolen.
+     * @param slot      slot which is going to be played
+     * @param priority  priority of that slot
+     * @param stolen    set to true if the returned voice was still playing something else
+     * @return          voice to use or -1 if none can be given
+     */
+    int allocate(const unsigned int slot, const int priority, bool &stolen);
+
+    /**
+     * @brief release   Returns a voice to the free ones. Does nothing if it wasn't in use.
+     */
+    void release(const int voice);
+
+    bool isActive(const int voice) const
+    {   return mVoices[voice].active;   }
+
+    /**
+     * @brief getVoicesOf   Voices currently playing slot
+     */
+    const std::vector<int> &getVoicesOf(const unsigned int slot) const;
+
+    unsigned int numVoices() const
+    {   return mVoices.size();  }
+
+    unsigned int numFreeVoices() const
+    {   return mFreeVoices.size();  }
+
+private:
+
+    struct Voice
+    {
+        unsigned int slot = 0;
+        int priority = 0;
+        Uint32 serial = 0;      // When the voice was taken, tells the older ones apart
+        bool active = false;
+    };
+
+    void unlinkFromSlot(const int voice);
+
+    std::vector<Voice> mVoices;
+    std::vector<int> mFreeVoices;
+    std::vector< std::vector<int> > mSlotVoices;
+    Uint32 mSerial = 0;
+};
+
+#endif /* CVOICEALLOCATOR_H_ */
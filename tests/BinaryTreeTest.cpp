@@ -0,0 +1,209 @@
+/*
+ * BinaryTreeTest.cpp
+ *
+ *  Round trip of property trees through the binary savegame format, and rejection of damaged ones
+ */
+
+#include "UnitTest.h"
+
+#include <fileio/BinaryTree.h>
+#include <base/utils/Base64.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using boost::property_tree::ptree;
+
+namespace
+{
+
+struct Random
+{
+    unsigned int seed = 815;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// Shaped like a Galaxy savegame: attributes, repeated keys, numbers, raw planes
+ptree makeTree(const size_t planeSize, const int numSprites)
+{
+    ptree pt;
+    pt.put("GameState.<xmlattr>.name", "L7-Sat Oct 17");
+    pt.put("GameState.Level.<xmlattr>.level", 7);
+    pt.put("GameState.Level.Map.width", 92);
+    pt.put("GameState.Level.Map.height", 60);
+
+    Random rnd;
+    std::vector<word> plane(planeSize/2);
+    for(word &tile : plane)
+        tile = word(rnd.next() % 8 == 0 ? rnd.next() : 0);
+    // NULs and every other byte value have to survive
+    putRawValue(pt.put("GameState.Level.Map.bgdata", ""), plane.data(), planeSize);
+
+    for(int i=0 ; i<numSprites ; i++)
+    {
+        ptree &sprite = pt.add("GameState.Level.Sprite", "");
+        sprite.put("<xmlattr>.id", rnd.next() % 300);
+        sprite.put("x", rnd.next() % 100000);
+        sprite.put("y", rnd.next() % 100000);
+        sprite.put("dead", (i % 3) == 0);
+    }
+
+    pt.put("GameState.Player.Inventory.Items.<xmlattr>.score", 123456);
+    pt.put("GameState.Empty", "");
+    return pt;
+}
+
+std::string writeTree(const ptree &pt, const bool deflate)
+{
+    std::ostringstream out(std::ios::binary);
+    CHECK(writeBinaryTree(out, pt, deflate));
+    return out.str();
+}
+
+bool readTree(const std::string &data, ptree &pt)
+{
+    std::istringstream in(data, std::ios::binary);
+    return readBinaryTree(in, pt);
+}
+
+void testRoundTrip()
+{
+    const size_t planeSizes[] = { 0, 2, 92*60*2, 300*300*2 };
+    const int spriteCounts[] = { 0, 1, 500 };
+
+    for(const size_t planeSize : planeSizes)
+    {
+        for(const int numSprites : spriteCounts)
+        {
+            const ptree pt = makeTree(planeSize, numSprites);
+
+            for(const bool deflate : { false, true })
+            {
+                const std::string data = writeTree(pt, deflate);
+
+                ptree loaded;
+                CHECK(readTree(data, loaded));
+                CHECK(loaded == pt);
+
+                std::vector<byte> plane;
+                CHECK(getRawValue(loaded.get_child("GameState.Level.Map.bgdata"), planeSize, plane));
+                CHECK_EQ(loaded.get<int>("GameState.Level.Map.width"), 92);
+                CHECK_EQ(loaded.count("GameState"), size_t(1));
+                CHECK_EQ(loaded.get_child("GameState.Level").count("Sprite"), size_t(numSprites));
+            }
+        }
+    }
+
+    // Big trees get deflated
+    const ptree pt = makeTree(300*300*2, 500);
+    CHECK(writeTree(pt, true).size() < writeTree(pt, false).size()/2);
+}
+
+void testDetection()
+{
+    std::istringstream binary(writeTree(makeTree(16, 2), true), std::ios::binary);
+    CHECK(isBinaryTree(binary));
+    // The stream is where it was
+    CHECK_EQ(int(binary.tellg()), 0);
+
+    std::istringstream xml("<?xml version=\"1.0\"?><GameState/>");
+    CHECK(!isBinaryTree(xml));
+
+    std::istringstream empty("");
+    CHECK(!isBinaryTree(empty));
+}
+
+// A tree cut off anywhere or with any byte changed doesn't load.
+// In a deflated one the checksum of zlib catches every change, only the
+// padding bits at the end of the stream may flip without harm.
+// An uncompressed one may still decode to a tree but must not crash.
+void testDamagedData()
+{
+    const ptree pt = makeTree(20*12*2, 20);
+
+    for(const bool deflate : { false, true })
+    {
+        const std::string good = writeTree(pt, deflate);
+
+        size_t accepted = 0;
+        for(size_t len=0 ; len<good.size() ; len++)
+        {
+            ptree loaded;
+            if(readTree(good.substr(0, len), loaded))
+                accepted++;
+            else
+                CHECK(loaded.empty());
+        }
+        CHECK_EQ(accepted, size_t(0));
+
+        accepted = 0;
+        for(size_t pos=0 ; pos<good.size() ; pos += 3)
+        {
+            std::string bad(good);
+            bad[pos] ^= 0x20;
+
+            ptree loaded;
+            if(readTree(bad, loaded) && !(loaded == pt))
+                accepted++;
+        }
+
+        if(deflate)
+            CHECK_EQ(accepted, size_t(0));
+    }
+}
+
+// A plane has to fit the level exactly, a shorter or longer one isn't restored
+void testPlaneSize()
+{
+    const size_t mapSize = 92*60*2;
+    const std::vector<word> plane(mapSize/2, 0x1234);
+
+    ptree node;
+    putRawValue(node, plane.data(), mapSize);
+
+    std::vector<byte> loaded;
+    CHECK(getRawValue(node, mapSize, loaded));
+    CHECK(loaded == std::vector<byte>(reinterpret_cast<const byte*>(plane.data()),
+                                      reinterpret_cast<const byte*>(plane.data())+mapSize));
+
+    // Stored for a different level
+    CHECK(!getRawValue(node, mapSize + 2, loaded));
+    CHECK(!getRawValue(node, mapSize - 2, loaded));
+
+    // Cut off, like in a damaged XML savegame
+    ptree truncated;
+    putRawValue(truncated, plane.data(), mapSize - 1);
+    CHECK(!getRawValue(truncated, mapSize, loaded));
+
+    // XML savegames hold the planes base64 encoded
+    std::vector<byte> bytes(reinterpret_cast<const byte*>(plane.data()),
+                            reinterpret_cast<const byte*>(plane.data())+mapSize);
+    ptree encoded;
+    encoded.data() = base64Encode(bytes);
+    CHECK(getRawValue(encoded, mapSize, loaded));
+    CHECK(loaded == bytes);
+
+    encoded.data() = base64Encode(bytes.data(), mapSize - 6);
+    CHECK(!getRawValue(encoded, mapSize, loaded));
+
+    encoded.data() = "not*base64!";
+    CHECK(!getRawValue(encoded, mapSize, loaded));
+}
+
+}
+
+int main()
+{
+    testRoundTrip();
+    testDetection();
+    testDamagedData();
+    testPlaneSize();
+
+    return TEST_RESULT();
+}
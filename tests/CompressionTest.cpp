@@ -0,0 +1,313 @@
+/*
+ * CompressionTest.cpp
+ *
+ *  LZ decoder of the Vorticon graphics, the RLE(W) expansion of the maps
+ *  and the search for the Huffman dictionaries in the executables
+ */
+
+#include "UnitTest.h"
+
+#include <fileio/lz.h>
+#include <fileio/compression/CRLE.h>
+#include <fileio/compression/CHuffman.h>
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Only the signature search of CHuffman is tested, it needs neither files nor a read executable
+bool OpenGameFileR(std::ifstream&, const std::string&, std::ios_base::openmode)
+{
+    return false;
+}
+
+const std::vector<size_t>& CExeFile::getDictSignatureOffsets() const
+{
+    static const std::vector<size_t> none;
+    return none;
+}
+
+
+namespace
+{
+
+const unsigned int MAX_CODE_BITS = 12;
+const unsigned int EOF_CODE = 257;
+
+// Longest dictionary string the decoder keeps
+const size_t MAX_STRING_LEN = 60;
+
+
+struct BitWriter
+{
+    std::vector<unsigned char> bytes;
+    unsigned int acc = 0;
+    int bits = 0;
+
+    void put(const unsigned int code, const unsigned int width)
+    {
+        for(int b=int(width)-1 ; b>=0 ; b--)
+        {
+            acc = (acc << 1) | ((code >> b) & 1);
+            if(++bits == 8)
+            {
+                bytes.push_back((unsigned char)(acc));
+                acc = 0;
+                bits = 0;
+            }
+        }
+    }
+
+    void flush()
+    {
+        if(bits)
+            bytes.push_back((unsigned char)(acc << (8-bits)));
+        acc = 0;
+        bits = 0;
+    }
+};
+
+
+/**
+ * Encodes like the original tools did: a 4 byte size, the maximum code width
+ * and then variable width codes, starting at 9 bits, finished by the EOF code.
+ */
+std::vector<unsigned char> lzCompress(const std::string &input)
+{
+    std::map<std::string, unsigned int> dict;
+    for(unsigned int i=0 ; i<256 ; i++)
+        dict[std::string(1, char(i))] = i;
+
+    const unsigned int maxDictSize = (1u << MAX_CODE_BITS) + 1;
+
+    BitWriter out;
+    for(int i=0 ; i<4 ; i++)
+        out.bytes.push_back((unsigned char)(input.size() >> (8*i)));
+    out.bytes.push_back((unsigned char)(MAX_CODE_BITS));
+    out.bytes.push_back(0);
+
+    // Tracks the code width the same way the decoder does
+    unsigned int width = 9;
+    unsigned int decoderIndex = 258;
+    unsigned int maxIndex = 511;
+    unsigned int emitted = 0;
+    bool decoderAdds = true;
+
+    auto emit = [&](const unsigned int code)
+    {
+        emitted++;
+        out.put(code, width);
+
+        if(emitted >= 2 && decoderAdds)
+        {
+            decoderIndex++;
+            if(decoderIndex >= maxIndex)
+            {
+                if(width < MAX_CODE_BITS)
+                {
+                    width++;
+                    maxIndex = (1u << width) - 1;
+                }
+                else if(decoderIndex >= maxDictSize-1)
+                {
+                    decoderAdds = false;
+                }
+            }
+        }
+    };
+
+    unsigned int next = 258;
+    bool encoderAdds = true;
+    std::string cur;
+
+    for(const char c : input)
+    {
+        const std::string candidate = cur + c;
+        if(dict.count(candidate))
+        {
+            cur = candidate;
+            continue;
+        }
+
+        emit(dict[cur]);
+
+        if(encoderAdds && next < maxDictSize && candidate.size() < MAX_STRING_LEN)
+            dict[candidate] = next++;
+        else
+            encoderAdds = false;
+
+        cur = std::string(1, c);
+    }
+
+    if(!cur.empty())
+        emit(dict[cur]);
+
+    out.put(EOF_CODE, width);
+    out.flush();
+
+    return out.bytes;
+}
+
+
+bool lzDecompress(const std::vector<unsigned char> &compressed,
+                  std::vector<unsigned char> &output,
+                  size_t outlen = 0)
+{
+    if(outlen == 0)
+        outlen = output.size();
+
+    FILE *file = tmpfile();
+    if(!file)
+        return false;
+
+    fwrite(compressed.data(), 1, compressed.size(), file);
+    rewind(file);
+
+    const bool ok = (lz_decompress(file, output.data(), outlen) == 0);
+    fclose(file);
+
+    return ok;
+}
+
+
+std::string pseudoRandom(const size_t len, const unsigned int alphabet, unsigned int seed)
+{
+    std::string str;
+    for(size_t i=0 ; i<len ; i++)
+    {
+        seed = seed*1103515245u + 12345u;
+        str += char((seed >> 16) % alphabet);
+    }
+    return str;
+}
+
+}
+
+
+static void testLzRoundTrip()
+{
+    const std::string inputs[] =
+    {
+        "A",
+        "TOBEORNOTTOBEORTOBEORNOT",
+        std::string(5000, 'x'),
+        pseudoRandom(20000, 4, 1),      // fills the dictionary and widens the codes up to 12 bits
+        pseudoRandom(30000, 256, 2)
+    };
+
+    for(const std::string &input : inputs)
+    {
+        std::vector<unsigned char> output(input.size(), 0);
+
+        CHECK( lzDecompress(lzCompress(input), output) );
+        CHECK( memcmp(output.data(), input.data(), input.size()) == 0 );
+    }
+}
+
+
+static void testLzBoundsAndErrors()
+{
+    const std::string input = pseudoRandom(4000, 8, 3);
+    std::vector<unsigned char> compressed = lzCompress(input);
+
+    // Never writes beyond the given output length
+    std::vector<unsigned char> output(1000+16, 0xAA);
+    lzDecompress(compressed, output, 1000);
+    CHECK( memcmp(output.data(), input.data(), 1000) == 0 );
+    CHECK( output[1000] == 0xAA && output[1000+15] == 0xAA );
+
+    // A stream cut off before its EOF code stops at its end
+    std::vector<unsigned char> full(input.size(), 0);
+    compressed.resize(compressed.size()/2);
+    CHECK( lzDecompress(compressed, full) );
+    CHECK( memcmp(full.data(), input.data(), 1000) == 0 );
+
+    // Unsupported code width
+    compressed = lzCompress(input);
+    compressed[4] = 20;
+    CHECK( !lzDecompress(compressed, full) );
+
+    // Not even a header
+    CHECK( !lzDecompress(std::vector<unsigned char>(3, 0), full) );
+}
+
+
+static void testRlewExpand()
+{
+    const word key = 0xFEFE;
+
+    // Size in bytes, big endian words, one run of four
+    std::vector<byte> src = { 0x00, 0x0C,
+                              0x12, 0x34,
+                              0xFE, 0xFE, 0x00, 0x04, 0xAB, 0xCD,
+                              0x56, 0x78 };
+    std::vector<word> dst;
+
+    CRLE rle;
+    rle.expand(dst, src, key);
+
+    const std::vector<word> expected = { 0x1234, 0xABCD, 0xABCD, 0xABCD, 0xABCD, 0x5678 };
+    CHECK( dst == expected );
+
+    // Same with little endian words
+    std::vector<byte> swapped = { 0x0C, 0x00,
+                                  0x34, 0x12,
+                                  0xFE, 0xFE, 0x04, 0x00, 0xCD, 0xAB,
+                                  0x78, 0x56 };
+    dst.clear();
+    rle.expandSwapped(dst, swapped, key);
+    CHECK( dst == expected );
+}
+
+
+static void testDictionarySignatures()
+{
+    const std::vector<byte> sig = { 0xFD, 0x01, 0x00, 0x00, 0x00, 0x00 };
+
+    // No match, also not for a signature missing its last byte or a buffer shorter than one
+    std::vector<byte> data(300, 0xFD);
+    data.insert(data.begin()+100, sig.begin(), sig.end()-1);
+    CHECK( CHuffman::findDictionarySignatures(data.data(), data.size()).empty() );
+    CHECK( CHuffman::findDictionarySignatures(sig.data(), sig.size()-1).empty() );
+    CHECK( CHuffman::findDictionarySignatures(data.data(), 0).empty() );
+
+    // Several matches in ascending order. The 0xFD before each one is a false start.
+    data.assign(1000, 0x00);
+    const size_t places[] = { 0, 17, 24, 511 };
+    for(const size_t place : places)
+    {
+        std::copy(sig.begin(), sig.end(), data.begin()+place);
+        if(place > 0)
+            data[place-1] = 0xFD;
+    }
+
+    const std::vector<size_t> expected(std::begin(places), std::end(places));
+    CHECK( CHuffman::findDictionarySignatures(data.data(), data.size()) == expected );
+
+    // A match right at the end of the buffer counts, one cut off by the end doesn't
+    data.assign(64, 0x11);
+    std::copy(sig.begin(), sig.end(), data.end()-sig.size());
+    std::vector<size_t> offsets = CHuffman::findDictionarySignatures(data.data(), data.size());
+    CHECK_EQ( offsets.size(), size_t(1) );
+    CHECK( !offsets.empty() && offsets[0] == data.size()-sig.size() );
+
+    offsets = CHuffman::findDictionarySignatures(data.data(), data.size()-1);
+    CHECK( offsets.empty() );
+
+    // The whole buffer being one signature
+    offsets = CHuffman::findDictionarySignatures(sig.data(), sig.size());
+    CHECK_EQ( offsets.size(), size_t(1) );
+}
+
+
+int main()
+{
+    testLzRoundTrip();
+    testLzBoundsAndErrors();
+    testRlewExpand();
+    testDictionarySignatures();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,346 @@
+/*
+ * EventTest.cpp
+ *
+ *  Dispatch order of the event subscriptions, (un)subscribing while dispatching,
+ *  and the time 100k mixed events take to dispatch
+ */
+
+#include "UnitTest.h"
+
+#include <base/GsEvent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct NumberEvent : CEvent
+{
+    NumberEvent(const int n) : number(n) {}
+    int number;
+};
+
+struct OtherEvent : CEvent
+{};
+
+struct DerivedNumberEvent : NumberEvent
+{
+    DerivedNumberEvent(const int n) : NumberEvent(n) {}
+};
+
+struct RecordingSink : GsEventSink
+{
+    std::vector<std::string> *log;
+
+    void pumpEvent(const CEvent *ev)
+    {
+        if(const NumberEvent *num = dynamic_cast<const NumberEvent*>(ev))
+            log->push_back("sink" + std::to_string(num->number));
+    }
+};
+
+// Events in the order added, handlers in the order subscribed, sinks last
+void testOrder()
+{
+    CEventContainer events;
+    std::vector<std::string> log;
+
+    const auto first = events.subscribe<NumberEvent>([&](const NumberEvent &ev)
+    {   log.push_back("a" + std::to_string(ev.number));   });
+    const auto second = events.subscribe<NumberEvent>([&](const NumberEvent &ev)
+    {   log.push_back("b" + std::to_string(ev.number));   });
+    const auto other = events.subscribe<OtherEvent>([&](const OtherEvent &)
+    {   log.push_back("other");   });
+
+    RecordingSink sink;
+    sink.log = &log;
+    events.regSink(&sink);
+
+    events.add<NumberEvent>(1);
+    events.add<OtherEvent>();
+    events.add<NumberEvent>(2);
+    events.processSinks();
+
+    const std::vector<std::string> expected =
+    { "a1", "b1", "other", "a2", "b2", "sink1", "sink2" };
+    CHECK(log == expected);
+    CHECK(events.empty());
+
+    events.unregSink(&sink);
+    events.unsubscribe(first);
+    events.unsubscribe(second);
+    events.unsubscribe(other);
+}
+
+// A handler removing itself must not destroy what is running, nor be called again
+void testSelfUnsubscribe()
+{
+    CEventContainer events;
+    std::vector<std::string> log;
+
+    CEventContainer::Subscription self = 0;
+    std::string captured = "captured state";
+
+    self = events.subscribe<NumberEvent>([&, captured](const NumberEvent &ev)
+    {
+        events.unsubscribe(self);
+        // The closure is still alive while it runs
+        log.push_back(captured + std::to_string(ev.number));
+    });
+    const auto other = events.subscribe<NumberEvent>([&](const NumberEvent &ev)
+    {   log.push_back("other" + std::to_string(ev.number));   });
+
+    events.add<NumberEvent>(1);
+    events.add<NumberEvent>(2);
+    events.processSinks();
+
+    const std::vector<std::string> expected = { "captured state1", "other1", "other2" };
+    CHECK(log == expected);
+
+    log.clear();
+    events.add<NumberEvent>(3);
+    events.processSinks();
+    CHECK(log == std::vector<std::string>{ "other3" });
+
+    events.unsubscribe(other);
+}
+
+// One handler removing a later one in the same dispatch
+void testUnsubscribeOther()
+{
+    CEventContainer events;
+    std::vector<std::string> log;
+
+    CEventContainer::Subscription victim = 0;
+
+    const auto killer = events.subscribe<NumberEvent>([&](const NumberEvent &)
+    {
+        log.push_back("killer");
+        events.unsubscribe(victim);
+    });
+    victim = events.subscribe<NumberEvent>([&](const NumberEvent &)
+    {   log.push_back("victim");   });
+
+    events.add<NumberEvent>(1);
+    events.processSinks();
+    CHECK(log == std::vector<std::string>{ "killer" });
+
+    events.unsubscribe(killer);
+}
+
+// Subscribed while dispatching: called from the next events on
+void testSubscribeWhileDispatching()
+{
+    CEventContainer events;
+    std::vector<std::string> log;
+    std::vector<CEventContainer::Subscription> late;
+
+    const auto first = events.subscribe<NumberEvent>([&](const NumberEvent &ev)
+    {
+        log.push_back("first" + std::to_string(ev.number));
+
+        if(late.empty())
+        {
+            late.push_back( events.subscribe<NumberEvent>([&](const NumberEvent &ev2)
+            {   log.push_back("late" + std::to_string(ev2.number));   }) );
+
+            // Subscribed and gone again within the same dispatch
+            const auto gone = events.subscribe<NumberEvent>([&](const NumberEvent &)
+            {   log.push_back("gone");   });
+            events.unsubscribe(gone);
+        }
+    });
+
+    events.add<NumberEvent>(1);
+    events.add<NumberEvent>(2);
+    events.processSinks();
+
+    CHECK(log == (std::vector<std::string>{ "first1", "first2" }));
+
+    log.clear();
+    events.add<NumberEvent>(3);
+    events.processSinks();
+    CHECK(log == (std::vector<std::string>{ "first3", "late3" }));
+
+    events.unsubscribe(first);
+    events.unsubscribe(late[0]);
+}
+
+// Flushing stops the dispatch
+void testFlush()
+{
+    CEventContainer events;
+    int calls = 0;
+
+    const auto sub = events.subscribe<NumberEvent>([&](const NumberEvent &)
+    {
+        calls++;
+        events.flush();
+    });
+
+    events.add<NumberEvent>(1);
+    events.add<NumberEvent>(2);
+    events.processSinks();
+    CHECK_EQ(calls, 1);
+
+    events.unsubscribe(sub);
+}
+
+// Events added as pointers, like the loader threads do, find their handlers by their real type
+void testPointerAdd()
+{
+    CEventContainer events;
+    std::vector<std::string> log;
+
+    const auto number = events.subscribe<NumberEvent>([&](const NumberEvent &ev)
+    {   log.push_back("n" + std::to_string(ev.number));   });
+    const auto derived = events.subscribe<DerivedNumberEvent>([&](const DerivedNumberEvent &ev)
+    {   log.push_back("d" + std::to_string(ev.number));   });
+
+    events.add(new NumberEvent(1));
+    events.add(new DerivedNumberEvent(2));
+    events.add<DerivedNumberEvent>(3);
+    events.add(new OtherEvent);
+    std::shared_ptr<CEvent> shared = std::make_shared<NumberEvent>(4);
+    events.add(shared);
+    events.processSinks();
+
+    const std::vector<std::string> expected = { "n1", "d2", "d3", "n4" };
+    CHECK(log == expected);
+
+    CHECK(CEventContainer::eventTypeId<NumberEvent>() != CEventContainer::eventTypeId<DerivedNumberEvent>());
+    CHECK_EQ(CEventContainer::eventTypeId<NumberEvent>(), CEventContainer::eventTypeId<NumberEvent>());
+
+    events.unsubscribe(number);
+    events.unsubscribe(derived);
+}
+
+
+template <int N>
+struct MixedEvent : CEvent
+{
+    MixedEvent(const int v) : value(v) {}
+    int value;
+};
+
+const int NUM_MIXED_TYPES = 8;
+const int NUM_MIXED_EVENTS = 100000;
+
+template <int N>
+struct MixedSink : GsEventSink
+{
+    long sum = 0;
+
+    void pumpEvent(const CEvent *ev)
+    {
+        if(const MixedEvent<N> *mixed = dynamic_cast<const MixedEvent<N>*>(ev))
+            sum += mixed->value;
+    }
+};
+
+template <int N>
+void addMixed(CEventContainer &events, const int type, const int value)
+{
+    if(type == N)
+        events.add< MixedEvent<N> >(value);
+    else
+        addMixed<N+1>(events, type, value);
+}
+
+template <>
+void addMixed<NUM_MIXED_TYPES>(CEventContainer &, const int, const int)
+{}
+
+template <int N>
+void subscribeMixed(CEventContainer &events, std::vector<long> &sums, std::vector<CEventContainer::Subscription> &subs)
+{
+    subs.push_back( events.subscribe< MixedEvent<N> >([&sums](const MixedEvent<N> &ev)
+    {   sums[N] += ev.value;   }) );
+    subscribeMixed<N+1>(events, sums, subs);
+}
+
+template <>
+void subscribeMixed<NUM_MIXED_TYPES>(CEventContainer &, std::vector<long> &, std::vector<CEventContainer::Subscription> &)
+{}
+
+void addAllMixed(CEventContainer &events, std::vector<long> &expected)
+{
+    unsigned int seed = 815;
+    for(int i=0 ; i<NUM_MIXED_EVENTS ; i++)
+    {
+        seed = seed*1103515245 + 12345;
+        const int type = int((seed >> 8) % NUM_MIXED_TYPES);
+        addMixed<0>(events, type, i);
+        expected[type] += i;
+    }
+}
+
+double millisecondsSince(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 100k events of eight types, once to one subscriber per type and once to one sink per type.
+// Only the results are checked, the times are reported for comparison.
+void benchmarkMixedDispatch()
+{
+    CEventContainer events;
+    std::vector<long> expected(NUM_MIXED_TYPES, 0);
+    std::vector<long> sums(NUM_MIXED_TYPES, 0);
+    std::vector<CEventContainer::Subscription> subs;
+
+    subscribeMixed<0>(events, sums, subs);
+    addAllMixed(events, expected);
+
+    auto start = std::chrono::steady_clock::now();
+    events.processSinks();
+    const double subscribedMs = millisecondsSince(start);
+
+    CHECK(sums == expected);
+
+    for(const auto sub : subs)
+        events.unsubscribe(sub);
+
+    MixedSink<0> sink0; MixedSink<1> sink1; MixedSink<2> sink2; MixedSink<3> sink3;
+    MixedSink<4> sink4; MixedSink<5> sink5; MixedSink<6> sink6; MixedSink<7> sink7;
+    GsEventSink *sinks[NUM_MIXED_TYPES] = { &sink0, &sink1, &sink2, &sink3, &sink4, &sink5, &sink6, &sink7 };
+
+    for(GsEventSink *sink : sinks)
+        events.regSink(sink);
+
+    std::fill(expected.begin(), expected.end(), 0);
+    addAllMixed(events, expected);
+
+    start = std::chrono::steady_clock::now();
+    events.processSinks();
+    const double sinksMs = millisecondsSince(start);
+
+    const long sinkSums[NUM_MIXED_TYPES] = { sink0.sum, sink1.sum, sink2.sum, sink3.sum,
+                                             sink4.sum, sink5.sum, sink6.sum, sink7.sum };
+    CHECK(std::vector<long>(sinkSums, sinkSums+NUM_MIXED_TYPES) == expected);
+
+    for(GsEventSink *sink : sinks)
+        events.unregSink(sink);
+
+    std::printf("Dispatching %d mixed events: %.2f ms to subscribers, %.2f ms to sinks\n",
+                NUM_MIXED_EVENTS, subscribedMs, sinksMs);
+}
+
+}
+
+int main()
+{
+    testOrder();
+    testSelfUnsubscribe();
+    testUnsubscribeOther();
+    testSubscribeWhileDispatching();
+    testFlush();
+    testPointerAdd();
+    benchmarkMixedDispatch();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,100 @@
+/*
+ * IniReaderTest.cpp
+ *
+ *  Parsing of the INI buffers and the typed readers on top of it
+ */
+
+#include "UnitTest.h"
+
+#include <fileio/IniReader.h>
+
+#include <cstdio>
+
+// IniReader opens its files through this, the tests only parse buffers
+FILE *OpenGameFile(const std::string &, const char *)
+{
+    return nullptr;
+}
+
+
+static void testSectionsAndEntries()
+{
+    IniReader ini("test.cfg");
+
+    CHECK( ini.ParseBuffer("[Video]\r\nwidth = 320\r\nheight=200\n\n[Audio]\nrate =  44100\n") );
+
+    CHECK_EQ( ini.m_sections.size(), size_t(2) );
+    CHECK_EQ( ini.m_sections["Video"]["width"], std::string("320") );
+    CHECK_EQ( ini.m_sections["Video"]["height"], std::string("200") );
+    CHECK_EQ( ini.m_sections["Audio"]["rate"], std::string("44100") );
+}
+
+
+static void testCommentsAndValues()
+{
+    IniReader ini("test.cfg");
+
+    CHECK( ini.ParseBuffer("# leading comment\n[Game]\nname = Commander Keen # trailing\n"
+                           "path=games/keen 4\n#hidden = 1\nlast=no newline") );
+
+    const IniReader::Section &game = ini.m_sections["Game"];
+    CHECK_EQ( game.count("hidden"), size_t(0) );
+    CHECK_EQ( game.at("path"), std::string("games/keen 4") );
+    CHECK_EQ( game.at("last"), std::string("no newline") );
+
+    // Only the spaces in front of a value are skipped
+    std::string name;
+    CHECK( ini.ReadString("Game", "name", name, "") );
+    CHECK_EQ( name, std::string("Commander Keen ") );
+}
+
+
+static void testMalformedLines()
+{
+    IniReader ini("test.cfg");
+
+    // Entries before any section, unclosed sections and keys without value are dropped
+    CHECK( ini.ParseBuffer("orphan = 1\n[Broken\nkey\n[Good]\n=value\nkey = 2\n") );
+
+    CHECK_EQ( ini.m_sections.count("Broken"), size_t(0) );
+    CHECK_EQ( ini.m_sections["Good"].size(), size_t(1) );
+    CHECK_EQ( ini.m_sections["Good"]["key"], std::string("2") );
+}
+
+
+static void testTypedReaders()
+{
+    IniReader ini("test.cfg");
+
+    CHECK( ini.ParseBuffer("[T]\nint = -42\nfloat = 2.5\nbool = true\narray = 1,2,3\n") );
+
+    int i = 0;
+    CHECK( ini.ReadInteger("T", "int", &i, 7) );
+    CHECK_EQ( i, -42 );
+
+    CHECK( !ini.ReadInteger("T", "missing", &i, 7) );
+    CHECK_EQ( i, 7 );
+
+    float f = 0.0f;
+    CHECK( ini.ReadFloat("T", "float", &f, 0.0f) );
+    CHECK_EQ( f, 2.5f );
+
+    bool b = false;
+    CHECK( ini.ReadKeyword("T", "bool", &b, false) );
+    CHECK( b );
+
+    int array[3] = { 0, 0, 0 };
+    CHECK( ini.ReadIntArray("T", "array", array, 3) );
+    CHECK( array[0] == 1 && array[1] == 2 && array[2] == 3 );
+}
+
+
+int main()
+{
+    testSectionsAndEntries();
+    testCommentsAndValues();
+    testMalformedLines();
+    testTypedReaders();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,281 @@
+/*
+ * InputBindingTest.cpp
+ *
+ *  The table which finds the commands bound to a key, axis, button or hat,
+ *  compared with a scan of all bindings after each way they can change
+ */
+
+#include "UnitTest.h"
+
+#include <base/CInput.h>
+#include <base/GsTimer.h>
+#include <base/video/CVideoDriver.h>
+#include <base/utils/FindFile.h>
+#include <base/utils/ThreadPool.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+// Only polling with a window needs these, and no test does that
+CVideoDriver::CVideoDriver() {}
+CVideoDriver::~CVideoDriver() {}
+bool CVideoDriver::applyMode() { return false; }
+bool CVideoDriver::start() { return false; }
+void CVideoDriver::isFullscreen(bool) {}
+bool CVideoDriver::getFullscreen() { return false; }
+CVidConfig &CVideoDriver::getVidConfig() { return mVidConfig; }
+CVidConfig::CVidConfig() {}
+CVideoEngine::~CVideoEngine() {}
+bool CVideoEngine::init() { return false; }
+void CVideoEngine::shutdown() {}
+CTimer::CTimer() {}
+CTimer::~CTimer() {}
+
+// Verbosity of the console output in Debug.cpp, turned down so the notes of the config don't get printed
+extern int Logger_Verbosity;
+
+
+struct InputBindingTest
+{
+    typedef std::tuple<EType, int, int> Trigger;
+
+    static stInputCommand *commands(CInput &input, const int player)
+    {
+        return input.InputCommand[player];
+    }
+
+    // What the next poll does before it handles any event
+    static void poll(CInput &input)
+    {
+        if(input.mBindingsDirty)
+            input.rebuildBindings();
+    }
+
+    static void remap(CInput &input, const Uint8 player, const int command)
+    {
+        input.setupNewEvent(player, command);
+        input.readNewEvent();
+    }
+
+    // The commands which the events of a trigger go to, as it was before the table
+    static std::vector<std::pair<int,int>> scan(CInput &input, const Trigger &trigger)
+    {
+        std::vector<std::pair<int,int>> found;
+
+        for(int j=0 ; j<NUM_INPUTS ; j++)
+        {
+            for(int i=0 ; i<MAX_COMMANDS ; i++)
+            {
+                const stInputCommand &command = input.InputCommand[j][i];
+                if(command.joyeventtype != unsigned(std::get<0>(trigger)))
+                    continue;
+
+                bool bound = false;
+                switch(std::get<0>(trigger))
+                {
+                case ETYPE_KEYBOARD:
+                    bound = (int(command.keysym) == std::get<2>(trigger)); break;
+                case ETYPE_JOYAXIS:
+                    bound = (command.which == std::get<1>(trigger) && command.joyaxis == std::get<2>(trigger)); break;
+                case ETYPE_JOYBUTTON:
+                    bound = (command.which == std::get<1>(trigger) && command.joybutton == std::get<2>(trigger)); break;
+                case ETYPE_JOYHAT:
+                    bound = (command.which == std::get<1>(trigger)); break;
+                }
+
+                if(bound)
+                    found.push_back(std::make_pair(j, i));
+            }
+        }
+
+        return found;
+    }
+
+    // Every trigger of a binding, and a few nothing is bound to
+    static std::set<Trigger> triggers(CInput &input)
+    {
+        std::set<Trigger> all;
+
+        for(int j=0 ; j<NUM_INPUTS ; j++)
+        {
+            for(int i=0 ; i<MAX_COMMANDS ; i++)
+            {
+                const stInputCommand &command = input.InputCommand[j][i];
+                all.insert(Trigger(ETYPE_KEYBOARD, 0, int(command.keysym)));
+                all.insert(Trigger(ETYPE_JOYAXIS, command.which, command.joyaxis));
+                all.insert(Trigger(ETYPE_JOYBUTTON, command.which, command.joybutton));
+                all.insert(Trigger(ETYPE_JOYHAT, command.which, 0));
+            }
+        }
+
+        all.insert(Trigger(ETYPE_KEYBOARD, 0, SDLK_F12));
+        all.insert(Trigger(ETYPE_JOYAXIS, 7, 3));
+        all.insert(Trigger(ETYPE_JOYBUTTON, 7, 11));
+        all.insert(Trigger(ETYPE_JOYHAT, 7, 0));
+        return all;
+    }
+
+    static bool matchesScan(CInput &input)
+    {
+        poll(input);
+
+        bool ok = true;
+        for(const Trigger &trigger : triggers(input))
+        {
+            std::vector<std::pair<int,int>> found;
+            for(const auto &ref : input.boundCommands(std::get<0>(trigger), std::get<1>(trigger), std::get<2>(trigger)))
+                found.push_back(std::make_pair(ref.player, ref.command));
+
+            ok &= (found == scan(input, trigger));
+        }
+        return ok;
+    }
+};
+
+
+namespace
+{
+
+SDL_Event keyDown(const int key)
+{
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_KEYDOWN;
+    event.key.keysym.sym = decltype(event.key.keysym.sym)(key);
+    return event;
+}
+
+SDL_Event joyAxis(const int which, const int axis, const Sint16 value)
+{
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_JOYAXISMOTION;
+    event.jaxis.which = which;
+    event.jaxis.axis = axis;
+    event.jaxis.value = value;
+    return event;
+}
+
+SDL_Event joyButton(const int which, const int button)
+{
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_JOYBUTTONDOWN;
+    event.jbutton.which = which;
+    event.jbutton.button = button;
+    return event;
+}
+
+SDL_Event joyHat(const int which, const Uint8 value)
+{
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_JOYHATMOTION;
+    event.jhat.which = which;
+    event.jhat.value = value;
+    return event;
+}
+
+// Defaults of all players, with all of them sharing the keys
+void testDefaults(CInput &input)
+{
+    CHECK(InputBindingTest::matchesScan(input));
+
+    const std::vector<std::pair<int,int>> left =
+        InputBindingTest::scan(input, InputBindingTest::Trigger(ETYPE_KEYBOARD, 0, SDLK_LEFT));
+    CHECK_EQ(left.size(), size_t(NUM_INPUTS));
+}
+
+// Bindings read from the config, one after the other and polled in between
+void testSetup(CInput &input)
+{
+    const char *bindings[] = { "Joy0-A1+", "Joy0-A1-", "Joy1-B3", "Joy0-H4", "Key 97",
+                               "Joy1-A0-", "Joy0-B3", "Joy1-H1", "Key 276", "Joy2-B0" };
+
+    int n = 0;
+    for(int player=0 ; player<NUM_INPUTS ; player++)
+    {
+        for(int command=0 ; command<MAX_COMMANDS ; command += 3)
+        {
+            InputBindingTest::poll(input);
+            input.setupInputCommand(InputBindingTest::commands(input, player), command,
+                                    bindings[n++ % (sizeof(bindings)/sizeof(*bindings))]);
+            CHECK(InputBindingTest::matchesScan(input));
+        }
+    }
+
+    // Taken back to the defaults, a player at a time
+    for(int player=1 ; player<=NUM_INPUTS ; player++)
+    {
+        input.resetControls(player);
+        CHECK(InputBindingTest::matchesScan(input));
+    }
+}
+
+// Remapped in the menu, with whatever comes next from the devices
+void testRemap(CInput &input)
+{
+    // Nothing came yet, the binding is cleared until something does
+    InputBindingTest::remap(input, 1, IC_JUMP);
+    CHECK(InputBindingTest::matchesScan(input));
+
+    const SDL_Event events[] = { joyButton(0, 2), keyDown(SDLK_LEFT), joyAxis(1, 2, -30000),
+                                 joyHat(0, SDL_HAT_UP), joyButton(1, 2), keyDown(SDLK_a) };
+
+    int command = 0;
+    for(const SDL_Event &event : events)
+    {
+        SDL_Event pushed = event;
+        if(SDL_PushEvent(&pushed) < 0)
+        {
+            std::printf("SDL takes no events without a window here, remapping is tested without them\n");
+            break;
+        }
+
+        InputBindingTest::remap(input, Uint8(command % NUM_INPUTS), command % MAX_COMMANDS);
+        CHECK_EQ(InputBindingTest::commands(input, command % NUM_INPUTS)[command % MAX_COMMANDS].joyeventtype,
+                 unsigned(event.type == SDL_KEYDOWN ? ETYPE_KEYBOARD :
+                          event.type == SDL_JOYAXISMOTION ? ETYPE_JOYAXIS :
+                          event.type == SDL_JOYBUTTONDOWN ? ETYPE_JOYBUTTON : ETYPE_JOYHAT));
+        CHECK(InputBindingTest::matchesScan(input));
+        command += 5;
+    }
+}
+
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/cginputXXXXXX";
+    if(!mkdtemp(dirTemplate))
+    {
+        std::fprintf(stderr, "Could not create a scratch directory\n");
+        return 1;
+    }
+    const std::string scratchDir = dirTemplate;
+    tSearchPaths.push_back(scratchDir);
+
+    Logger_Verbosity = -1;
+    InitThreadPool();
+
+    {
+        // No config there, every player gets the defaults
+        CInput input;
+
+        testDefaults(input);
+        testSetup(input);
+        testRemap(input);
+
+        input.shutdown();
+    }
+
+    UnInitThreadPool();
+    rmdir(scratchDir.c_str());
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,211 @@
+/*
+ * InputRecorderTest.cpp
+ *
+ *  A session recorded and replayed with the input coming from the test,
+ *  and replays which have to tell at which tick they stopped matching
+ */
+
+#include "UnitTest.h"
+
+#include <base/GsInputRecorder.h>
+#include <base/CInput.h>
+#include <base/utils/FindFile.h>
+#include <base/utils/StringUtils.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// The input state is whatever the test puts in here, and what a replay sets ends up here
+std::vector<Uint8> gInputState(CInput::commandStateSize(), 0);
+
+CInput::CInput() {}
+
+size_t CInput::commandStateSize()
+{
+    return NUM_INPUTS*MAX_COMMANDS*3 + KEYTABLE_SIZE;
+}
+
+void CInput::saveCommandState(std::vector<Uint8> &state) const
+{
+    state = gInputState;
+}
+
+void CInput::loadCommandState(const std::vector<Uint8> &state)
+{
+    gInputState = state;
+}
+
+
+namespace
+{
+
+const int NUM_TICKS = 400;
+
+struct Random
+{
+    unsigned int seed = 815;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// Moved by the input, the way the player of a game would be
+struct World
+{
+    Sint64 x = 0;
+    Sint64 y = 0;
+};
+
+// Where a session behaves differently than the recorded one
+struct Changes
+{
+    int levelLate = -1;     // Level due at this tick started a tick later
+    int worldMoved = -1;    // World changed at this tick by other means than the input
+};
+
+World gWorld;
+int gLevel = 0;
+
+// One run of the main cycle, with events processed before each tick like GsApp does.
+// The states the logic got are returned.
+std::vector< std::vector<Uint8> > runSession(const bool replay, const Changes &changes = Changes())
+{
+    gWorld = World();
+    gLevel = 0;
+    gInputRecorder.setStateHasher([]()
+    {
+        return GsInputRecorder::hashBytes(&gWorld, sizeof(gWorld));
+    });
+
+    std::vector< std::vector<Uint8> > applied;
+    Random rnd;
+
+    // The episode is started before any tick
+    gInputRecorder.mark("episode", "4");
+
+    for(int tick=0 ; tick<NUM_TICKS ; tick++)
+    {
+        // What the devices give, which a replay has to replace
+        for(int i=0 ; i<3 ; i++)
+            gInputState[rnd.next() % gInputState.size()] = Uint8(rnd.next());
+
+        if(replay)
+        {
+            for(Uint8 &byte : gInputState)
+                byte = Uint8(rnd.next());
+        }
+
+        // Processing the events starts a level now and then
+        bool levelStarts = (tick % 50 == 10);
+        if(changes.levelLate >= 0 && tick == changes.levelLate)
+            levelStarts = false;
+        else if(changes.levelLate >= 0 && tick == changes.levelLate+1)
+            levelStarts = true;
+
+        if(levelStarts)
+        {
+            gLevel++;
+            gInputRecorder.mark("level", itoa(gLevel));
+        }
+
+        gInputRecorder.beginTick();
+
+        applied.push_back(gInputState);
+        gWorld.x += Sint8(gInputState[IC_RIGHT*3]) - Sint8(gInputState[IC_LEFT*3]);
+        gWorld.y += Sint8(gInputState[IC_DOWN*3]) - Sint8(gInputState[IC_UP*3]);
+        gWorld.y += gInputState[gInputState.size()-1];
+
+        if(tick == changes.worldMoved)
+            gWorld.x++;
+
+        // Marks of the logic itself
+        if(tick % 70 == 5)
+            gInputRecorder.mark("checkpoint", itoa(tick));
+
+        gInputRecorder.endTick();
+    }
+
+    gInputRecorder.setStateHasher(nullptr);
+    return applied;
+}
+
+std::vector< std::vector<Uint8> > gRecorded;
+World gRecordedWorld;
+int gRecordedLevel = 0;
+
+void testRecord()
+{
+    CHECK(gInputRecorder.startRecording("session.cgir"));
+    gInputRecorder.setHeaderValue("difficulty", "hard");
+    gRecorded = runSession(false);
+    gRecordedWorld = gWorld;
+    gRecordedLevel = gLevel;
+    gInputRecorder.stop();
+}
+
+// Every tick gets the input that was recorded for it, and the world comes out the same
+void testReplay()
+{
+    CHECK(gInputRecorder.startReplay("session.cgir"));
+    CHECK_EQ(gInputRecorder.getHeaderValue("difficulty"), std::string("hard"));
+
+    const std::vector< std::vector<Uint8> > replayed = runSession(true);
+    CHECK_EQ(gInputRecorder.firstDivergingTick(), -1L);
+    gInputRecorder.stop();
+
+    CHECK(replayed == gRecorded);
+    CHECK_EQ(gWorld.x, gRecordedWorld.x);
+    CHECK_EQ(gWorld.y, gRecordedWorld.y);
+    CHECK_EQ(gLevel, gRecordedLevel);
+}
+
+// Ticks count from one, so the first tick a difference shows up in is its index plus one
+void testDivergence()
+{
+    Changes worldMoved;
+    worldMoved.worldMoved = 123;
+
+    CHECK(gInputRecorder.startReplay("session.cgir"));
+    runSession(true, worldMoved);
+    CHECK_EQ(gInputRecorder.firstDivergingTick(), 124L);
+    gInputRecorder.stop();
+
+    // The level is started a tick late. Only the marks tell, the world isn't hashed with it.
+    Changes levelLate;
+    levelLate.levelLate = 110;
+
+    CHECK(gInputRecorder.startReplay("session.cgir"));
+    runSession(true, levelLate);
+    CHECK_EQ(gInputRecorder.firstDivergingTick(), 111L);
+    gInputRecorder.stop();
+}
+
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/cgrecorderXXXXXX";
+    if(!mkdtemp(dirTemplate))
+    {
+        std::fprintf(stderr, "Could not create a scratch directory\n");
+        return 1;
+    }
+    const std::string scratchDir = dirTemplate;
+    tSearchPaths.push_back(scratchDir);
+
+    testRecord();
+    testReplay();
+    testDivergence();
+
+    remove((scratchDir + "/session.cgir").c_str());
+    rmdir(scratchDir.c_str());
+
+    return TEST_RESULT();
+}
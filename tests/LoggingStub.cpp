@@ -0,0 +1,23 @@
+/*
+ * LoggingStub.cpp
+ *
+ *  Stands in for GsLogging.cpp in the unit tests, everything logged is dropped
+ */
+
+#include <base/GsLogging.h>
+
+struct CLogFile::LogQueue {};
+
+CLogFile::CLogFile() {}
+CLogFile::~CLogFile() {}
+
+void CLogFile::textOut(const std::string&) {}
+void CLogFile::textOut(FONTCOLORS, const std::string&) {}
+void CLogFile::textOut(FONTCOLORS, bool, const std::string&) {}
+void CLogFile::ftextOut(const char*, ...) {}
+void CLogFile::ftextOut(FONTCOLORS, const char*, ...) {}
+void CLogFile::fltextOut(FONTCOLORS, bool, const char*, ...) {}
+
+CLogFile & CLogFile::operator << (const char*) { return *this; }
+CLogFile & CLogFile::operator << (const std::string&) { return *this; }
+CLogFile & CLogFile::operator << (const int) { return *this; }
@@ -0,0 +1,174 @@
+/*
+ * LoggingTest.cpp
+ *
+ *  Records of the log file going through the writer thread: a full queue,
+ *  several threads at once, stopping the writer while others log and the end of the log
+ */
+
+#include "UnitTest.h"
+
+#include <base/GsLogging.h>
+#include <base/utils/FindFile.h>
+#include <base/utils/ThreadPool.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+// Verbosity of the console output in Debug.cpp, turned down so the records don't get printed too
+extern int Logger_Verbosity;
+
+namespace
+{
+
+std::string gScratchDir;
+
+std::string readLog(const std::string &name)
+{
+    std::ifstream file((gScratchDir + "/" + name).c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::string record(const int producer, const int number)
+{
+    return "[" + std::to_string(producer) + ":" + std::to_string(number) + "]";
+}
+
+void logRecords(CLogFile &log, const int producer, const int count)
+{
+    for(int i=0 ; i<count ; i++)
+        log.textOut(record(producer, i));
+}
+
+// Every record of every producer is in the file exactly once and in the order it was logged
+bool allRecordsInOrder(const std::string &text, const int producers, const int count)
+{
+    std::vector<int> next(producers, 0);
+    bool ok = true;
+
+    for(size_t start = text.find('[') ; start != std::string::npos ; start = text.find('[', start+1))
+    {
+        int producer = -1, number = -1;
+        if(std::sscanf(text.c_str()+start, "[%d:%d]", &producer, &number) != 2 ||
+           producer < 0 || producer >= producers)
+        {
+            ok = false;
+            continue;
+        }
+
+        ok &= (number == next[producer]);
+        next[producer] = number+1;
+    }
+
+    for(const int n : next)
+        ok &= (n == count);
+
+    return ok;
+}
+
+// Far more records than the queue holds, the logging thread waits for the writer to catch up
+void testOverflow()
+{
+    CLogFile log;
+    CHECK(log.CreateLogfile("overflow.html", "LoggingTest", "1"));
+
+    logRecords(log, 0, 20000);
+    log.stopWriter();
+
+    CHECK(allRecordsInOrder(readLog("overflow.html"), 1, 20000));
+}
+
+void testProducers()
+{
+    const int producers = 4;
+
+    CLogFile log;
+    CHECK(log.CreateLogfile("producers.html", "LoggingTest", "1"));
+
+    std::vector<std::thread> threads;
+    for(int p=0 ; p<producers ; p++)
+        threads.push_back(std::thread(logRecords, std::ref(log), p, 5000));
+
+    for(auto &thread : threads)
+        thread.join();
+
+    log.stopWriter();
+
+    CHECK(allRecordsInOrder(readLog("producers.html"), producers, 5000));
+}
+
+// Records logged while the writer stops are neither lost nor written out of order
+void testStopWhileLogging()
+{
+    CLogFile log;
+    CHECK(log.CreateLogfile("stopping.html", "LoggingTest", "1"));
+
+    std::thread producer(logRecords, std::ref(log), 0, 50000);
+
+    for(int cycle=0 ; cycle<20 ; cycle++)
+    {
+        usleep(500);
+        log.stopWriter();
+        usleep(200);
+        log.startWriter();
+    }
+
+    producer.join();
+    log.stopWriter();
+
+    CHECK(allRecordsInOrder(readLog("stopping.html"), 1, 50000));
+}
+
+// Whatever is still queued when the log goes away makes it into the file, before its end
+void testFlushOnExit()
+{
+    {
+        CLogFile log;
+        CHECK(log.CreateLogfile("exit.html", "LoggingTest", "1"));
+        logRecords(log, 0, 3000);
+    }
+
+    const std::string text = readLog("exit.html");
+    CHECK(allRecordsInOrder(text, 1, 3000));
+
+    const size_t end = text.find("End of logfile");
+    CHECK(end != std::string::npos);
+    CHECK(end > text.find(record(0, 2999)));
+}
+
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/cgloggingXXXXXX";
+    if(!mkdtemp(dirTemplate))
+    {
+        std::fprintf(stderr, "Could not create a scratch directory\n");
+        return 1;
+    }
+    gScratchDir = dirTemplate;
+    tSearchPaths.push_back(gScratchDir);
+
+    Logger_Verbosity = -1;
+    InitThreadPool();
+
+    testOverflow();
+    testProducers();
+    testStopWhileLogging();
+    testFlushOnExit();
+
+    UnInitThreadPool();
+
+    const char *logs[] = { "overflow.html", "producers.html", "stopping.html", "exit.html" };
+    for(const char *name : logs)
+        remove((gScratchDir + "/" + name).c_str());
+    rmdir(gScratchDir.c_str());
+
+    return TEST_RESULT();
+}
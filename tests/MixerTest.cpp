@@ -0,0 +1,136 @@
+/*
+ * MixerTest.cpp
+ *
+ *  The vectorized mixing kernels must give exactly what the plain ones give
+ */
+
+#include "UnitTest.h"
+
+#include <sdl/audio/Mixer.h>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+typedef void (*MixFunc)(Uint8*, const Uint8*, Uint32, Uint32);
+
+struct Random
+{
+    unsigned int seed = 31337;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// Mostly samples near the limits, so the sums clip often
+std::vector<Uint8> loudSigned16(Random &rnd, const size_t samples)
+{
+    std::vector<Uint8> data(samples*2);
+    for(size_t i=0 ; i<samples ; i++)
+    {
+        Sint16 value = Sint16(rnd.next());
+        if(rnd.next() % 4 != 0)
+            value = (value < 0) ? Sint16(-32768 + (rnd.next() % 2000)) : Sint16(32767 - (rnd.next() % 2000));
+        memcpy(&data[2*i], &value, 2);
+    }
+    return data;
+}
+
+std::vector<Uint8> loudUnsigned8(Random &rnd, const size_t samples)
+{
+    std::vector<Uint8> data(samples);
+    for(auto &b : data)
+    {
+        b = Uint8(rnd.next());
+        if(rnd.next() % 4 != 0)
+            b = (b < 128) ? Uint8(rnd.next() % 16) : Uint8(255 - rnd.next() % 16);
+    }
+    return data;
+}
+
+// Over lengths which leave every possible tail, with volumes up to beyond the maximum
+void compareKernels(const MixFunc plain, const MixFunc vectorized, const bool signed16)
+{
+    const Uint32 volumes[] = { 0, 1, 37, 64, 127, SDL_MIX_MAXVOLUME, 200 };
+
+    Random rnd;
+    long differing = 0;
+
+    for(const Uint32 volume : volumes)
+    {
+        for(size_t samples=0 ; samples<80 ; samples += 1 + samples/8)
+        {
+            const size_t count = samples + ((samples > 40) ? 1000 : 0);
+            const std::vector<Uint8> src = signed16 ? loudSigned16(rnd, count) : loudUnsigned8(rnd, count);
+            const std::vector<Uint8> dst = signed16 ? loudSigned16(rnd, count) : loudUnsigned8(rnd, count);
+
+            std::vector<Uint8> expected(dst);
+            std::vector<Uint8> got(dst);
+            plain(expected.data(), src.data(), Uint32(src.size()), volume);
+            vectorized(got.data(), src.data(), Uint32(src.size()), volume);
+
+            if(expected != got)
+                differing++;
+        }
+    }
+
+    CHECK_EQ(differing, 0L);
+}
+
+Sint16 mixOne16(const MixFunc mix, const Sint16 dst, const Sint16 src, const Uint32 volume)
+{
+    // A whole vector and a tail sample, so both parts of a kernel get tested
+    std::vector<Sint16> d(9, dst), s(9, src);
+    mix(reinterpret_cast<Uint8*>(d.data()), reinterpret_cast<const Uint8*>(s.data()), 18, volume);
+    CHECK_EQ(d[0], d[8]);
+    return d[0];
+}
+
+Uint8 mixOne8(const MixFunc mix, const Uint8 dst, const Uint8 src, const Uint32 volume)
+{
+    std::vector<Uint8> d(17, dst), s(17, src);
+    mix(d.data(), s.data(), 17, volume);
+    CHECK_EQ(d[0], d[16]);
+    return d[0];
+}
+
+void testSaturation(const MixFunc mix16, const MixFunc mix8)
+{
+    CHECK_EQ(mixOne16(mix16, 32000, 32000, SDL_MIX_MAXVOLUME), Sint16(32767));
+    CHECK_EQ(mixOne16(mix16, -32000, -32000, SDL_MIX_MAXVOLUME), Sint16(-32768));
+    CHECK_EQ(mixOne16(mix16, -32768, -32768, 500), Sint16(-32768));
+    CHECK_EQ(mixOne16(mix16, 1000, 2000, 64), Sint16(2000));
+    CHECK_EQ(mixOne16(mix16, 1000, -3, 64), Sint16(998));       // rounds towards minus infinity
+    CHECK_EQ(mixOne16(mix16, 1234, 32767, 0), Sint16(1234));
+
+    CHECK_EQ(mixOne8(mix8, 250, 255, SDL_MIX_MAXVOLUME), Uint8(255));
+    CHECK_EQ(mixOne8(mix8, 5, 0, SDL_MIX_MAXVOLUME), Uint8(0));
+    CHECK_EQ(mixOne8(mix8, 128, 192, 64), Uint8(160));
+    CHECK_EQ(mixOne8(mix8, 100, 255, 0), Uint8(100));
+}
+
+}
+
+int main()
+{
+    testSaturation(mixAudioSigned16, mixAudioUnsigned8);
+
+#ifdef MIXER_SSE2
+    testSaturation(mixAudioSigned16SSE2, mixAudioUnsigned8SSE2);
+    compareKernels(mixAudioSigned16, mixAudioSigned16SSE2, true);
+    compareKernels(mixAudioUnsigned8, mixAudioUnsigned8SSE2, false);
+#endif
+
+#ifdef MIXER_NEON
+    testSaturation(mixAudioSigned16NEON, mixAudioUnsigned8NEON);
+    compareKernels(mixAudioSigned16, mixAudioSigned16NEON, true);
+    compareKernels(mixAudioUnsigned8, mixAudioUnsigned8NEON, false);
+#endif
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,238 @@
+/*
+ * OPLEmulatorTest.cpp
+ *
+ *  The OPL2 fast path of the dbopl emulator must sound exactly like the generic one,
+ *  and Adlib effects must come out the same whether rendered one after another or in parallel
+ */
+
+#include "UnitTest.h"
+
+#include <sdl/audio/base/COPLEmulator.h>
+#include <sdl/audio/Audio.h>
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+// The emulator only asks the audio driver for its spec. The device is never opened.
+Audio::Audio() :
+m_MusicVolume(0),
+m_SoundVolume(0)
+{
+    memset(&mAudioSpec, 0, sizeof(mAudioSpec));
+    mAudioSpec.freq = 44100;
+    mAudioSpec.format = AUDIO_S16;
+    mAudioSpec.channels = 2;
+}
+
+Audio::~Audio()
+{}
+
+// Slots only hold the rendered waveform here
+CSoundSlot::CSoundSlot() : priority(0), mHasCommonFreqBase(true), mOggFreq(0)
+{}
+
+CSoundSlot::~CSoundSlot()
+{}
+
+void CSoundSlot::setupWaveForm( Uint8 *buf, Uint32 len )
+{
+    mSounddata.assign(buf, buf+len);
+    m_soundlength = len;
+}
+
+namespace
+{
+
+struct Random
+{
+    unsigned int seed = 12345;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// Both chips get the same random OPL2 register writes, including the rhythm mode
+void testFastPathConformance(const Bit32u rate)
+{
+    static Chip generic, fast;
+    generic.clear();
+    fast.clear();
+    Chip__Chip(&generic);
+    Chip__Chip(&fast);
+    Chip__Setup(&generic, rate);
+    Chip__Setup(&fast, rate);
+
+    for(Bit32u reg=1 ; reg<=0xF5 ; reg++)
+    {
+        Chip__WriteReg(&generic, reg, 0);
+        Chip__WriteReg(&fast, reg, 0);
+    }
+    Chip__WriteReg(&generic, 1, 0x20);
+    Chip__WriteReg(&fast, 1, 0x20);
+
+    static const Bit32u regs[] = { 0x20, 0x40, 0x60, 0x80, 0xE0, 0xA0, 0xB0, 0xC0, 0xBD };
+
+    Random rnd;
+    std::vector<Bit32s> outGeneric(512), outFast(512);
+    long differing = 0;
+    long sounding = 0;
+
+    for(int block=0 ; block<5000 ; block++)
+    {
+        const unsigned int writes = rnd.next() % 6;
+        for(unsigned int w=0 ; w<writes ; w++)
+        {
+            const Bit32u reg = regs[rnd.next() % 9];
+            Bit32u offset = (reg >= 0xA0 && reg <= 0xC0) ? rnd.next() % 9 : rnd.next() % 22;
+            Bit8u val = Bit8u(rnd.next());
+
+            if(reg == 0xBD)
+            {
+                offset = 0;
+                if(rnd.next() % 4)
+                    val &= ~0x20;
+            }
+            if(reg == 0x40 && rnd.next() % 2)
+                val &= 0xC0;
+
+            Chip__WriteReg(&generic, reg+offset, val);
+            Chip__WriteReg(&fast, reg+offset, val);
+        }
+
+        const Bit32u len = 1 + rnd.next() % 300;
+        Chip__GenerateBlock2(&generic, len, outGeneric.data());
+        Chip__GenerateBlock2Fast(&fast, len, outFast.data());
+
+        for(Bit32u i=0 ; i<len ; i++)
+        {
+            if(outGeneric[i] != outFast[i])
+                differing++;
+            if(outGeneric[i] != 0)
+                sounding++;
+        }
+    }
+
+    CHECK_EQ(differing, 0L);
+    CHECK(sounding > 0);
+}
+
+
+// Gives access to the ISF renderer of the audio resources
+struct TestAudioResources : public CAudioResources
+{
+    bool loadSoundData(const unsigned int) override { return true; }
+    void unloadSound() override {}
+};
+
+// ISF effect as stored in AUDIO.CK?: size, priority, instrument, block and one note per byte
+std::vector<byte> makeEffect(Random &rnd)
+{
+    const size_t notes = 5 + rnd.next() % 40;
+
+    std::vector<byte> isf;
+    for(int i=0 ; i<4 ; i++)
+        isf.push_back(byte(notes >> (8*i)));
+    isf.push_back(byte(rnd.next()));
+    isf.push_back(0);
+
+    Instrument inst;
+    memset(&inst, 0, sizeof(inst));
+    inst.mChar = byte(rnd.next());      inst.cChar = byte(rnd.next());
+    inst.mScale = byte(rnd.next());     inst.cScale = byte(rnd.next());
+    inst.mAttack = byte(rnd.next());    inst.cAttack = byte(rnd.next());
+    inst.mSus = byte(rnd.next() | 1);   inst.cSus = byte(rnd.next());
+    inst.mWave = byte(rnd.next() & 3);  inst.cWave = byte(rnd.next() & 3);
+
+    const byte *instBytes = reinterpret_cast<const byte*>(&inst);
+    isf.insert(isf.end(), instBytes, instBytes+sizeof(inst));
+    isf.push_back(byte(rnd.next() & 7));
+
+    for(size_t n=0 ; n<notes ; n++)
+        isf.push_back((rnd.next() % 5 == 0) ? 0 : byte(rnd.next()));
+
+    return isf;
+}
+
+void testParallelEffects()
+{
+    Random rnd;
+    std::vector< std::vector<byte> > effects;
+    for(int i=0 ; i<24 ; i++)
+        effects.push_back(makeEffect(rnd));
+
+    // An invalid slot in between. Its emulator is dropped without ever being set up.
+    effects[5].assign(4, 0xFF);
+
+    TestAudioResources res;
+
+    // Serial, like before: one emulator for all effects, which keeps what the last one left behind
+    COPLEmulator shared;
+    shared.init();
+
+    std::vector<CSoundSlot> serial(effects.size());
+    std::vector<char> serialRead(effects.size());
+    for(size_t snd=0 ; snd<effects.size() ; snd++)
+        serialRead[snd] = res.readISFintoWaveForm(serial[snd], effects[snd].data(), 2, shared);
+
+    CHECK(!serialRead[5]);
+
+    // Parallel, like the loader: every effect gets a fresh emulator on one of a few threads
+    std::vector<CSoundSlot> parallel(effects.size());
+    std::vector<char> parallelRead(effects.size());
+    std::vector<std::thread> workers;
+    const size_t numWorkers = 4;
+
+    for(size_t w=0 ; w<numWorkers ; w++)
+    {
+        workers.emplace_back([&, w]()
+        {
+            for(size_t snd=w ; snd<effects.size() ; snd+=numWorkers)
+            {
+                std::unique_ptr<COPLEmulator> pOPLEmulator(new COPLEmulator);
+                parallelRead[snd] = res.readISFintoWaveForm(parallel[snd], effects[snd].data(),
+                                                            2, *pOPLEmulator);
+            }
+        });
+    }
+
+    for(auto &worker : workers)
+        worker.join();
+
+    CHECK(parallelRead == serialRead);
+
+    bool sounding = false;
+    for(size_t snd=0 ; snd<effects.size() ; snd++)
+    {
+        CHECK_EQ(parallel[snd].getSoundlength(), serial[snd].getSoundlength());
+
+        const unsigned int len = serial[snd].getSoundlength();
+        if(len == 0 || len != parallel[snd].getSoundlength())
+            continue;
+
+        CHECK(memcmp(parallel[snd].getSoundData(), serial[snd].getSoundData(), len) == 0);
+
+        for(unsigned int i=0 ; i<len && !sounding ; i++)
+            sounding = (serial[snd].getSoundData()[i] != 0);
+    }
+    CHECK(sounding);
+}
+
+}
+
+int main()
+{
+    DBOPL_InitTables();
+
+    testFastPathConformance(22050);
+    testFastPathConformance(44100);
+    testFastPathConformance(48000);
+    testParallelEffects();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,191 @@
+/*
+ * PCMRingBufferTest.cpp
+ *
+ *  Ring which hands the rendered IMF music from its producer thread to the audio callback
+ */
+
+#include "UnitTest.h"
+
+#include <sdl/audio/music/CPCMRingBuffer.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Random
+{
+    unsigned int seed = 2024;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+std::vector<Uint8> counting(const size_t from, const size_t len)
+{
+    std::vector<Uint8> data(len);
+    for(size_t i=0 ; i<len ; i++)
+        data[i] = Uint8(from+i);
+    return data;
+}
+
+void testFullAndEmpty()
+{
+    PCMRingBuffer ring;
+
+    // Nothing goes through before it got its memory
+    Uint8 byte = 0;
+    CHECK_EQ(ring.write(&byte, 1), size_t(0));
+    CHECK_EQ(ring.read(&byte, 1), size_t(0));
+
+    ring.reset(16);
+    CHECK_EQ(ring.capacity(), size_t(16));
+    CHECK_EQ(ring.fill(), size_t(0));
+
+    std::vector<Uint8> out(32);
+    CHECK_EQ(ring.read(out.data(), 8), size_t(0));
+
+    const std::vector<Uint8> in = counting(0, 20);
+    CHECK_EQ(ring.write(in.data(), 20), size_t(16));
+    CHECK_EQ(ring.fill(), size_t(16));
+    CHECK_EQ(ring.write(in.data(), 1), size_t(0));
+
+    CHECK_EQ(ring.read(out.data(), 10), size_t(10));
+    CHECK(std::equal(out.begin(), out.begin()+10, in.begin()));
+    CHECK_EQ(ring.fill(), size_t(6));
+
+    // Goes over the end of the buffer
+    CHECK_EQ(ring.write(in.data()+16, 4), size_t(4));
+    CHECK_EQ(ring.read(out.data(), 32), size_t(10));
+    CHECK(std::equal(out.begin(), out.begin()+10, in.begin()+10));
+    CHECK_EQ(ring.fill(), size_t(0));
+}
+
+// Chunks of any size, many times around the ring, keep the bytes in order
+void testWraparound()
+{
+    PCMRingBuffer ring;
+    ring.reset(37);
+
+    Random rnd;
+    size_t written = 0;
+    size_t read = 0;
+    bool inOrder = true;
+
+    while(read < 10000)
+    {
+        const std::vector<Uint8> in = counting(written, rnd.next() % 50);
+        written += ring.write(in.data(), in.size());
+
+        std::vector<Uint8> out(rnd.next() % 50);
+        const size_t n = ring.read(out.data(), out.size());
+        for(size_t i=0 ; i<n ; i++)
+            inOrder = inOrder && (out[i] == Uint8(read+i));
+        read += n;
+
+        CHECK(ring.fill() <= ring.capacity());
+        CHECK_EQ(ring.fill(), written-read);
+    }
+
+    CHECK(inOrder);
+}
+
+// After a flush the consumer only gets what came after it
+void testFlush()
+{
+    PCMRingBuffer ring;
+    ring.reset(64);
+
+    const std::vector<Uint8> stale(20, 0xAA);
+    const std::vector<Uint8> fresh(10, 0x55);
+
+    ring.write(stale.data(), stale.size());
+    ring.publishFlush(1);
+    ring.write(fresh.data(), fresh.size());
+
+    std::vector<Uint8> out(64, 0);
+    CHECK_EQ(ring.read(out.data(), out.size()), fresh.size());
+    CHECK(std::equal(fresh.begin(), fresh.end(), out.begin()));
+
+    // A flush the consumer already handled doesn't skip again
+    ring.write(fresh.data(), fresh.size());
+    CHECK_EQ(ring.read(out.data(), out.size()), fresh.size());
+
+    // Two flushes before the consumer looks: the later one counts
+    ring.write(stale.data(), stale.size());
+    ring.publishFlush(2);
+    ring.write(stale.data(), stale.size());
+    ring.publishFlush(3);
+    ring.write(fresh.data(), 3);
+    CHECK_EQ(ring.read(out.data(), out.size()), size_t(3));
+    CHECK_EQ(out[0], 0x55);
+}
+
+// One producer and one consumer thread, the consumer sees every byte once and in order
+void testConcurrent()
+{
+    PCMRingBuffer ring;
+    ring.reset(4096);
+
+    const size_t total = 4000000;
+
+    std::thread producer([&ring, total]()
+    {
+        Random rnd;
+        size_t written = 0;
+        while(written < total)
+        {
+            const std::vector<Uint8> in = counting(written, std::min<size_t>(1 + rnd.next() % 3000,
+                                                                             total-written));
+            size_t done = 0;
+            while(done < in.size())
+            {
+                const size_t n = ring.write(in.data()+done, in.size()-done);
+                if(n == 0)
+                    std::this_thread::yield();
+                done += n;
+            }
+            written += done;
+        }
+    });
+
+    Random rnd;
+    rnd.seed = 99;
+    size_t read = 0;
+    bool inOrder = true;
+    std::vector<Uint8> out(3000);
+
+    while(read < total)
+    {
+        const size_t n = ring.read(out.data(), 1 + rnd.next() % out.size());
+        if(n == 0)
+            std::this_thread::yield();
+
+        for(size_t i=0 ; i<n ; i++)
+            inOrder = inOrder && (out[i] == Uint8(read+i));
+        read += n;
+    }
+
+    producer.join();
+
+    CHECK(inOrder);
+    CHECK_EQ(read, total);
+    CHECK_EQ(ring.fill(), size_t(0));
+}
+
+}
+
+int main()
+{
+    testFullAndEmpty();
+    testWraparound();
+    testFlush();
+    testConcurrent();
+
+    return TEST_RESULT();
+}
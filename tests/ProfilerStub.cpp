@@ -0,0 +1,23 @@
+/*
+ * ProfilerStub.cpp
+ *
+ *  Stands in for GsProfiler.cpp in the unit tests. The profiler stays disabled,
+ *  so no zone is ever recorded.
+ */
+
+#include <base/GsProfiler.h>
+
+std::atomic<bool> GsProfiler::sEnabled(false);
+
+void GsProfileZone::begin(const char *) {}
+void GsProfileZone::end() {}
+
+Uint64 GsProfiler::counter()
+{
+    return SDL_GetTicks();
+}
+
+Uint64 GsProfiler::frequency()
+{
+    return 1000;
+}
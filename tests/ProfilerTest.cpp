@@ -0,0 +1,243 @@
+/*
+ * ProfilerTest.cpp
+ *
+ *  Zones going into the rings of their threads, the rings wrapping around,
+ *  and collecting the samples while a thread goes on recording
+ */
+
+#include "UnitTest.h"
+
+#include <base/GsProfiler.h>
+#include <base/GsTimer.h>
+#include <base/video/CVideoDriver.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Only the overlay needs these, and it is never shown here
+CVideoDriver::CVideoDriver() {}
+CVideoDriver::~CVideoDriver() {}
+CVidConfig::CVidConfig() {}
+CVideoEngine::~CVideoEngine() {}
+bool CVideoEngine::init() { return false; }
+void CVideoEngine::shutdown() {}
+CTimer::CTimer() {}
+CTimer::~CTimer() {}
+
+
+namespace
+{
+
+const char *NAMES[] = { "alpha", "beta", "gamma", "delta" };
+
+// Samples a thread numbered with the given sequence would have recorded
+void recordNumbered(const Uint64 first, const Uint64 count)
+{
+    for(Uint64 seq=first ; seq<first+count ; seq++)
+        gProfiler.record(NAMES[seq % 4], seq, seq*3+1, int(seq % 7));
+}
+
+bool isNumbered(const GsProfileSample &sample)
+{
+    const Uint64 seq = sample.start;
+    return sample.name == NAMES[seq % 4] && sample.end == seq*3+1 && sample.depth == int(seq % 7);
+}
+
+// What is collected from the ring of one thread
+std::vector<GsProfileSample> samplesOfThread(const int thread)
+{
+    std::vector<GsProfileSample> samples;
+    std::vector<int> threads;
+    gProfiler.collectSamples(samples, threads);
+    CHECK_EQ(samples.size(), threads.size());
+
+    std::vector<GsProfileSample> own;
+    for(size_t i=0 ; i<samples.size() ; i++)
+    {
+        if(threads[i] == thread)
+            own.push_back(samples[i]);
+    }
+    return own;
+}
+
+// Number of the thread which recorded the newest sample of that name
+int threadOfLastSample(const char *name)
+{
+    std::vector<GsProfileSample> samples;
+    std::vector<int> threads;
+    gProfiler.collectSamples(samples, threads);
+
+    for(size_t i=samples.size() ; i>0 ; i--)
+    {
+        if(strcmp(samples[i-1].name, name) == 0)
+            return threads[i-1];
+    }
+    return -1;
+}
+
+void recurse(const int levels)
+{
+    GS_PROFILE_ZONE("recurse");
+
+    if(levels > 1)
+        recurse(levels-1);
+}
+
+// Nested zones record their depth and end before the zone around them
+void testZoneDepth()
+{
+    {
+        GS_PROFILE_ZONE("outer");
+        {
+            GS_PROFILE_ZONE("middle");
+            {
+                GS_PROFILE_ZONE("inner");
+            }
+        }
+        GS_PROFILE_ZONE("sibling");
+    }
+
+    const std::vector<GsProfileSample> samples = samplesOfThread(threadOfLastSample("outer"));
+    CHECK(samples.size() >= 4);
+    if(samples.size() < 4)
+        return;
+
+    const GsProfileSample *last = &samples[samples.size()-4];
+    const char *names[] = { "inner", "middle", "sibling", "outer" };
+    const int depths[] = { 2, 1, 1, 0 };
+
+    for(int i=0 ; i<4 ; i++)
+    {
+        CHECK(strcmp(last[i].name, names[i]) == 0);
+        CHECK_EQ(last[i].depth, depths[i]);
+        CHECK(last[i].start <= last[i].end);
+    }
+    CHECK(last[3].start <= last[0].start && last[0].end <= last[3].end);
+
+    // A zone within one of the same name only counts once in the totals
+    gProfiler.keepTotals(true);
+    recurse(5);
+    const std::vector<GsProfileTotal> totals = gProfiler.totals();
+    gProfiler.keepTotals(false);
+
+    CHECK_EQ(totals.size(), size_t(1));
+    if(totals.size() == 1)
+        CHECK_EQ(totals[0].calls, Uint64(1));
+}
+
+// Only the newest RING_SIZE samples are kept, oldest first
+void testWrapAround()
+{
+    const Uint64 count = 2*GsProfiler::RING_SIZE + 123;
+    recordNumbered(0, count);
+
+    const std::vector<GsProfileSample> samples = samplesOfThread(threadOfLastSample(NAMES[(count-1) % 4]));
+    CHECK_EQ(samples.size(), size_t(GsProfiler::RING_SIZE));
+
+    bool inOrder = true;
+    for(size_t i=0 ; i<samples.size() ; i++)
+        inOrder &= (samples[i].start == count-GsProfiler::RING_SIZE+i) && isNumbered(samples[i]);
+    CHECK(inOrder);
+}
+
+// Another thread records into a ring of its own and leaves that of this thread alone
+void testSecondThread()
+{
+    const int mainThread = threadOfLastSample(NAMES[0]);
+    const std::vector<GsProfileSample> before = samplesOfThread(mainThread);
+
+    std::thread other([]()
+    {
+        GS_PROFILE_ZONE("otherThread");
+        recordNumbered(1000, 100);
+    });
+    other.join();
+
+    const int otherThread = threadOfLastSample("otherThread");
+    CHECK(otherThread != mainThread);
+
+    const std::vector<GsProfileSample> samples = samplesOfThread(otherThread);
+    CHECK_EQ(samples.size(), size_t(101));
+
+    bool numbered = true;
+    for(size_t i=0 ; i<100 && i<samples.size() ; i++)
+        numbered &= (samples[i].start == 1000+i) && isNumbered(samples[i]);
+    CHECK(numbered);
+
+    const std::vector<GsProfileSample> after = samplesOfThread(mainThread);
+    CHECK_EQ(after.size(), before.size());
+}
+
+// A thread writing all the time overwrites samples while they are copied.
+// Those are left out, all others come complete and in order.
+void testCollectWhileRecording()
+{
+    std::atomic<bool> ready(false);
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+
+    std::thread writer([&]()
+    {
+        gProfiler.record("writer", 0, 0, 0);
+        ready = true;
+        while(!go)
+            std::this_thread::yield();
+
+        for(Uint64 seq=0 ; !stop ; seq += 64)
+            recordNumbered(seq, 64);
+    });
+
+    while(!ready)
+        std::this_thread::yield();
+
+    const int thread = threadOfLastSample("writer");
+    go = true;
+
+    size_t collections = 0;
+    bool intact = true;
+
+    for(int round=0 ; round<200 ; round++)
+    {
+        const std::vector<GsProfileSample> samples = samplesOfThread(thread);
+
+        // Apart from the first one they follow each other without a gap
+        size_t numbered = 0;
+        Uint64 last = 0;
+        for(const GsProfileSample &sample : samples)
+        {
+            if(strcmp(sample.name, "writer") == 0)
+                continue;
+
+            intact &= isNumbered(sample);
+            intact &= (numbered == 0 || sample.start == last+1);
+            last = sample.start;
+            numbered++;
+        }
+
+        intact &= (samples.size() <= GsProfiler::RING_SIZE);
+        collections += (numbered > 0);
+        std::this_thread::yield();
+    }
+
+    stop = true;
+    writer.join();
+
+    CHECK(intact);
+    CHECK(collections > 0);
+}
+
+}
+
+int main()
+{
+    gProfiler.setEnabled(true);
+
+    testZoneDepth();
+    testWrapAround();
+    testSecondThread();
+    testCollectWhileRecording();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/*
+ * RefKeenTimerTest.cpp
+ *
+ *  TimeCount of Keen Dreams and the waits on it, counted from a clock of the test
+ */
+
+#include "UnitTest.h"
+
+extern "C"
+{
+#include <engine/refkeen/be_st.h>
+}
+
+#include <vector>
+
+namespace
+{
+
+const uint64_t PIT_RATE = 1193182;
+
+// About 70 ticks a second, as Keen Dreams sets the timer up
+const uint16_t TIMER_SPEED = 8522;
+const uint64_t DIVISOR = 2*TIMER_SPEED;
+
+// Sleeps overshoot by a bit, a yield takes a few counts.
+// Only sleeping moves the clock on during a wait, so one which spins without yielding never ends.
+uint64_t gCounter = 0;
+uint64_t gFrequency = 1;
+std::vector<uint32_t> gSleeps;
+
+uint64_t fakeCounter()
+{
+    return gCounter;
+}
+
+void fakeDelay(uint32_t ms)
+{
+    gSleeps.push_back(ms);
+    gCounter += (ms > 0) ? ms*gFrequency/1000 + gFrequency/2000 : 1 + gFrequency/200000;
+}
+
+void startClock(const uint64_t frequency, const uint64_t start)
+{
+    gFrequency = frequency;
+    gCounter = start;
+    gSleeps.clear();
+    BE_ST_SetCounterSource(fakeCounter, frequency, fakeDelay);
+    BE_ST_SetTimer(TIMER_SPEED, false);
+    BE_ST_SetTimeCount(0);
+}
+
+struct Random
+{
+    unsigned int seed = 815;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// Read at any points in time, TimeCount is the number of whole ticks gone by.
+// Millisecond counters of SDL 1.2, those of Windows and nanoseconds all count the same.
+void testTickCount()
+{
+    const uint64_t frequencies[] = { 1000, 10000000, 1000000000 };
+
+    for(const uint64_t frequency : frequencies)
+    {
+        const uint64_t start = 12345*frequency;
+        startClock(frequency, start);
+
+        Random rnd;
+        while(gCounter - start < 100*frequency)
+        {
+            gCounter += 1 + rnd.next() % (frequency/10);
+            // 100 seconds of nanoseconds times PIT_RATE still fit
+            const uint64_t expected = (gCounter - start)*PIT_RATE/(frequency*DIVISOR);
+            CHECK_EQ(BE_ST_GetTimeCount(), uint32_t(expected));
+        }
+    }
+}
+
+// Ten days of nanoseconds times PIT_RATE don't fit into 64 bits
+void testLongPause()
+{
+    const uint64_t frequency = 1000000000;
+    startClock(frequency, 0);
+
+    // 864000.5 seconds
+    gCounter += 864000*frequency + frequency/2;
+    CHECK_EQ(BE_ST_GetTimeCount(), uint32_t(1728001*PIT_RATE/(2*DIVISOR)));
+
+    // The fraction of a tick left over still counts
+    gCounter += frequency/2;
+    CHECK_EQ(BE_ST_GetTimeCount(), uint32_t(864001*PIT_RATE/DIVISOR));
+}
+
+// A wait ends on the first count of the tick it waits for, only a yield later
+void testWait()
+{
+    const uint64_t frequency = 1000000000;
+    startClock(frequency, 0);
+
+    Random rnd;
+    for(int i=0 ; i<200 ; i++)
+    {
+        gCounter += rnd.next() % (frequency/50);
+        const uint32_t src = BE_ST_GetTimeCount();
+        const int16_t timetowait = int16_t(1 + rnd.next() % 35);
+        BE_ST_TimeCountWaitFromSrc(src, timetowait);
+
+        const uint64_t target = src + uint64_t(timetowait);
+        // First count at which target*DIVISOR/PIT_RATE seconds went by
+        const uint64_t due = (target*DIVISOR*frequency + PIT_RATE - 1)/PIT_RATE;
+        CHECK(gCounter >= due);
+        CHECK(gCounter <= due + 1 + frequency/200000);
+        CHECK_EQ(BE_ST_GetTimeCount(), uint32_t(target));
+    }
+
+    // Waits already over don't sleep at all
+    gSleeps.clear();
+    BE_ST_TimeCountWaitFromSrc(BE_ST_GetTimeCount() - 5, 3);
+    CHECK(gSleeps.empty());
+}
+
+// Ticks so far count at the old rate, the new one starts with the call
+void testRateChange()
+{
+    const uint64_t frequency = 1000;
+    startClock(frequency, 0);
+
+    gCounter += 1500;
+    const uint32_t before = BE_ST_GetTimeCount();
+    CHECK_EQ(before, uint32_t(1500*PIT_RATE/(frequency*DIVISOR)));
+
+    BE_ST_SetTimer(TIMER_SPEED, true);
+    gCounter += 1000;
+    CHECK_EQ(BE_ST_GetTimeCount(), uint32_t(before + 1000*PIT_RATE/(frequency*4*DIVISOR)));
+}
+
+}
+
+int main()
+{
+    testTickCount();
+    testLongPause();
+    testWait();
+    testRateChange();
+
+    BE_ST_SetCounterSource(nullptr, 0, nullptr);
+
+    return TEST_RESULT();
+}
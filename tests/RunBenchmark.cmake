@@ -0,0 +1,39 @@
+# Runs a short benchmark of a recorded session, see GsBenchmark.h.
+#
+# CG_BENCH_DATA is a directory with the game data and benchmark.cgir in it, recorded there
+# with "dir=<game> record=benchmark.cgir". CG_BENCH_GAME is that game, games/keen4 if not set.
+# Without CG_BENCH_DATA the test is skipped, the game data can't come with the sources.
+#
+#   cmake -DCG_EXE=<CGenius executable> -P RunBenchmark.cmake
+
+if("$ENV{CG_BENCH_DATA}" STREQUAL "")
+    message("CG_BENCH_DATA is not set, skipping the benchmark")
+    return()
+endif()
+
+set(game "$ENV{CG_BENCH_GAME}")
+if(game STREQUAL "")
+    set(game "games/keen4")
+endif()
+
+set(ticks 350)
+
+execute_process(COMMAND ${CG_EXE} dir=${game} replay=benchmark.cgir benchmark=${ticks}
+                WORKING_DIRECTORY $ENV{CG_BENCH_DATA}
+                RESULT_VARIABLE result
+                OUTPUT_VARIABLE output)
+
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "The benchmark failed (${result}):\n${output}")
+endif()
+
+# The gameplay came up, all ticks ran and the replay didn't go its own way
+foreach(expected "\"gameplay\": true" "\"ticks\": ${ticks}" "\"replay_diverging_tick\": -1"
+                 "\"logic\"" "\"collision\"" "\"render\"" "\"scale\"" "\"audio\"")
+    string(FIND "${output}" "${expected}" pos)
+    if(pos EQUAL -1)
+        message(FATAL_ERROR "${expected} is missing in the report:\n${output}")
+    endif()
+endforeach()
+
+message("${output}")
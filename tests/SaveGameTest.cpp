@@ -0,0 +1,291 @@
+/*
+ * SaveGameTest.cpp
+ *
+ *  Round trip of the savegame data block, and what is left after interrupted writes
+ */
+
+#include "UnitTest.h"
+
+#include <fileio/CSaveGameController.h>
+#include <fileio/KeenFiles.h>
+#include <engine/core/CBehaviorEngine.h>
+#include <base/utils/FindFile.h>
+#include <base/utils/ThreadPool.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The controller only asks these for the episode and the game directory
+CExeFile::CExeFile() {}
+CExeFile::~CExeFile() {}
+CPhysicsSettings::CPhysicsSettings() {}
+size_t CBehaviorEngine::getEpisode() { return 4; }
+
+// Only the conversion of savegames from CG 0.3 uses these
+void sgrle_initdecompression(void) {}
+void sgrle_compress(FILE*, unsigned char*, unsigned long) {}
+char sgrle_decompressV2(FILE*, unsigned char*, unsigned long) { return 1; }
+void sgrle_decompressV1(FILE*, unsigned char*, unsigned long) {}
+
+
+namespace
+{
+
+std::string gScratchDir;
+
+struct Position
+{
+    Sint32 x, y;
+    bool blocked[4];
+};
+
+std::string slotPath(const int slot)
+{
+    return gScratchDir + "/save/cksave" + itoa(slot) + ".ck4";
+}
+
+std::vector<char> readWhole(const std::string &path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeWhole(const std::string &path, const std::vector<char> &data)
+{
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(data.data(), std::streamsize(data.size()));
+}
+
+// Values of every kind the games store, the level number tells the savegames apart
+void saveSlot(CSaveGameController &controller, const int slot, const int level)
+{
+    controller.prepareSaveGame(slot, "Slot " + itoa(slot));
+
+    controller.encodeData(true);
+    controller.encodeData(static_cast<Uint8>(200));
+    controller.encodeData(static_cast<Sint16>(-1234));
+    controller.encodeData(static_cast<Uint32>(0xDEADBEEF));
+    controller.encodeData(level);
+    controller.encodeData(static_cast<Sint64>(-1) << 40);
+    controller.encodeData(1.5f);
+    controller.encodeData(-0.125);
+
+    Position pos = { 3200, -16, { true, false, false, true } };
+    controller.encodeData(pos);
+
+    std::vector<word> map(320*200);
+    for(size_t i=0 ; i<map.size() ; i++)
+        map[i] = word((i % 320)*7 + level);
+    controller.addData(reinterpret_cast<byte*>(map.data()), Uint32(2*map.size()));
+    controller.addData(nullptr, 0);
+
+    CHECK(controller.save());
+}
+
+bool loadSlot(CSaveGameController &controller, const int slot, int &level)
+{
+    controller.prepareLoadGame(slot);
+    if(!controller.load())
+        return false;
+
+    bool flag = false;
+    Uint8 byteValue = 0;
+    Sint16 shortValue = 0;
+    Uint32 longValue = 0;
+    Sint64 wideValue = 0;
+    float floatValue = 0;
+    double doubleValue = 0;
+    Position pos;
+    memset(&pos, 0, sizeof(pos));
+
+    CHECK(controller.decodeData(flag));
+    CHECK(controller.decodeData(byteValue));
+    CHECK(controller.decodeData(shortValue));
+    CHECK(controller.decodeData(longValue));
+    CHECK(controller.decodeData(level));
+    CHECK(controller.decodeData(wideValue));
+    CHECK(controller.decodeData(floatValue));
+    CHECK(controller.decodeData(doubleValue));
+    CHECK(controller.decodeData(pos));
+
+    CHECK(flag);
+    CHECK_EQ(byteValue, Uint8(200));
+    CHECK_EQ(shortValue, Sint16(-1234));
+    CHECK_EQ(longValue, Uint32(0xDEADBEEF));
+    CHECK_EQ(wideValue, static_cast<Sint64>(-1) << 40);
+    CHECK_EQ(floatValue, 1.5f);
+    CHECK_EQ(doubleValue, -0.125);
+    CHECK_EQ(pos.x, 3200);
+    CHECK_EQ(pos.y, -16);
+    CHECK(pos.blocked[0] && !pos.blocked[1] && !pos.blocked[2] && pos.blocked[3]);
+
+    std::vector<word> map(320*200);
+    CHECK(controller.readDataBlock(reinterpret_cast<byte*>(map.data())));
+    bool mapOk = true;
+    for(size_t i=0 ; i<map.size() ; i++)
+        mapOk &= (map[i] == word((i % 320)*7 + level));
+    CHECK(mapOk);
+
+    byte nothing = 0;
+    CHECK(controller.readDataBlock(&nothing));
+
+    // Nothing more in there
+    CHECK(!controller.readDataBlock(&nothing));
+    return true;
+}
+
+void testRoundTrip()
+{
+    CSaveGameController controller;
+    saveSlot(controller, 1, 7);
+
+    int level = 0;
+    CHECK(loadSlot(controller, 1, level));
+    CHECK_EQ(level, 7);
+
+    // The block is deflated on disk
+    CHECK(readWhole(slotPath(1)).size() < 320*200/4);
+
+    std::vector<std::string> slots;
+    CHECK(controller.readSlotList(slots));
+    CHECK_EQ(slots.size(), size_t(1));
+    CHECK_EQ(slots[0], std::string("Slot 1"));
+}
+
+// Version 6 savegames have the data block stored as it is
+void testOldVersion()
+{
+    std::vector<char> file;
+    file.push_back(OLDSAVEGAMEVERSION6);
+    file.push_back(5);
+    file.insert(file.end(), "Old 2", "Old 2"+5);
+
+    const Uint32 size = sizeof(Uint16);
+    const Uint16 value = 0x4321;
+    file.insert(file.end(), reinterpret_cast<const char*>(&size), reinterpret_cast<const char*>(&size)+sizeof(size));
+    file.insert(file.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value)+sizeof(value));
+    writeWhole(slotPath(2), file);
+
+    CSaveGameController controller;
+    controller.prepareLoadGame(2);
+    CHECK(controller.load());
+
+    Uint16 loaded = 0;
+    CHECK(controller.readDataBlock(reinterpret_cast<byte*>(&loaded)));
+    CHECK_EQ(loaded, value);
+
+    std::vector<std::string> slots;
+    CHECK(controller.readSlotList(slots));
+    CHECK_EQ(slots.size(), size_t(2));
+    CHECK_EQ(slots[1], std::string("Old 2"));
+
+    remove(slotPath(2).c_str());
+}
+
+// A crash while writing leaves a temporary file, possibly cut off.
+// The savegame itself stays the previous one, and the next save goes through.
+void testCrashedWrite()
+{
+    CSaveGameController controller;
+    saveSlot(controller, 1, 7);
+    CHECK(controller.finishPendingSave());
+
+    const std::string tempPath = slotPath(1) + ".tmp";
+    std::vector<char> partial = readWhole(slotPath(1));
+    partial.resize(partial.size()/2);
+    writeWhole(tempPath, partial);
+
+    int level = 0;
+    CHECK(loadSlot(controller, 1, level));
+    CHECK_EQ(level, 7);
+
+    saveSlot(controller, 1, 8);
+    CHECK(loadSlot(controller, 1, level));
+    CHECK_EQ(level, 8);
+    CHECK(access(tempPath.c_str(), F_OK) != 0);
+}
+
+// A write which fails half way reports that, and the previous savegame still loads
+void testFailedWrite()
+{
+    CSaveGameController controller;
+    saveSlot(controller, 1, 7);
+    CHECK(controller.finishPendingSave());
+
+    // Nothing can be written under the temporary name
+    const std::string tempPath = slotPath(1) + ".tmp";
+    CHECK_EQ(mkdir(tempPath.c_str(), 0700), 0);
+
+    controller.prepareSaveGame(1, "Slot 1");
+    controller.encodeData(9);
+    controller.save();
+    CHECK(!controller.finishPendingSave());
+
+    int level = 0;
+    CHECK(loadSlot(controller, 1, level));
+    CHECK_EQ(level, 7);
+
+    rmdir(tempPath.c_str());
+}
+
+// A savegame cut off anywhere after its header doesn't load
+void testTruncatedFile()
+{
+    CSaveGameController controller;
+    saveSlot(controller, 1, 7);
+    CHECK(controller.finishPendingSave());
+
+    const std::vector<char> good = readWhole(slotPath(1));
+    const size_t header = 2 + strlen("Slot 1") + sizeof(Uint32);
+
+    size_t accepted = 0;
+    for(size_t len=header ; len<good.size() ; len += 97)
+    {
+        writeWhole(slotPath(1), std::vector<char>(good.begin(), good.begin()+len));
+        controller.prepareLoadGame(1);
+        if(controller.load())
+            accepted++;
+    }
+    CHECK_EQ(accepted, size_t(0));
+
+    writeWhole(slotPath(1), good);
+}
+
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/cgsavegameXXXXXX";
+    if(!mkdtemp(dirTemplate))
+    {
+        std::fprintf(stderr, "Could not create a scratch directory\n");
+        return 1;
+    }
+    gScratchDir = dirTemplate;
+    tSearchPaths.push_back(gScratchDir);
+
+    // Savegames are written by the writer thread, like in the game
+    InitThreadPool();
+
+    testRoundTrip();
+    testOldVersion();
+    testCrashedWrite();
+    testFailedWrite();
+    testTruncatedFile();
+
+    UnInitThreadPool();
+
+    remove(slotPath(1).c_str());
+    rmdir((gScratchDir + "/save").c_str());
+    rmdir(gScratchDir.c_str());
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,286 @@
+/*
+ * SchedulerTest.cpp
+ *
+ *  Tick counts and frame pacing of the main cycle's scheduler, on a clock of the test
+ */
+
+#include "UnitTest.h"
+
+#include <base/GsScheduler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+
+const Uint64 NS_PER_SEC = 1000000000;
+const Uint64 NS_PER_MS = 1000000;
+
+struct Random
+{
+    unsigned int seed = 815;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// Sleeps overshoot like those of a real system, by up to overshootSpread more
+// if that is set. A yield takes a few microseconds.
+// Only sleeping moves the clock on, so a wait which spins without yielding never ends.
+struct FakeTime
+{
+    Uint64 ns = 0;
+    Uint64 overshoot = 700000;
+    Uint64 overshootSpread = 0;
+    std::vector<Uint32> sleeps;
+    Random rnd;
+
+    void sleep(const Uint32 ms)
+    {
+        sleeps.push_back(ms);
+
+        if(ms == 0)
+            ns += 5000;
+        else
+            ns += ms*NS_PER_MS + overshoot + (overshootSpread ? rnd.next() % overshootSpread : 0);
+    }
+
+    GsScheduler scheduler()
+    {
+        return GsScheduler([this]() { return ns; }, NS_PER_SEC,
+                           [this](const Uint32 ms) { sleep(ms); });
+    }
+};
+
+// Deadline errors in ns, sorted
+struct JitterStats
+{
+    std::vector<Uint64> errors;
+
+    Uint64 percentile(const int p) const
+    {   return errors.empty() ? 0 : errors[(errors.size()-1)*p/100];   }
+
+    double meanUs() const
+    {
+        double sum = 0.0;
+        for(const Uint64 error : errors)
+            sum += double(error);
+        return errors.empty() ? 0.0 : sum/errors.size()/1000.0;
+    }
+
+    void print(const char *what) const
+    {
+        std::printf("  %-28s mean %8.1f us, median %8.1f us, p99 %8.1f us, max %8.1f us\n", what,
+                    meanUs(), percentile(50)/1000.0, percentile(99)/1000.0, errors.back()/1000.0);
+    }
+};
+
+// However the frames fall, 70 LPS make exactly 700 ticks in ten seconds
+void testExactTickCount()
+{
+    FakeTime time;
+    GsScheduler scheduler = time.scheduler();
+    scheduler.setTickRate(70.0f);
+    scheduler.reset();
+
+    Random rnd;
+    Uint64 ticks = 0;
+    while(time.ns < 10*NS_PER_SEC)
+    {
+        time.ns = std::min(time.ns + 1 + rnd.next() % (100*NS_PER_MS), 10*NS_PER_SEC);
+        ticks += Uint64(scheduler.beginFrame());
+    }
+
+    CHECK_EQ(ticks, Uint64(700));
+    CHECK_EQ(scheduler.droppedTicks(), Uint64(0));
+
+    // Fractional rates aren't rounded either
+    scheduler.setTickRate(59.94f);
+    scheduler.reset();
+    ticks = 0;
+    for(int frame=0 ; frame<1000 ; frame++)
+    {
+        time.ns += NS_PER_SEC/100;
+        ticks += Uint64(scheduler.beginFrame());
+    }
+    CHECK_EQ(ticks, Uint64(599));
+}
+
+// Every frame ends on its deadline, not before and only a yield after
+void testFramePacing()
+{
+    FakeTime time;
+    GsScheduler scheduler = time.scheduler();
+    scheduler.setTickRate(70.0f);
+    scheduler.setFrameRate(60.0f);
+    scheduler.reset();
+
+    Random rnd;
+    for(Uint64 frame=1 ; frame<=600 ; frame++)
+    {
+        scheduler.beginFrame();
+        time.ns += rnd.next() % (10*NS_PER_MS);
+        scheduler.endFrame(false);
+
+        const Uint64 deadline = frame*NS_PER_SEC/60;
+        CHECK(time.ns >= deadline);
+        CHECK(time.ns < deadline + 10000);
+    }
+
+    // The last bit of each wait is spun with yields
+    size_t yields = 0;
+    for(const Uint32 ms : time.sleeps)
+    {
+        if(ms == 0)
+            yields++;
+    }
+    CHECK(yields > 600);
+    CHECK(yields < time.sleeps.size());
+}
+
+// A frame which took far too long doesn't make the following ones hurry
+void testLateFrame()
+{
+    FakeTime time;
+    GsScheduler scheduler = time.scheduler();
+    scheduler.setFrameRate(60.0f);
+    scheduler.reset();
+
+    scheduler.beginFrame();
+    time.ns += 100*NS_PER_MS;
+    scheduler.endFrame(false);
+    CHECK_EQ(time.ns, 100*NS_PER_MS);
+
+    scheduler.beginFrame();
+    scheduler.endFrame(false);
+    CHECK(time.ns >= 100*NS_PER_MS + NS_PER_SEC/60);
+    CHECK(time.ns < 100*NS_PER_MS + NS_PER_SEC/60 + 10000);
+}
+
+void testTickClamp()
+{
+    FakeTime time;
+    GsScheduler scheduler = time.scheduler();
+    scheduler.setTickRate(70.0f);
+    scheduler.reset();
+
+    time.ns += NS_PER_SEC/2;
+    CHECK_EQ(scheduler.beginFrame(), GsScheduler::MAX_TICKS_PER_FRAME);
+    CHECK_EQ(scheduler.droppedTicks(), Uint64(35 - GsScheduler::MAX_TICKS_PER_FRAME));
+
+    time.ns += NS_PER_SEC/70 + 1;
+    CHECK_EQ(scheduler.beginFrame(), 1);
+}
+
+// How late 60 frames a second end, with sleeps overshooting by 0-1, 0-2 and 1-4 ms.
+// The scheduler is compared with sleeping the rest of the frame in whole milliseconds,
+// as the main cycle did before. The statistics are reported, the bounds checked.
+void benchmarkJitter()
+{
+    const Uint64 overshoots[][2] = { { 0, NS_PER_MS }, { 0, 2*NS_PER_MS }, { NS_PER_MS, 3*NS_PER_MS } };
+    const int NUM_FRAMES = 6000;
+
+    for(const auto &overshoot : overshoots)
+    {
+        std::printf("Frame deadline error, sleeps overshooting by %.0f-%.0f ms:\n",
+                    double(overshoot[0])/NS_PER_MS, double(overshoot[0]+overshoot[1])/NS_PER_MS);
+
+        FakeTime time;
+        time.overshoot = overshoot[0];
+        time.overshootSpread = overshoot[1];
+        GsScheduler scheduler = time.scheduler();
+        scheduler.setTickRate(70.0f);
+        scheduler.setFrameRate(60.0f);
+        scheduler.reset();
+
+        Random work;
+        JitterStats paced;
+        for(Uint64 frame=1 ; frame<=NUM_FRAMES ; frame++)
+        {
+            scheduler.beginFrame();
+            time.ns += work.next() % (10*NS_PER_MS);
+            scheduler.endFrame(false);
+            paced.errors.push_back(time.ns - frame*NS_PER_SEC/60);
+        }
+
+        const double sleepsPerFrame = double(time.sleeps.size())/NUM_FRAMES;
+
+        // Each frame sleeps what is left of its 16 ms, starting from where the last one ended
+        FakeTime naiveTime;
+        naiveTime.overshoot = overshoot[0];
+        naiveTime.overshootSpread = overshoot[1];
+
+        JitterStats naive;
+        Uint64 deadline = 0;
+        for(Uint64 frame=1 ; frame<=NUM_FRAMES ; frame++)
+        {
+            const Uint64 start = naiveTime.ns;
+            naiveTime.ns += work.next() % (10*NS_PER_MS);
+
+            const Uint64 spent = naiveTime.ns - start;
+            if(spent < NS_PER_SEC/60)
+                naiveTime.sleep(Uint32((NS_PER_SEC/60 - spent)/NS_PER_MS));
+
+            deadline += NS_PER_SEC/60;
+            naive.errors.push_back(naiveTime.ns > deadline ? naiveTime.ns - deadline : 0);
+        }
+
+        std::sort(paced.errors.begin(), paced.errors.end());
+        std::sort(naive.errors.begin(), naive.errors.end());
+        paced.print("scheduler:");
+        naive.print("sleeping the rest:");
+        std::printf("  %.1f sleeps and yields per frame\n", sleepsPerFrame);
+
+        // Sleeps overshooting less than the spin margin leave only a yield of error
+        if(overshoot[0]+overshoot[1] <= GsScheduler::SPIN_MARGIN_NS)
+            CHECK(paced.errors.back() < 10000);
+
+        // Never more than the sleep's overshoot beyond the spin margin, and never falling behind
+        CHECK(paced.errors.back() < overshoot[0]+overshoot[1]);
+        CHECK(paced.percentile(99) < naive.percentile(99));
+    }
+}
+
+// With vsync or without limit nothing is waited for
+void testNoWait()
+{
+    FakeTime time;
+    GsScheduler scheduler = time.scheduler();
+    scheduler.setFrameRate(60.0f);
+    scheduler.reset();
+
+    for(int frame=0 ; frame<10 ; frame++)
+    {
+        scheduler.beginFrame();
+        scheduler.endFrame(true);
+    }
+
+    scheduler.setFrameRate(0.0f);
+    for(int frame=0 ; frame<10 ; frame++)
+    {
+        scheduler.beginFrame();
+        scheduler.endFrame(false);
+    }
+
+    CHECK(time.sleeps.empty());
+    CHECK_EQ(time.ns, Uint64(0));
+}
+
+}
+
+int main()
+{
+    testExactTickCount();
+    testFramePacing();
+    testLateFrame();
+    testTickClamp();
+    testNoWait();
+    benchmarkJitter();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+/*
+ * SnapshotRingTest.cpp
+ *
+ *  Storing and rebuilding the snapshots the Galaxy levels are rewound with
+ */
+
+#include "UnitTest.h"
+
+#include <engine/core/CSnapshotRing.h>
+
+#include <vector>
+
+namespace
+{
+
+struct Random
+{
+    unsigned int seed = 4711;
+
+    unsigned int next()
+    {
+        seed = seed*1103515245 + 12345;
+        return seed >> 8;
+    }
+};
+
+// A fixed part which changes in a few bytes per tick, followed by a part that changes its size
+std::vector< std::vector<byte> > makeSnapshots(const size_t count)
+{
+    Random rnd;
+    std::vector< std::vector<byte> > snapshots;
+
+    std::vector<byte> state(4096);
+    for(auto &b : state)
+        b = byte(rnd.next());
+
+    for(size_t n=0 ; n<count ; n++)
+    {
+        for(int i=0 ; i<4 ; i++)
+            state[rnd.next() % 4096] = byte(rnd.next());
+
+        std::vector<byte> snapshot(state);
+        const size_t tail = 16 + rnd.next() % 64;
+        for(size_t i=0 ; i<tail ; i++)
+            snapshot.push_back(byte(n+i));
+
+        snapshots.push_back(snapshot);
+    }
+
+    return snapshots;
+}
+
+void testRoundTrip()
+{
+    const auto snapshots = makeSnapshots(50);
+
+    CSnapshotRing ring;
+    ring.reset(100, 16);
+
+    for(const auto &snapshot : snapshots)
+        ring.push(snapshot);
+
+    CHECK_EQ(ring.size(), snapshots.size());
+
+    std::vector<byte> rebuilt;
+    for(size_t age=0 ; age<snapshots.size() ; age++)
+    {
+        CHECK(ring.get(age, rebuilt));
+        CHECK(rebuilt == snapshots[snapshots.size()-1-age]);
+    }
+
+    CHECK(!ring.get(snapshots.size(), rebuilt));
+
+    // The deltas are mostly zeros, so the ring takes much less than the snapshots themselves
+    CHECK(ring.memoryUsage() < snapshots.size()*snapshots[0].size()/4);
+}
+
+// Once full, the oldest keyframe goes together with its deltas
+void testEviction()
+{
+    const auto snapshots = makeSnapshots(100);
+
+    CSnapshotRing ring;
+    ring.reset(30, 10);
+
+    for(const auto &snapshot : snapshots)
+    {
+        ring.push(snapshot);
+        CHECK(ring.size() <= 30);
+    }
+
+    CHECK(ring.size() > 20);
+
+    std::vector<byte> rebuilt;
+    for(size_t age=0 ; age<ring.size() ; age++)
+    {
+        CHECK(ring.get(age, rebuilt));
+        CHECK(rebuilt == snapshots[snapshots.size()-1-age]);
+    }
+}
+
+// After rewinding, play goes on from an older snapshot
+void testDropNewest()
+{
+    const auto snapshots = makeSnapshots(40);
+
+    CSnapshotRing ring;
+    ring.reset(100, 8);
+
+    for(size_t n=0 ; n<30 ; n++)
+        ring.push(snapshots[n]);
+
+    ring.dropNewest(13);
+    CHECK_EQ(ring.size(), size_t(17));
+
+    std::vector<byte> rebuilt;
+    CHECK(ring.get(0, rebuilt));
+    CHECK(rebuilt == snapshots[16]);
+
+    for(size_t n=30 ; n<40 ; n++)
+        ring.push(snapshots[n]);
+
+    CHECK(ring.get(0, rebuilt));
+    CHECK(rebuilt == snapshots[39]);
+    CHECK(ring.get(10, rebuilt));
+    CHECK(rebuilt == snapshots[16]);
+    CHECK(ring.get(11, rebuilt));
+    CHECK(rebuilt == snapshots[15]);
+
+    ring.dropNewest(100);
+    CHECK_EQ(ring.size(), size_t(0));
+    CHECK(!ring.get(0, rebuilt));
+}
+
+void testDisabled()
+{
+    CSnapshotRing ring;
+    ring.reset(0, 10);
+    ring.push(std::vector<byte>(10, 1));
+    CHECK_EQ(ring.size(), size_t(0));
+}
+
+}
+
+int main()
+{
+    testRoundTrip();
+    testEviction();
+    testDropNewest();
+    testDisabled();
+
+    return TEST_RESULT();
+}
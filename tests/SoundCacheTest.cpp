@@ -0,0 +1,295 @@
+/*
+ * SoundCacheTest.cpp
+ *
+ *  Keying and round trip of the cached sound effect waveforms
+ */
+
+#include "UnitTest.h"
+
+#include <sdl/audio/sound/CSoundCache.h>
+#include <base/utils/FindFile.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The cache only needs the waveform of the slots, so they keep just that here
+// instead of pulling in the mixer.
+CSoundSlot::CSoundSlot() : priority(0), mHasCommonFreqBase(true), mOggFreq(0)
+{}
+
+CSoundSlot::~CSoundSlot()
+{}
+
+void CSoundSlot::unload()
+{
+    mSounddata.clear();
+    m_soundlength = 0;
+}
+
+void CSoundSlot::setupWaveForm( Uint8 *buf, Uint32 len )
+{
+    mSounddata.assign(buf, buf+len);
+    m_soundlength = len;
+}
+
+
+// Game files go into a scratch directory of the test
+namespace
+{
+    std::string gScratchDir;
+}
+
+std::string JoinPaths(const std::string& path1, const std::string& path2)
+{
+    return path1 + "/" + path2;
+}
+
+std::string GetWriteFullFileName(const std::string& path, bool)
+{
+    return gScratchDir + "/" + path;
+}
+
+bool OpenGameFileR(std::ifstream& f, const std::string& path, std::ios_base::openmode mode)
+{
+    f.open(GetWriteFullFileName(path, false).c_str(), mode | std::ios_base::in);
+    return f.is_open();
+}
+
+bool OpenGameFileW(std::ofstream& f, const std::string& path, std::ios_base::openmode mode)
+{
+    f.open(GetWriteFullFileName(path, true).c_str(), mode | std::ios_base::out);
+    return f.is_open();
+}
+
+
+namespace
+{
+
+SoundCacheKey makeKey()
+{
+    SoundCacheKey key;
+    key.audioCrc = 0x12345678;
+    key.hedCrc = 0x9ABCDEF0;
+    key.dictCrc = 0;
+    key.freq = 44100;
+    key.format = AUDIO_S16;
+    key.channels = 2;
+    return key;
+}
+
+std::vector<CSoundSlot> makeSlots()
+{
+    std::vector<CSoundSlot> slots(3);
+
+    std::vector<Uint8> wave(37);
+    for(size_t i=0 ; i<wave.size() ; i++)
+        wave[i] = Uint8(i*7);
+
+    slots[0].setupWaveForm(wave.data(), Uint32(wave.size()));
+    slots[0].priority = 5;
+    // slots[1] stays empty, like a sound which could not be read
+    wave.resize(100, 0x55);
+    slots[2].setupWaveForm(wave.data(), Uint32(wave.size()));
+    slots[2].priority = 9;
+
+    return slots;
+}
+
+void testChecksum()
+{
+    const Uint8 data[] = { 1, 2, 3, 4, 5, 6, 0, 0 };
+
+    CHECK_EQ(CSoundCache::checksum(data, 6), CSoundCache::checksum(data, 6));
+
+    // Trailing zeros and a tail that is not a multiple of four still count
+    CHECK(CSoundCache::checksum(data, 6) != CSoundCache::checksum(data, 8));
+    CHECK(CSoundCache::checksum(data, 5) != CSoundCache::checksum(data, 6));
+    CHECK(CSoundCache::checksum(data, 0) != CSoundCache::checksum(data, 1));
+}
+
+void testRoundTrip()
+{
+    const std::vector<CSoundSlot> slots = makeSlots();
+    const std::vector<char> soundRead = { 1, 0, 1 };
+
+    const CSoundCache cache(makeKey());
+    CHECK(cache.save(slots, soundRead));
+
+    std::vector<CSoundSlot> loaded(3);
+    std::vector<char> loadedRead;
+    CHECK(cache.load(loaded, loadedRead));
+
+    CHECK(loadedRead == soundRead);
+    for(size_t snd=0 ; snd<slots.size() ; snd++)
+    {
+        CHECK_EQ(loaded[snd].priority, slots[snd].priority);
+        CHECK_EQ(loaded[snd].getSoundlength(), slots[snd].getSoundlength());
+        CHECK(memcmp(loaded[snd].getSoundData(), slots[snd].getSoundData(),
+                     slots[snd].getSoundlength()) == 0);
+    }
+
+    // A different number of sounds is a miss
+    std::vector<CSoundSlot> fewer(2);
+    CHECK(!cache.load(fewer, loadedRead));
+}
+
+// Whatever the waveforms depend on has to make a miss once it differs
+void testKeyMismatch()
+{
+    const std::vector<CSoundSlot> slots = makeSlots();
+    const std::vector<char> soundRead = { 1, 1, 1 };
+    CHECK(CSoundCache(makeKey()).save(slots, soundRead));
+
+    std::vector<SoundCacheKey> others(6, makeKey());
+    others[0].hedCrc++;
+    others[1].dictCrc = 0xDEADBEEF;
+    others[2].freq = 48000;
+    others[3].format = AUDIO_U8;
+    others[4].channels = 1;
+    others[5].synthVersion++;
+
+    for(const SoundCacheKey &key : others)
+    {
+        CHECK(!(key == makeKey()));
+
+        std::vector<CSoundSlot> loaded(3);
+        std::vector<char> loadedRead;
+        CHECK(!CSoundCache(key).load(loaded, loadedRead));
+
+        // The slots stay untouched on a miss
+        CHECK_EQ(loaded[0].getSoundlength(), 0u);
+    }
+
+    std::vector<CSoundSlot> loaded(3);
+    std::vector<char> loadedRead;
+    CHECK(CSoundCache(makeKey()).load(loaded, loadedRead));
+}
+
+std::string cacheFilePath(const SoundCacheKey &key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "sounds_%08X.dat", key.audioCrc);
+    return gScratchDir + "/cache/" + name;
+}
+
+std::vector<char> readWhole(const std::string &path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeWhole(const std::string &path, const std::vector<char> &data)
+{
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(data.data(), std::streamsize(data.size()));
+}
+
+// Any single byte changed, in the header, the index or the waveforms, makes a miss
+void testCorruptFile()
+{
+    const SoundCacheKey key = makeKey();
+    CHECK(CSoundCache(key).save(makeSlots(), std::vector<char>(3, 1)));
+
+    const std::string path = cacheFilePath(key);
+    const std::vector<char> good = readWhole(path);
+    CHECK(good.size() > 150);
+
+    size_t accepted = 0;
+    for(size_t pos=0 ; pos<good.size() ; pos++)
+    {
+        std::vector<char> bad(good);
+        bad[pos] ^= 0x01;
+        writeWhole(path, bad);
+
+        std::vector<CSoundSlot> loaded(3);
+        std::vector<char> loadedRead;
+        if(CSoundCache(key).load(loaded, loadedRead))
+            accepted++;
+    }
+    CHECK_EQ(accepted, size_t(0));
+
+    writeWhole(path, good);
+    std::vector<CSoundSlot> loaded(3);
+    std::vector<char> loadedRead;
+    CHECK(CSoundCache(key).load(loaded, loadedRead));
+}
+
+// A file cut off anywhere, like by a crash of an older version while writing it, is a miss
+void testTruncatedFile()
+{
+    const SoundCacheKey key = makeKey();
+    CHECK(CSoundCache(key).save(makeSlots(), std::vector<char>(3, 1)));
+
+    const std::string path = cacheFilePath(key);
+    const std::vector<char> good = readWhole(path);
+
+    size_t accepted = 0;
+    for(size_t len=0 ; len<good.size() ; len += 7)
+    {
+        writeWhole(path, std::vector<char>(good.begin(), good.begin()+len));
+
+        std::vector<CSoundSlot> loaded(3);
+        std::vector<char> loadedRead;
+        if(CSoundCache(key).load(loaded, loadedRead))
+            accepted++;
+    }
+    CHECK_EQ(accepted, size_t(0));
+
+    remove(path.c_str());
+}
+
+// Saving over an existing file replaces it, and no temporary file stays behind
+void testReplace()
+{
+    const SoundCacheKey key = makeKey();
+    CHECK(CSoundCache(key).save(makeSlots(), std::vector<char>(3, 1)));
+
+    std::vector<CSoundSlot> slots = makeSlots();
+    slots[0].priority = 77;
+    CHECK(CSoundCache(key).save(slots, std::vector<char>(3, 1)));
+
+    std::vector<CSoundSlot> loaded(3);
+    std::vector<char> loadedRead;
+    CHECK(CSoundCache(key).load(loaded, loadedRead));
+    CHECK_EQ(loaded[0].priority, 77);
+
+    const std::string tempPath = cacheFilePath(key) + ".tmp";
+    CHECK(access(tempPath.c_str(), F_OK) != 0);
+
+    remove(cacheFilePath(key).c_str());
+}
+
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/cgsoundcacheXXXXXX";
+    if(!mkdtemp(dirTemplate))
+    {
+        std::fprintf(stderr, "Could not create a scratch directory\n");
+        return 1;
+    }
+    gScratchDir = dirTemplate;
+    const std::string cacheDir = gScratchDir + "/cache";
+    mkdir(cacheDir.c_str(), 0700);
+
+    testChecksum();
+    testRoundTrip();
+    testKeyMismatch();
+    testCorruptFile();
+    testTruncatedFile();
+    testReplace();
+
+    CHECK(remove(cacheDir.c_str()) == 0);
+    CHECK(remove(gScratchDir.c_str()) == 0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,42 @@
+/*
+ * UnitTest.h
+ *
+ *  Minimal checks for the unit tests. Every test is an executable of its own,
+ *  which CTest runs and which fails with a non-zero exit code.
+ */
+
+#ifndef UNITTEST_H
+#define UNITTEST_H
+
+#include <cstdio>
+
+namespace unittest
+{
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+}
+
+#define CHECK(cond) \
+    do { \
+        if(!(cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            unittest::failures()++; \
+        } \
+    } while(0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        if(!((a) == (b))) { \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #a, #b); \
+            unittest::failures()++; \
+        } \
+    } while(0)
+
+#define TEST_RESULT() \
+    (unittest::failures() == 0 ? (std::printf("passed\n"), 0) \
+                               : (std::printf("%d checks failed\n", unittest::failures()), 1))
+
+#endif // UNITTEST_H
@@ -0,0 +1,160 @@
+/*
+ * VoiceAllocatorTest.cpp
+ *
+ *  Which mixer channel a sound effect gets, and which one it takes away from another sound
+ */
+
+#include "UnitTest.h"
+
+#include <sdl/audio/sound/CVoiceAllocator.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// Stops all voices of a slot the way Audio::stopSound() does
+void stopSlot(CVoiceAllocator &alloc, const unsigned int slot)
+{
+    const std::vector<int> voices = alloc.getVoicesOf(slot);
+    for(const int voice : voices)
+        alloc.release(voice);
+}
+
+void testFreeVoices()
+{
+    CVoiceAllocator alloc;
+    alloc.reset(4);
+    CHECK_EQ(alloc.numVoices(), 4u);
+    CHECK_EQ(alloc.numFreeVoices(), 4u);
+
+    bool stolen = true;
+    for(int i=0 ; i<4 ; i++)
+    {
+        // Lowest voices first
+        CHECK_EQ(alloc.allocate(10+i, 1, stolen), i);
+        CHECK(!stolen);
+        CHECK(alloc.isActive(i));
+    }
+    CHECK_EQ(alloc.numFreeVoices(), 0u);
+
+    alloc.release(2);
+    CHECK(!alloc.isActive(2));
+    CHECK_EQ(alloc.allocate(20, 1, stolen), 2);
+    CHECK(!stolen);
+
+    // Releasing twice or out of range doesn't hand out a voice twice
+    alloc.release(1);
+    alloc.release(1);
+    alloc.release(-1);
+    alloc.release(4);
+    CHECK_EQ(alloc.numFreeVoices(), 1u);
+}
+
+// With all voices busy the lowest priority goes, never a higher one than the new sound
+void testPriorityStealing()
+{
+    CVoiceAllocator alloc;
+    alloc.reset(3);
+
+    bool stolen = false;
+    CHECK_EQ(alloc.allocate(1, 5, stolen), 0);
+    CHECK_EQ(alloc.allocate(2, 2, stolen), 1);
+    CHECK_EQ(alloc.allocate(3, 8, stolen), 2);
+
+    CHECK_EQ(alloc.allocate(4, 6, stolen), 1);
+    CHECK(stolen);
+    CHECK(alloc.getVoicesOf(2).empty());
+    CHECK_EQ(alloc.getVoicesOf(4).size(), size_t(1));
+
+    // Now 5, 6 and 8 play. Priority 5 may take the 5, an equal one.
+    CHECK_EQ(alloc.allocate(5, 5, stolen), 0);
+    CHECK(stolen);
+
+    // Priority 4 is below everything that plays
+    stolen = true;
+    CHECK_EQ(alloc.allocate(6, 4, stolen), -1);
+    CHECK(!stolen);
+    CHECK_EQ(alloc.getVoicesOf(5).size(), size_t(1));
+    CHECK(alloc.getVoicesOf(6).empty());
+}
+
+// Among equal priorities the voice started first is stolen
+void testOldestStolen()
+{
+    CVoiceAllocator alloc;
+    alloc.reset(3);
+
+    bool stolen = false;
+    alloc.allocate(1, 3, stolen);       // voice 0
+    alloc.allocate(2, 3, stolen);       // voice 1
+    alloc.allocate(3, 3, stolen);       // voice 2
+
+    // Restarting voice 0 makes voice 1 the oldest
+    alloc.release(0);
+    CHECK_EQ(alloc.allocate(4, 3, stolen), 0);
+
+    CHECK_EQ(alloc.allocate(5, 3, stolen), 1);
+    CHECK(stolen);
+    CHECK_EQ(alloc.allocate(6, 3, stolen), 2);
+    CHECK_EQ(alloc.allocate(7, 3, stolen), 0);
+    CHECK_EQ(alloc.allocate(8, 3, stolen), 1);
+
+    // A lower priority is taken before an older one
+    alloc.reset(2);
+    alloc.allocate(1, 1, stolen);
+    alloc.allocate(2, 0, stolen);
+    CHECK_EQ(alloc.allocate(3, 1, stolen), 1);
+}
+
+// One sound on several voices, stopping it frees all of them and nothing else
+void testStopSound()
+{
+    CVoiceAllocator alloc;
+    alloc.reset(5);
+
+    bool stolen = false;
+    alloc.allocate(7, 1, stolen);
+    alloc.allocate(3, 1, stolen);
+    alloc.allocate(7, 1, stolen);
+    alloc.allocate(7, 1, stolen);
+
+    std::vector<int> voices = alloc.getVoicesOf(7);
+    std::sort(voices.begin(), voices.end());
+    CHECK(voices == std::vector<int>({0, 2, 3}));
+
+    stopSlot(alloc, 7);
+    CHECK(alloc.getVoicesOf(7).empty());
+    CHECK_EQ(alloc.numFreeVoices(), 4u);
+    CHECK(!alloc.isActive(0) && !alloc.isActive(2) && !alloc.isActive(3));
+    CHECK(alloc.isActive(1));
+    CHECK_EQ(alloc.getVoicesOf(3).size(), size_t(1));
+
+    // A slot never played and one past all known slots
+    stopSlot(alloc, 2);
+    stopSlot(alloc, 1000);
+    CHECK_EQ(alloc.numFreeVoices(), 4u);
+
+    // A stolen voice no longer belongs to the sound it played
+    alloc.reset(1);
+    alloc.allocate(7, 1, stolen);
+    alloc.allocate(8, 1, stolen);
+    CHECK(stolen);
+    stopSlot(alloc, 7);
+    CHECK(alloc.isActive(0));
+    stopSlot(alloc, 8);
+    CHECK(!alloc.isActive(0));
+}
+
+}
+
+int main()
+{
+    testFreeVoices();
+    testPriorityStealing();
+    testOldestStolen();
+    testStopSound();
+
+    return TEST_RESULT();
+}